@@ -151,6 +151,8 @@ static struct argp_option gf_options[] = {
          "[default: \"off\"]"
 #endif
         },
+        {"event-threads", ARGP_EVENT_THREADS_KEY, "COUNT", 0,
+         "Number of threads dispatching network events [default: 1]"},
         {"brick-name", ARGP_BRICK_NAME_KEY, "BRICK-NAME", OPTION_HIDDEN,
          "Brick name to be registered with Gluster portmapper" },
         {"brick-port", ARGP_BRICK_PORT_KEY, "BRICK-PORT", OPTION_HIDDEN,
@@ -166,6 +168,8 @@ static struct argp_option gf_options[] = {
         {"attribute-timeout", ARGP_ATTRIBUTE_TIMEOUT_KEY, "SECONDS", 0,
          "Set attribute timeout to SECONDS for inodes in fuse kernel module "
          "[default: 1]"},
+        {"reader-thread-count", ARGP_READER_THREAD_COUNT_KEY, "COUNT", 0,
+         "Number of threads reading requests from fuse [default: 1]"},
         {"client-pid", ARGP_CLIENT_PID_KEY, "PID", OPTION_HIDDEN,
          "client will authenticate itself with process id PID to server"},
         {"dump-fuse", ARGP_DUMP_FUSE_KEY, "PATH", 0,
@@ -251,6 +255,17 @@ create_fuse_mount (glusterfs_ctx_t *ctx)
                 }
         }
 
+        if (cmd_args->reader_thread_count) {
+                ret = dict_set_int32 (master->options, "reader-thread-count",
+                                      cmd_args->reader_thread_count);
+                if (ret < 0) {
+                        gf_log ("glusterfsd", GF_LOG_ERROR,
+                                "failed to set dict value for key %s",
+                                "reader-thread-count");
+                        goto err;
+                }
+        }
+
         if (cmd_args->client_pid_set) {
                 ret = dict_set_int32 (master->options, "client-pid",
                                       cmd_args->client_pid);
@@ -480,6 +495,19 @@ parse_opts (int key, char *arg, struct argp_state *state)
                               "Invalid limit on connect attempts %s", arg);
                 break;
 
+        case ARGP_EVENT_THREADS_KEY:
+                n = 0;
+
+                if (gf_string2uint_base10 (arg, &n) == 0
+                    && n >= 1 && n <= EVENT_MAX_THREADS) {
+                        cmd_args->event_threads = n;
+                        break;
+                }
+
+                argp_failure (state, -1, 0,
+                              "Invalid event thread count %s", arg);
+                break;
+
         case ARGP_READ_ONLY_KEY:
                 cmd_args->read_only = 1;
                 break;
@@ -635,6 +663,18 @@ parse_opts (int key, char *arg, struct argp_state *state)
                               "unknown attribute timeout %s", arg);
                 break;
 
+        case ARGP_READER_THREAD_COUNT_KEY:
+                n = 0;
+
+                if (gf_string2uint_base10 (arg, &n) == 0 && n >= 1) {
+                        cmd_args->reader_thread_count = n;
+                        break;
+                }
+
+                argp_failure (state, -1, 0,
+                              "Invalid reader thread count %s", arg);
+                break;
+
         case ARGP_CLIENT_PID_KEY:
                 if (gf_string2int (arg, &cmd_args->client_pid) == 0) {
                         cmd_args->client_pid_set = 1;
@@ -982,6 +1022,7 @@ glusterfs_ctx_defaults_init (glusterfs_ctx_t *ctx)
 #endif
         cmd_args->fuse_attribute_timeout = -1;
         cmd_args->fuse_entry_timeout = -1;
+        cmd_args->event_threads = 1;
 
         INIT_LIST_HEAD (&cmd_args->xlator_options);
 
@@ -1490,6 +1531,11 @@ main (int argc, char *argv[])
         if (ret)
                 goto out;
 
+        ret = event_pool_set_thread_count (ctx->event_pool,
+                                           ctx->cmd_args.event_threads);
+        if (ret)
+                goto out;
+
         ret = glusterfs_volumes_init (ctx);
         if (ret)
                 goto out;
@@ -76,6 +76,8 @@ enum argp_option_keys {
         ARGP_BRICK_NAME_KEY               = 151,
         ARGP_BRICK_PORT_KEY               = 152,
         ARGP_CLIENT_PID_KEY               = 153,
+        ARGP_EVENT_THREADS_KEY            = 154,
+        ARGP_READER_THREAD_COUNT_KEY      = 155,
 };
 
 int glusterfs_mgmt_pmap_signout (glusterfs_ctx_t *ctx);
@@ -35,6 +35,7 @@ typedef struct {
 	call_frame_t *frame;
 	glusterfs_fop_t fop;
        struct mem_pool *stub_mem_pool;    /* pointer to stub mempool in glusterfs ctx */
+        struct timeval  queued_at;        /* set by xlators queueing stubs */
 
 	union {
 		/* lookup */
@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <inttypes.h>
+#include <stdarg.h>
 
 #ifndef _CONFIG_H
 #define _CONFIG_H
@@ -35,6 +36,7 @@
 #include "logging.h"
 #include "compat.h"
 #include "byte-order.h"
+#include "iobuf.h"
 
 data_pair_t *
 get_new_data_pair ()
@@ -56,10 +58,21 @@ get_new_data ()
                 return NULL;
         }
 
-        LOCK_INIT (&data->lock);
         return data;
 }
 
+static int32_t
+dict_hash_size (int32_t size_hint)
+{
+        int32_t size = DICT_INLINE_SLOTS;
+
+        /* keep the table at most three quarters full */
+        while (size_hint > (size / 4) * 3)
+                size <<= 1;
+
+        return size;
+}
+
 dict_t *
 get_new_dict_full (int size_hint)
 {
@@ -69,13 +82,17 @@ get_new_dict_full (int size_hint)
                 return NULL;
         }
 
-        dict->hash_size = size_hint;
-        dict->members = GF_CALLOC (size_hint, sizeof (data_pair_t *),
-                                   gf_common_mt_data_pair_t);
-
-        if (!dict->members) {
-                GF_FREE (dict);
-                return NULL;
+        dict->hash_size = dict_hash_size (size_hint);
+        if (dict->hash_size == DICT_INLINE_SLOTS) {
+                dict->members = dict->members_internal;
+        } else {
+                dict->members = GF_CALLOC (dict->hash_size,
+                                           sizeof (data_pair_t *),
+                                           gf_common_mt_data_pair_t);
+                if (!dict->members) {
+                        GF_FREE (dict);
+                        return NULL;
+                }
         }
 
         LOCK_INIT (&dict->lock);
@@ -86,15 +103,21 @@ get_new_dict_full (int size_hint)
 dict_t *
 get_new_dict (void)
 {
-        return get_new_dict_full (1);
+        return get_new_dict_full (0);
 }
 
 dict_t *
 dict_new (void)
+{
+        return dict_new_size (0);
+}
+
+dict_t *
+dict_new_size (int32_t size_hint)
 {
         dict_t *dict = NULL;
 
-        dict = get_new_dict_full(1);
+        dict = get_new_dict_full (size_hint);
 
         if (dict)
                 dict_ref (dict);
@@ -130,10 +153,9 @@ void
 data_destroy (data_t *data)
 {
         if (data) {
-                LOCK_DESTROY (&data->lock);
-
                 if (!data->is_static) {
-                        if (data->data) {
+                        if (data->data &&
+                            data->data != data->inline_data) {
                                 if (data->is_stdalloc)
                                         free (data->data);
                                 else
@@ -143,6 +165,12 @@ data_destroy (data_t *data)
                                 GF_FREE (data->vec);
                 }
 
+                if (data->backing)
+                        data_unref (data->backing);
+
+                if (data->iobref)
+                        iobref_unref (data->iobref);
+
                 data->len = 0xbabababa;
                 if (!data->is_const)
                         GF_FREE (data);
@@ -167,7 +195,11 @@ data_copy (data_t *old)
 
         if (old) {
                 newdata->len = old->len;
-                if (old->data) {
+                if (old->data && old->len >= 0 &&
+                    old->len <= DATA_INLINE_SIZE) {
+                        memcpy (newdata->inline_data, old->data, old->len);
+                        newdata->data = newdata->inline_data;
+                } else if (old->data) {
                         newdata->data = memdup (old->data, old->len);
                         if (!newdata->data)
                                 goto err_out;
@@ -180,12 +212,11 @@ data_copy (data_t *old)
                 }
         }
 
-        LOCK_INIT (&newdata->lock);
         return newdata;
 
 err_out:
 
-        if (newdata->data)
+        if (newdata->data && newdata->data != newdata->inline_data)
                 FREE (newdata->data);
         if (newdata->vec)
                 FREE (newdata->vec);
@@ -194,24 +225,91 @@ err_out:
         return NULL;
 }
 
+/* formats small values straight into the inline buffer of @data */
+static int
+data_set_printf (data_t *data, const char *fmt, ...)
+{
+        va_list ap;
+        int     ret = 0;
+
+        va_start (ap, fmt);
+        ret = vsnprintf (data->inline_data, DATA_INLINE_SIZE, fmt, ap);
+        va_end (ap);
+
+        if (ret >= 0 && ret < DATA_INLINE_SIZE) {
+                data->data = data->inline_data;
+        } else {
+                va_start (ap, fmt);
+                ret = gf_vasprintf (&data->data, fmt, ap);
+                va_end (ap);
+                if (ret == -1)
+                        return -1;
+        }
+
+        data->len = ret + 1;
+        return 0;
+}
+
+/* the table is never full, so the probe always ends on a match or a hole */
+static uint32_t
+__dict_slot (dict_t *this, char *key, uint32_t hash)
+{
+        uint32_t     mask = this->hash_size - 1;
+        uint32_t     idx  = hash & mask;
+        data_pair_t *pair = NULL;
+
+        while ((pair = this->members[idx]) != NULL) {
+                if (pair->key_hash == hash && !strcmp (pair->key, key))
+                        break;
+                idx = (idx + 1) & mask;
+        }
+
+        return idx;
+}
+
+static int
+__dict_rehash (dict_t *this, int32_t hash_size)
+{
+        data_pair_t **members = NULL;
+        data_pair_t  *pair    = NULL;
+        uint32_t      mask    = hash_size - 1;
+        uint32_t      idx     = 0;
+
+        members = GF_CALLOC (hash_size, sizeof (*members),
+                             gf_common_mt_data_pair_t);
+        if (!members)
+                return -1;
+
+        for (pair = this->members_list; pair; pair = pair->next) {
+                idx = pair->key_hash & mask;
+                while (members[idx])
+                        idx = (idx + 1) & mask;
+                members[idx] = pair;
+        }
+
+        if (this->members != this->members_internal)
+                GF_FREE (this->members);
+
+        this->members = members;
+        this->hash_size = hash_size;
+
+        return 0;
+}
+
 static data_pair_t *
 _dict_lookup (dict_t *this, char *key)
 {
+        uint32_t hash = 0;
+
         if (!this || !key) {
                 gf_log_callingfn ("dict", GF_LOG_WARNING,
                                   "!this || !key (%s)", key);
                 return NULL;
         }
 
-        int hashval = SuperFastHash (key, strlen (key)) % this->hash_size;
-        data_pair_t *pair;
-
-        for (pair = this->members[hashval]; pair != NULL; pair = pair->hash_next) {
-                if (pair->key && !strcmp (pair->key, key))
-                        return pair;
-        }
+        hash = SuperFastHash (key, strlen (key));
 
-        return NULL;
+        return this->members[__dict_slot (this, key, hash)];
 }
 
 
@@ -220,10 +318,11 @@ _dict_set (dict_t *this,
            char *key,
            data_t *value)
 {
-        int hashval;
+        uint32_t hash;
+        uint32_t idx;
         data_pair_t *pair;
         char key_free = 0;
-        int tmp = 0;
+        size_t keylen = 0;
         int ret = 0;
 
         if (!key) {
@@ -235,9 +334,10 @@ _dict_set (dict_t *this,
                 key_free = 1;
         }
 
-        tmp = SuperFastHash (key, strlen (key));
-        hashval = (tmp % this->hash_size);
-        pair = _dict_lookup (this, key);
+        keylen = strlen (key);
+        hash = SuperFastHash (key, keylen);
+        idx = __dict_slot (this, key, hash);
+        pair = this->members[idx];
 
         if (pair) {
                 data_t *unref_data = pair->value;
@@ -248,27 +348,30 @@ _dict_set (dict_t *this,
                 /* Indicates duplicate key */
                 return 0;
         }
-        pair = (data_pair_t *) GF_CALLOC (1, sizeof (*pair),
-                                          gf_common_mt_data_pair_t);
-        if (!pair) {
-                return -1;
-        }
 
-        pair->key = (char *) GF_CALLOC (1, strlen (key) + 1,
-                                        gf_common_mt_char);
-        if (!pair->key) {
-                GF_FREE (pair);
+        if ((this->count + 1) > (this->hash_size / 4) * 3) {
+                if (__dict_rehash (this, this->hash_size * 2) != 0) {
+                        if (key_free)
+                                GF_FREE (key);
+                        return -1;
+                }
+                idx = __dict_slot (this, key, hash);
+        }
 
+        pair = (data_pair_t *) GF_CALLOC (1, sizeof (*pair) + keylen + 1,
+                                          gf_common_mt_data_pair_t);
+        if (!pair) {
                 if (key_free)
                         GF_FREE (key);
                 return -1;
         }
 
-        strcpy (pair->key, key);
+        pair->key = (char *) (pair + 1);
+        memcpy (pair->key, key, keylen + 1);
+        pair->key_hash = hash;
         pair->value = data_ref (value);
 
-        pair->hash_next = this->members[hashval];
-        this->members[hashval] = pair;
+        this->members[idx] = pair;
 
         pair->next = this->members_list;
         pair->prev = NULL;
@@ -331,6 +434,12 @@ dict_get (dict_t *this, char *key)
 void
 dict_del (dict_t *this, char *key)
 {
+        data_pair_t *pair = NULL;
+        uint32_t     mask = 0;
+        uint32_t     hole = 0;
+        uint32_t     idx  = 0;
+        uint32_t     home = 0;
+
         if (!this || !key) {
                 gf_log_callingfn ("dict", GF_LOG_WARNING,
                                   "!this || key=%s", key);
@@ -339,37 +448,44 @@ dict_del (dict_t *this, char *key)
 
         LOCK (&this->lock);
 
-        int hashval = SuperFastHash (key, strlen (key)) % this->hash_size;
-        data_pair_t *pair = this->members[hashval];
-        data_pair_t *prev = NULL;
+        mask = this->hash_size - 1;
+        hole = __dict_slot (this, key, SuperFastHash (key, strlen (key)));
+        pair = this->members[hole];
+        if (!pair)
+                goto unlock;
 
-        while (pair) {
-                if (strcmp (pair->key, key) == 0) {
-                        if (prev)
-                                prev->hash_next = pair->hash_next;
-                        else
-                                this->members[hashval] = pair->hash_next;
+        data_unref (pair->value);
 
-                        data_unref (pair->value);
+        if (pair->prev)
+                pair->prev->next = pair->next;
+        else
+                this->members_list = pair->next;
 
-                        if (pair->prev)
-                                pair->prev->next = pair->next;
-                        else
-                                this->members_list = pair->next;
+        if (pair->next)
+                pair->next->prev = pair->prev;
 
-                        if (pair->next)
-                                pair->next->prev = pair->prev;
+        GF_FREE (pair);
+        this->count--;
 
-                        GF_FREE (pair->key);
-                        GF_FREE (pair);
-                        this->count--;
+        /* shift back the rest of the probe run, so that lookups never
+           stop at the slot we just emptied */
+        idx = hole;
+        for (;;) {
+                idx = (idx + 1) & mask;
+                pair = this->members[idx];
+                if (!pair)
                         break;
-                }
 
-                prev = pair;
-                pair = pair->hash_next;
+                home = pair->key_hash & mask;
+                if ((idx > hole) ? (home <= hole || home > idx)
+                                 : (home <= hole && home > idx)) {
+                        this->members[hole] = pair;
+                        hole = idx;
+                }
         }
+        this->members[hole] = NULL;
 
+unlock:
         UNLOCK (&this->lock);
 
         return;
@@ -391,12 +507,12 @@ dict_destroy (dict_t *this)
         while (prev) {
                 pair = pair->next;
                 data_unref (prev->value);
-                GF_FREE (prev->key);
                 GF_FREE (prev);
                 prev = pair;
         }
 
-        GF_FREE (this->members);
+        if (this->members != this->members_internal)
+                GF_FREE (this->members);
 
         if (this->extra_free)
                 GF_FREE (this->extra_free);
@@ -412,21 +528,12 @@ dict_destroy (dict_t *this)
 void
 dict_unref (dict_t *this)
 {
-        int32_t ref;
-
         if (!this) {
                 gf_log_callingfn ("dict", GF_LOG_WARNING, "dict is NULL");
                 return;
         }
 
-        LOCK (&this->lock);
-
-        this->refcount--;
-        ref = this->refcount;
-
-        UNLOCK (&this->lock);
-
-        if (!ref)
+        if (GF_ATOMIC_DEC (this->refcount) == 0)
                 dict_destroy (this);
 }
 
@@ -438,11 +545,7 @@ dict_ref (dict_t *this)
                 return NULL;
         }
 
-        LOCK (&this->lock);
-
-        this->refcount++;
-
-        UNLOCK (&this->lock);
+        GF_ATOMIC_INC (this->refcount);
 
         return this;
 }
@@ -450,21 +553,12 @@ dict_ref (dict_t *this)
 void
 data_unref (data_t *this)
 {
-        int32_t ref;
-
         if (!this) {
                 gf_log_callingfn ("dict", GF_LOG_WARNING, "dict is NULL");
                 return;
         }
 
-        LOCK (&this->lock);
-
-        this->refcount--;
-        ref = this->refcount;
-
-        UNLOCK (&this->lock);
-
-        if (!ref)
+        if (GF_ATOMIC_DEC (this->refcount) == 0)
                 data_destroy (this);
 }
 
@@ -476,11 +570,7 @@ data_ref (data_t *this)
                 return NULL;
         }
 
-        LOCK (&this->lock);
-
-        this->refcount++;
-
-        UNLOCK (&this->lock);
+        GF_ATOMIC_INC (this->refcount);
 
         return this;
 }
@@ -725,12 +815,11 @@ int_to_data (int64_t value)
                 return NULL;
         }
 
-        ret = gf_asprintf (&data->data, "%"PRId64, value);
+        ret = data_set_printf (data, "%"PRId64, value);
         if (-1 == ret) {
                 gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
                 return NULL;
         }
-        data->len = strlen (data->data) + 1;
 
         return data;
 }
@@ -744,12 +833,11 @@ data_from_int64 (int64_t value)
         if (!data) {
                 return NULL;
         }
-        ret = gf_asprintf (&data->data, "%"PRId64, value);
+        ret = data_set_printf (data, "%"PRId64, value);
         if (-1 == ret) {
                 gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
                 return NULL;
         }
-        data->len = strlen (data->data) + 1;
 
         return data;
 }
@@ -763,14 +851,12 @@ data_from_int32 (int32_t value)
         if (!data) {
                 return NULL;
         }
-        ret = gf_asprintf (&data->data, "%"PRId32, value);
+        ret = data_set_printf (data, "%"PRId32, value);
         if (-1 == ret) {
                 gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
                 return NULL;
         }
 
-        data->len = strlen (data->data) + 1;
-
         return data;
 }
 
@@ -783,14 +869,12 @@ data_from_int16 (int16_t value)
         if (!data) {
                 return NULL;
         }
-        ret = gf_asprintf (&data->data, "%"PRId16, value);
+        ret = data_set_printf (data, "%"PRId16, value);
         if (-1 == ret) {
                 gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
                 return NULL;
         }
 
-        data->len = strlen (data->data) + 1;
-
         return data;
 }
 
@@ -803,14 +887,12 @@ data_from_int8 (int8_t value)
         if (!data) {
                 return NULL;
         }
-        ret = gf_asprintf (&data->data, "%d", value);
+        ret = data_set_printf (data, "%d", value);
         if (-1 == ret) {
                 gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
                 return NULL;
         }
 
-        data->len = strlen (data->data) + 1;
-
         return data;
 }
 
@@ -823,14 +905,12 @@ data_from_uint64 (uint64_t value)
         if (!data) {
                 return NULL;
         }
-        ret = gf_asprintf (&data->data, "%"PRIu64, value);
+        ret = data_set_printf (data, "%"PRIu64, value);
         if (-1 == ret) {
                 gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
                 return NULL;
         }
 
-        data->len = strlen (data->data) + 1;
-
         return data;
 }
 
@@ -846,11 +926,10 @@ data_from_double (double value)
                 return NULL;
         }
 
-        ret = gf_asprintf (&data->data, "%f", value);
+        ret = data_set_printf (data, "%f", value);
         if (ret == -1) {
                 return NULL;
         }
-        data->len = strlen (data->data) + 1;
 
         return data;
 }
@@ -865,14 +944,12 @@ data_from_uint32 (uint32_t value)
         if (!data) {
                 return NULL;
         }
-        ret = gf_asprintf (&data->data, "%"PRIu32, value);
+        ret = data_set_printf (data, "%"PRIu32, value);
         if (-1 == ret) {
                 gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
                 return NULL;
         }
 
-        data->len = strlen (data->data) + 1;
-
         return data;
 }
 
@@ -886,13 +963,11 @@ data_from_uint16 (uint16_t value)
         if (!data) {
                 return NULL;
         }
-        ret = gf_asprintf (&data->data, "%"PRIu16, value);
+        ret = data_set_printf (data, "%"PRIu16, value);
         if (-1 == ret) {
                 return NULL;
         }
 
-        data->len = strlen (data->data) + 1;
-
         return data;
 }
 
@@ -1006,6 +1081,31 @@ data_from_dynptr (void *value, int32_t len)
         return data;
 }
 
+/* the value is read in place from @iobuf, which the data_t keeps a ref on,
+   so that dict_serialize_iov () can send it without a copy */
+data_t *
+data_from_iobuf (struct iobuf *iobuf, int32_t len)
+{
+        data_t *data = NULL;
+
+        data = get_new_data ();
+        if (!data)
+                return NULL;
+
+        data->iobref = iobref_new ();
+        if (!data->iobref) {
+                GF_FREE (data);
+                return NULL;
+        }
+        iobref_add (data->iobref, iobuf);
+
+        data->len = len;
+        data->data = iobuf_ptr (iobuf);
+        data->is_static = 1;
+
+        return data;
+}
+
 data_t *
 bin_to_data (void *value, int32_t len)
 {
@@ -1221,7 +1321,7 @@ dict_copy (dict_t *dict,
         }
 
         if (!new)
-                new = get_new_dict_full (dict->hash_size);
+                new = get_new_dict_full (dict->count);
 
         dict_foreach (dict, _copy, new);
 
@@ -2428,18 +2528,14 @@ out:
 
 
 /**
- * dict_unserialize - unserialize a buffer into a dict
- *
- * @buf:  buf containing serialized dict
- * @size: size of the @buf
- * @fill: dict to fill in
- *
- * @return: success: 0
- *          failure: -errno
+ * _dict_unserialize - unserialize a buffer into a dict. Values are copied
+ *                     out of @orig_buf, unless @backing is given, in which
+ *                     case they point into it and hold a ref on @backing.
  */
 
-int32_t
-dict_unserialize (char *orig_buf, int32_t size, dict_t **fill)
+static int32_t
+_dict_unserialize (char *orig_buf, int32_t size, dict_t **fill,
+                   data_t *backing)
 {
         char   *buf = NULL;
         int     ret   = -1;
@@ -2541,11 +2637,31 @@ dict_unserialize (char *orig_buf, int32_t size, dict_t **fill)
                                           "available (%lu) < required (%lu)",
                                           (long)(orig_buf + size),
                                           (long)(buf + vallen));
+                        goto out;
                 }
+
+                if (vallen < 0) {
+                        gf_log ("dict", GF_LOG_ERROR,
+                                "value length (%d) < 0", vallen);
+                        goto out;
+                }
+
                 value = get_new_data ();
+                if (!value) {
+                        ret = -ENOMEM;
+                        goto out;
+                }
                 value->len  = vallen;
-                value->data = memdup (buf, vallen);
-                value->is_static = 0;
+                if (backing) {
+                        value->data = buf;
+                        value->is_static = 1;
+                        value->backing = data_ref (backing);
+                } else if (vallen <= DATA_INLINE_SIZE) {
+                        memcpy (value->inline_data, buf, vallen);
+                        value->data = value->inline_data;
+                } else {
+                        value->data = memdup (buf, vallen);
+                }
                 buf += vallen;
 
                 dict_set (*fill, key, value);
@@ -2557,6 +2673,214 @@ out:
 }
 
 
+/**
+ * dict_unserialize - unserialize a buffer into a dict
+ *
+ * @buf:  buf containing serialized dict
+ * @size: size of the @buf
+ * @fill: dict to fill in
+ *
+ * @return: success: 0
+ *          failure: -errno
+ */
+
+int32_t
+dict_unserialize (char *buf, int32_t size, dict_t **fill)
+{
+        return _dict_unserialize (buf, size, fill, NULL);
+}
+
+
+/**
+ * dict_unserialize_nocopy - unserialize a buffer into a dict without copying
+ *                           the values; they point into @buf instead
+ *
+ * @buf:      buf containing serialized dict. It is handed over to the values
+ *            in all cases, and released with the last of them: with free ()
+ *            if @stdalloc (e.g. a buffer allocated by the XDR decoder),
+ *            GF_FREE () otherwise. The caller must not free it.
+ * @size:     size of the @buf
+ * @fill:     dict to fill in
+ * @stdalloc: whether @buf came from libc
+ *
+ * @return: success: 0
+ *          failure: -errno
+ */
+
+int32_t
+dict_unserialize_nocopy (char *buf, int32_t size, dict_t **fill,
+                         gf_boolean_t stdalloc)
+{
+        data_t *backing = NULL;
+        int32_t ret     = -ENOMEM;
+
+        backing = data_from_dynptr (buf, size);
+        if (!backing) {
+                if (stdalloc)
+                        free (buf);
+                else
+                        GF_FREE (buf);
+                goto out;
+        }
+        backing->is_stdalloc = stdalloc;
+
+        data_ref (backing);
+        ret = _dict_unserialize (buf, size, fill, backing);
+        data_unref (backing);
+out:
+        return ret;
+}
+
+
+/* whether dict_serialize_iov () sends @value in place */
+static int
+_dict_value_is_iov (data_t *value)
+{
+        return (value->iobref && !value->vec && (value->len > 0));
+}
+
+
+/**
+ * dict_serialize_iov - scatter-gather version of dict_serialize. Values read
+ *                      into iobufs (data_from_iobuf ()) are referenced in
+ *                      place, everything else is packed into one iobuf in
+ *                      between.
+ *
+ * @this:       dict to serialize
+ * @iobuf_pool: pool to take the iobuf of the packed parts from
+ * @vec:        vector to fill in
+ * @count:      number of entries available in @vec, set to the number used
+ * @iobref:     gets the iobufs @vec points into, so that it stays valid
+ *              after @this is gone for as long as @iobref is held
+ *
+ * @return: success: length of the serialized dict
+ *          failure: -errno
+ */
+
+int32_t
+dict_serialize_iov (dict_t *this, struct iobuf_pool *iobuf_pool,
+                    struct iovec *vec, int *count, struct iobref *iobref)
+{
+        data_pair_t  *pair     = NULL;
+        struct iobuf *iobuf    = NULL;
+        char         *buf      = NULL;
+        char         *run      = NULL;
+        int32_t       netword  = 0;
+        int32_t       keylen   = 0;
+        int32_t       vallen   = 0;
+        int32_t       len      = 0;
+        int32_t       packed   = 0;
+        int           inplace  = 0;
+        int           maxplace = 0;
+        int           veccnt   = 0;
+        int           i        = 0;
+        int           ret      = -EINVAL;
+
+        if (!this || !iobuf_pool || !vec || !count || (*count < 1)
+            || !iobref) {
+                gf_log_callingfn ("dict", GF_LOG_WARNING,
+                                  "dict OR iobuf_pool OR vec OR iobref is "
+                                  "NULL");
+                goto out;
+        }
+
+        /* every value sent in place is followed by the next packed run */
+        maxplace = (*count - 1) / 2;
+
+        LOCK (&this->lock);
+        {
+                len = _dict_serialized_length (this);
+                if (len < 0) {
+                        ret = len;
+                        goto unlock;
+                }
+
+                packed = len;
+                for (pair = this->members_list; pair; pair = pair->next) {
+                        if ((inplace < maxplace)
+                            && _dict_value_is_iov (pair->value)) {
+                                packed -= pair->value->len;
+                                inplace++;
+                        }
+                }
+
+                iobuf = iobuf_get2 (iobuf_pool, packed);
+                if (!iobuf) {
+                        ret = -ENOMEM;
+                        goto unlock;
+                }
+                iobref_add (iobref, iobuf);
+                iobuf_unref (iobuf);
+
+                buf = run = iobuf_ptr (iobuf);
+
+                netword = hton32 (this->count);
+                memcpy (buf, &netword, sizeof (netword));
+                buf += DICT_HDR_LEN;
+
+                inplace = 0;
+                for (pair = this->members_list; pair; pair = pair->next) {
+                        keylen = strlen (pair->key);
+                        vallen = pair->value->len;
+                        if (pair->value->vec) {
+                                vallen = 0;
+                                for (i = 0; i < pair->value->len; i++)
+                                        vallen += pair->value->vec[i].iov_len;
+                        }
+
+                        netword = hton32 (keylen);
+                        memcpy (buf, &netword, sizeof (netword));
+                        buf += DICT_DATA_HDR_KEY_LEN;
+                        netword = hton32 (vallen);
+                        memcpy (buf, &netword, sizeof (netword));
+                        buf += DICT_DATA_HDR_VAL_LEN;
+
+                        memcpy (buf, pair->key, keylen);
+                        buf += keylen;
+                        *buf++ = '\0';
+
+                        if ((inplace < maxplace)
+                            && _dict_value_is_iov (pair->value)) {
+                                vec[veccnt].iov_base = run;
+                                vec[veccnt].iov_len  = buf - run;
+                                veccnt++;
+
+                                vec[veccnt].iov_base = pair->value->data;
+                                vec[veccnt].iov_len  = vallen;
+                                veccnt++;
+
+                                iobref_merge (iobref, pair->value->iobref);
+                                inplace++;
+                                run = buf;
+                        } else if (pair->value->vec) {
+                                for (i = 0; i < pair->value->len; i++) {
+                                        memcpy (buf,
+                                                pair->value->vec[i].iov_base,
+                                                pair->value->vec[i].iov_len);
+                                        buf += pair->value->vec[i].iov_len;
+                                }
+                        } else {
+                                memcpy (buf, pair->value->data, vallen);
+                                buf += vallen;
+                        }
+                }
+
+                if (buf > run) {
+                        vec[veccnt].iov_base = run;
+                        vec[veccnt].iov_len  = buf - run;
+                        veccnt++;
+                }
+
+                *count = veccnt;
+                ret    = len;
+        }
+unlock:
+        UNLOCK (&this->lock);
+out:
+        return ret;
+}
+
+
 /**
  * dict_allocate_and_serialize - serialize a dictionary into an allocated buffer
  *
@@ -31,10 +31,20 @@
 
 #include "common-utils.h"
 
+struct iobuf;
+struct iobuf_pool;
+struct iobref;
+
 typedef struct _data data_t;
 typedef struct _dict dict_t;
 typedef struct _data_pair data_pair_t;
 
+/* values up to this size (any formatted integer) are kept in the data_t */
+#define DATA_INLINE_SIZE   24
+
+/* slots embedded in every dict_t, enough for the common small dict */
+#define DICT_INLINE_SLOTS  8
+
 struct _data {
         unsigned char  is_static:1;
         unsigned char  is_const:1;
@@ -43,30 +53,32 @@ struct _data {
         struct iovec  *vec;
         char          *data;
         int32_t        refcount;
-        gf_lock_t      lock;
+        data_t        *backing;  /* owns the buffer data points into */
+        struct iobref *iobref;   /* holds the iobuf data points into */
+        char           inline_data[DATA_INLINE_SIZE];
 };
 
 struct _data_pair {
-        struct _data_pair *hash_next;
+        uint32_t           key_hash;
         struct _data_pair *prev;
         struct _data_pair *next;
         data_t            *value;
-        char              *key;
+        char              *key;  /* allocated along with the pair */
 };
 
 struct _dict {
         unsigned char   is_static:1;
-        int32_t         hash_size;
+        int32_t         hash_size;  /* power of two */
         int32_t         count;
         int32_t         refcount;
-        data_pair_t   **members;
+        data_pair_t   **members;    /* open addressed, linear probing */
         data_pair_t    *members_list;
         char           *extra_free;
         char           *extra_stdfree;
         gf_lock_t       lock;
+        data_pair_t    *members_internal[DICT_INLINE_SLOTS];
 };
 
-
 int32_t is_data_equal (data_t *one, data_t *two);
 void data_destroy (data_t *data);
 
@@ -77,6 +89,11 @@ void dict_del (dict_t *this, char *key);
 int32_t dict_serialized_length (dict_t *dict);
 int32_t dict_serialize (dict_t *dict, char *buf);
 int32_t dict_unserialize (char *buf, int32_t size, dict_t **fill);
+int32_t dict_unserialize_nocopy (char *buf, int32_t size, dict_t **fill,
+                                 gf_boolean_t stdalloc);
+int32_t dict_serialize_iov (dict_t *this, struct iobuf_pool *iobuf_pool,
+                            struct iovec *vec, int *count,
+                            struct iobref *iobref);
 
 int32_t dict_allocate_and_serialize (dict_t *this, char **buf, size_t *length);
 
@@ -96,6 +113,7 @@ data_t *int_to_data (int64_t value);
 data_t *str_to_data (char *value);
 data_t *data_from_dynstr (char *value);
 data_t *data_from_dynptr (void *value, int32_t len);
+data_t *data_from_iobuf (struct iobuf *iobuf, int32_t len);
 data_t *bin_to_data (void *value, int32_t len);
 data_t *static_str_to_data (char *value);
 data_t *static_bin_to_data (void *value);
@@ -143,6 +161,7 @@ dict_t *dict_copy (dict_t *this, dict_t *new);
 
 /* CLEANED UP FUNCTIONS DECLARATIONS */
 GF_MUST_CHECK dict_t *dict_new (void);
+GF_MUST_CHECK dict_t *dict_new_size (int32_t size_hint);
 dict_t *dict_copy_with_ref (dict_t *this, dict_t *new);
 
 GF_MUST_CHECK int dict_get_int8 (dict_t *this, char *key, int8_t *val);
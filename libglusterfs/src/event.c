@@ -504,6 +504,8 @@ event_pool_new_epoll (int count)
 
         event_pool->count = count;
 
+        event_pool->eventthreadcount = 1;
+
         pthread_mutex_init (&event_pool->mutex, NULL);
         pthread_cond_init (&event_pool->cond, NULL);
 
@@ -545,9 +547,16 @@ event_register_epoll (struct event_pool *event_pool, int fd,
                 event_pool->used++;
 
                 event_pool->reg[idx].fd = fd;
+                /* a single dispatcher never races with itself on an fd,
+                 * only several of them need the fd disarmed while its
+                 * handler runs
+                 */
                 event_pool->reg[idx].events = EPOLLPRI;
+                if (event_pool->eventthreadcount > 1)
+                        event_pool->reg[idx].events |= EPOLLONESHOT;
                 event_pool->reg[idx].handler = handler;
                 event_pool->reg[idx].data = data;
+                event_pool->reg[idx].in_handler = 0;
 
                 switch (poll_in) {
                 case 1:
@@ -654,6 +663,12 @@ event_unregister_epoll (struct event_pool *event_pool, int fd, int idx_hint)
                         goto unlock;
                 }
 
+                /* an fd whose handler is running is disarmed, leave it so;
+                 * the dispatcher re-arms it with the new index afterwards
+                 */
+                if (event_pool->reg[lastidx].in_handler)
+                        goto move;
+
                 epoll_event.events = event_pool->reg[lastidx].events;
                 ev_data->fd = event_pool->reg[lastidx].fd;
                 ev_data->idx = idx;
@@ -668,6 +683,7 @@ event_unregister_epoll (struct event_pool *event_pool, int fd, int idx_hint)
                         goto unlock;
                 }
 
+        move:
                 /* just replace the unregistered idx by last one */
                 event_pool->reg[idx] = event_pool->reg[lastidx];
                 event_pool->used--;
@@ -737,6 +753,14 @@ event_select_on_epoll (struct event_pool *event_pool, int fd, int idx_hint,
                         break;
                 }
 
+                /* the new mask takes effect when the running handler
+                 * returns and the fd is re-armed
+                 */
+                if (event_pool->reg[idx].in_handler) {
+                        ret = 0;
+                        goto unlock;
+                }
+
                 epoll_event.events = event_pool->reg[idx].events;
                 ev_data->fd = fd;
                 ev_data->idx = idx;
@@ -766,11 +790,15 @@ event_dispatch_epoll_handler (struct event_pool *event_pool,
         void               *data = NULL;
         int                 idx = -1;
         int                 ret = -1;
+        struct epoll_event  epoll_event = {0, };
+        struct event_data  *ev_data = (void *)&epoll_event.data;
+        int                 oneshot = 0;
 
 
         event_data = (void *)&events[i].data;
         handler = NULL;
         data = NULL;
+        oneshot = (event_pool->eventthreadcount > 1);
 
         pthread_mutex_lock (&event_pool->mutex);
         {
@@ -784,31 +812,140 @@ event_dispatch_epoll_handler (struct event_pool *event_pool,
                         goto unlock;
                 }
 
+                /* the fd was re-armed by event_select_on before we got
+                 * here and another thread already owns it. epoll is level
+                 * triggered, so the owner sees this event after re-arming.
+                 */
+                if (event_pool->reg[idx].in_handler)
+                        goto unlock;
+
+                if (oneshot)
+                        event_pool->reg[idx].in_handler = 1;
+
                 handler = event_pool->reg[idx].handler;
                 data = event_pool->reg[idx].data;
         }
 unlock:
         pthread_mutex_unlock (&event_pool->mutex);
 
-        if (handler)
-                ret = handler (event_data->fd, event_data->idx, data,
-                               (events[i].events & (EPOLLIN|EPOLLPRI)),
-                               (events[i].events & (EPOLLOUT)),
-                               (events[i].events & (EPOLLERR|EPOLLHUP)));
+        if (!handler)
+                goto out;
+
+        ret = handler (event_data->fd, event_data->idx, data,
+                       (events[i].events & (EPOLLIN|EPOLLPRI)),
+                       (events[i].events & (EPOLLOUT)),
+                       (events[i].events & (EPOLLERR|EPOLLHUP)));
+
+        if (!oneshot)
+                goto out;
+
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                idx = __event_getindex (event_pool, event_data->fd, idx);
+
+                /* unregistered (and maybe reused) from within the handler */
+                if (idx == -1 || event_pool->reg[idx].data != data)
+                        goto rearm_unlock;
+
+                event_pool->reg[idx].in_handler = 0;
+
+                epoll_event.events = event_pool->reg[idx].events;
+                ev_data->fd = event_data->fd;
+                ev_data->idx = idx;
+
+                if (epoll_ctl (event_pool->fd, EPOLL_CTL_MOD, ev_data->fd,
+                               &epoll_event) == -1) {
+                        gf_log ("epoll", GF_LOG_ERROR,
+                                "failed to re-arm fd(=%d) (%s)",
+                                ev_data->fd, strerror (errno));
+                }
+        }
+rearm_unlock:
+        pthread_mutex_unlock (&event_pool->mutex);
+
+out:
         return ret;
 }
 
 
+static void *
+event_dispatch_epoll_worker (void *data)
+{
+        struct event_pool  *event_pool = data;
+        struct epoll_event  event = {0, };
+        int                 ret = -1;
+
+        while (1) {
+                pthread_mutex_lock (&event_pool->mutex);
+                {
+                        while (event_pool->used == 0)
+                                pthread_cond_wait (&event_pool->cond,
+                                                   &event_pool->mutex);
+                }
+                pthread_mutex_unlock (&event_pool->mutex);
+
+                /* one event per wakeup, so that a single thread does not
+                 * sit on a batch of disarmed fds while the others idle
+                 */
+                ret = epoll_wait (event_pool->fd, &event, 1, -1);
+
+                if (ret == 0)
+                        /* timeout */
+                        continue;
+
+                if (ret == -1) {
+                        if (errno != EINTR)
+                                gf_log ("epoll", GF_LOG_ERROR,
+                                        "epoll_wait failed (%s)",
+                                        strerror (errno));
+                        continue;
+                }
+
+                if (!event.events)
+                        continue;
+
+                event_dispatch_epoll_handler (event_pool, &event, 0);
+        }
+
+        return NULL;
+}
+
+
 static int
 event_dispatch_epoll (struct event_pool *event_pool)
 {
         struct epoll_event *events = NULL;
+        pthread_t           thread;
         int                 size = 0;
         int                 i = 0;
         int                 ret = -1;
 
         GF_VALIDATE_OR_GOTO ("event", event_pool, out);
 
+        if (event_pool->eventthreadcount > 1) {
+                /* the calling thread is the last of the dispatchers */
+                for (i = 1; i < event_pool->eventthreadcount; i++) {
+                        ret = pthread_create (&thread, NULL,
+                                              event_dispatch_epoll_worker,
+                                              event_pool);
+                        if (ret != 0) {
+                                gf_log ("epoll", GF_LOG_WARNING,
+                                        "failed to start event thread %d "
+                                        "(%s)", i, strerror (ret));
+                                break;
+                        }
+
+                        pthread_detach (thread);
+                }
+
+                gf_log ("epoll", GF_LOG_INFO,
+                        "dispatching events with %d threads", i);
+
+                event_dispatch_epoll_worker (event_pool);
+                ret = 0;
+                goto out;
+        }
+
         while (1) {
                 pthread_mutex_lock (&event_pool->mutex);
                 {
@@ -946,6 +1083,52 @@ out:
 }
 
 
+int
+event_pool_set_thread_count (struct event_pool *event_pool, int count)
+{
+        int ret = -1;
+
+        GF_VALIDATE_OR_GOTO ("event", event_pool, out);
+
+        if (count < 1 || count > EVENT_MAX_THREADS) {
+                gf_log ("event", GF_LOG_ERROR,
+                        "invalid event thread count %d (1-%d)",
+                        count, EVENT_MAX_THREADS);
+                goto out;
+        }
+
+#ifdef HAVE_SYS_EPOLL_H
+        if (event_pool->ops == &event_ops_epoll) {
+                /* fds are registered one-shot or not depending on the
+                 * thread count, it cannot change between the two later
+                 */
+                pthread_mutex_lock (&event_pool->mutex);
+                {
+                        if (event_pool->used &&
+                            (count > 1) != (event_pool->eventthreadcount > 1)) {
+                                gf_log ("event", GF_LOG_ERROR,
+                                        "event thread count has to be set "
+                                        "before registering fds");
+                        } else {
+                                event_pool->eventthreadcount = count;
+                                ret = 0;
+                        }
+                }
+                pthread_mutex_unlock (&event_pool->mutex);
+                goto out;
+        }
+#endif
+
+        if (count > 1)
+                gf_log ("event", GF_LOG_WARNING,
+                        "poll based event handling is single threaded, "
+                        "ignoring event thread count %d", count);
+        ret = 0;
+out:
+        return ret;
+}
+
+
 int
 event_dispatch (struct event_pool *event_pool)
 {
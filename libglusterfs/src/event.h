@@ -27,6 +27,8 @@
 
 #include <pthread.h>
 
+#define EVENT_MAX_THREADS 32
+
 struct event_pool;
 struct event_ops;
 struct event_data {
@@ -50,6 +52,7 @@ struct event_pool {
     int events;
     void *data;
     event_handler_t handler;
+    int in_handler;  /* fd is disarmed while its handler runs */
   } *reg;
 
   int used;
@@ -61,6 +64,8 @@ struct event_pool {
 
   void *evcache;
   int evcache_size;
+
+  int eventthreadcount;  /* number of threads running event_dispatch */
 };
 
 struct event_ops {
@@ -86,5 +91,6 @@ int event_register (struct event_pool *event_pool, int fd,
 		    void *data, int poll_in, int poll_out);
 int event_unregister (struct event_pool *event_pool, int fd, int idx);
 int event_dispatch (struct event_pool *event_pool);
+int event_pool_set_thread_count (struct event_pool *event_pool, int count);
 
 #endif /* _EVENT_H_ */
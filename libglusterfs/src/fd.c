@@ -516,7 +516,8 @@ fd_create (inode_t *inode, pid_t pid)
         if (!fd)
                 goto out;
 
-        fd->xl_count = inode->table->xl->graph->xl_count + 1;
+        fd->xl_count = inode->table->xl->graph->xl_count
+                + XLATOR_CTX_FOREIGN_SLOTS;
 
         fd->_ctx = GF_CALLOC (1, (sizeof (struct _fd_ctx) * fd->xl_count),
                               gf_common_mt_fd_ctx);
@@ -592,29 +593,48 @@ fd_list_empty (inode_t *inode)
 }
 
 
+/* the slot of @xlator in the ctx array of @fd, or -1 if it has none
+ * (with @set, if no free one is left either). an xlator of the graph
+ * owning the inode table always lives at its xl_id.
+ */
+static int
+__fd_ctx_index (fd_t *fd, xlator_t *xlator, int set)
+{
+        int count    = 0;
+        int index    = 0;
+        int free_idx = -1;
+
+        count = fd->xl_count - XLATOR_CTX_FOREIGN_SLOTS;
+
+        if ((xlator->graph == fd->inode->table->xl->graph)
+            && (xlator->xl_id < count)) {
+                index = xlator->xl_id;
+                if ((fd->_ctx[index].xl_key == xlator)
+                    || (set && !fd->_ctx[index].key))
+                        return index;
+        }
+
+        for (index = count; index < fd->xl_count; index++) {
+                if (fd->_ctx[index].xl_key == xlator)
+                        return index;
+                if (!fd->_ctx[index].key && (free_idx == -1))
+                        free_idx = index;
+        }
+
+        return (set ? free_idx : -1);
+}
+
+
 int
 __fd_ctx_set (fd_t *fd, xlator_t *xlator, uint64_t value)
 {
-        int index = 0;
         int ret = 0;
         int set_idx = -1;
 
 	if (!fd || !xlator)
 		return -1;
 
-        for (index = 0; index < fd->xl_count; index++) {
-                if (!fd->_ctx[index].key) {
-                        if (set_idx == -1)
-                                set_idx = index;
-                        /* dont break, to check if key already exists
-                           further on */
-                }
-                if (fd->_ctx[index].xl_key == xlator) {
-                        set_idx = index;
-                        break;
-                }
-        }
-
+        set_idx = __fd_ctx_index (fd, xlator, 1);
         if (set_idx == -1) {
                 gf_log_callingfn ("", GF_LOG_WARNING, "%p %s", fd, xlator->name);
                 ret = -1;
@@ -658,12 +678,8 @@ __fd_ctx_get (fd_t *fd, xlator_t *xlator, uint64_t *value)
         if (!fd || !xlator)
                 return -1;
 
-        for (index = 0; index < fd->xl_count; index++) {
-                if (fd->_ctx[index].xl_key == xlator)
-                        break;
-        }
-
-        if (index == fd->xl_count) {
+        index = __fd_ctx_index (fd, xlator, 0);
+        if (index == -1) {
                 ret = -1;
                 goto out;
         }
@@ -703,12 +719,8 @@ __fd_ctx_del (fd_t *fd, xlator_t *xlator, uint64_t *value)
         if (!fd || !xlator)
                 return -1;
 
-        for (index = 0; index < fd->xl_count; index++) {
-                if (fd->_ctx[index].xl_key == xlator)
-                        break;
-        }
-
-        if (index == fd->xl_count) {
+        index = __fd_ctx_index (fd, xlator, 0);
+        if (index == -1) {
                 ret = -1;
                 goto out;
         }
@@ -831,15 +843,14 @@ fd_ctx_dump (fd_t *fd, char *prefix)
         LOCK (&fd->lock);
         {
                 if (fd->_ctx != NULL) {
-                        fd_ctx = GF_CALLOC (fd->inode->table->xl->graph->xl_count,
+                        fd_ctx = GF_CALLOC (fd->xl_count,
                                             sizeof (*fd_ctx),
                                             gf_common_mt_fd_ctx);
                         if (fd_ctx == NULL) {
                                 goto unlock;
                         }
 
-                        for (i = 0; i < fd->inode->table->xl->graph->xl_count;
-                             i++) {
+                        for (i = 0; i < fd->xl_count; i++) {
                                 fd_ctx[i] = fd->_ctx[i];
                         }
                 }
@@ -851,7 +862,7 @@ unlock:
                 goto out;
         }
 
-        for (i = 0; i < fd->inode->table->xl->graph->xl_count; i++) {
+        for (i = 0; i < fd->xl_count; i++) {
                 if (fd_ctx[i].xl_key) {
                         xl = (xlator_t *)(long)fd_ctx[i].xl_key;
                         if (xl->dumpops && xl->dumpops->fdctx)
@@ -322,6 +322,13 @@ glusterfs_globals_init ()
 
         gf_mem_acct_enable_set ();
 
+        ret = mem_pool_thread_init ();
+        if (ret) {
+                gf_log ("", GF_LOG_CRITICAL,
+                        "ERROR: glusterfs mem-pool thread cache init failed");
+                goto out;
+        }
+
         ret = synctask_init ();
         if (ret) {
                 gf_log ("", GF_LOG_CRITICAL,
@@ -274,6 +274,7 @@ struct _cmd_args {
 	int              no_daemon_mode;
 	char            *run_id;
 	int              debug_mode;
+        int              event_threads;
         int              read_only;
         int              mac_compat;
 	struct list_head xlator_options;  /* list of xlator_option_t */
@@ -289,6 +290,7 @@ struct _cmd_args {
 	char            *dump_fuse;
         pid_t            client_pid;
         int              client_pid_set;
+        int              reader_thread_count;
 
 	/* key args */
 	char            *mount_point;
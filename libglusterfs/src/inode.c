@@ -87,6 +87,47 @@ hash_gfid (uuid_t uuid, int mod)
 }
 
 
+#define inode_hash_lock(table, hash)                                    \
+        (&(table)->inode_hash_lock[(hash) % INODE_TABLE_HASH_SHARDS])
+
+#define name_hash_lock(table, hash)                                     \
+        (&(table)->name_hash_lock[(hash) % INODE_TABLE_HASH_SHARDS])
+
+
+/* takes a reference only if the inode already has one, which needs no
+ * table lock as it moves the inode across no list.
+ */
+static inode_t *
+__inode_ref_active (inode_t *inode)
+{
+        uint32_t ref = 0;
+
+        do {
+                ref = inode->ref;
+                if (!ref)
+                        return NULL;
+        } while (!GF_ATOMIC_CAS (inode->ref, ref, ref + 1));
+
+        return inode;
+}
+
+
+/* drops a reference unless it is the last one */
+static inode_t *
+__inode_unref_active (inode_t *inode)
+{
+        uint32_t ref = 0;
+
+        do {
+                ref = inode->ref;
+                if (ref <= 1)
+                        return NULL;
+        } while (!GF_ATOMIC_CAS (inode->ref, ref, ref - 1));
+
+        return inode;
+}
+
+
 static void
 __dentry_hash (dentry_t *dentry)
 {
@@ -102,8 +143,12 @@ __dentry_hash (dentry_t *dentry)
         hash = hash_dentry (dentry->parent, dentry->name,
                             table->hashsize);
 
-        list_del_init (&dentry->hash);
-        list_add (&dentry->hash, &table->name_hash[hash]);
+        LOCK (name_hash_lock (table, hash));
+        {
+                list_del_init (&dentry->hash);
+                list_add (&dentry->hash, &table->name_hash[hash]);
+        }
+        UNLOCK (name_hash_lock (table, hash));
 }
 
 
@@ -122,12 +167,26 @@ __is_dentry_hashed (dentry_t *dentry)
 static void
 __dentry_unhash (dentry_t *dentry)
 {
+        inode_table_t   *table = NULL;
+        int              hash = 0;
+
         if (!dentry) {
                 gf_log_callingfn ("", GF_LOG_WARNING, "dentry not found");
                 return;
         }
 
-        list_del_init (&dentry->hash);
+        if (list_empty (&dentry->hash))
+                return;
+
+        table = dentry->inode->table;
+        hash = hash_dentry (dentry->parent, dentry->name,
+                            table->hashsize);
+
+        LOCK (name_hash_lock (table, hash));
+        {
+                list_del_init (&dentry->hash);
+        }
+        UNLOCK (name_hash_lock (table, hash));
 }
 
 
@@ -239,12 +298,25 @@ __is_dentry_cyclic (dentry_t *dentry)
 static void
 __inode_unhash (inode_t *inode)
 {
+        inode_table_t *table = NULL;
+        int            hash = 0;
+
         if (!inode) {
                 gf_log_callingfn ("", GF_LOG_WARNING, "inode not found");
                 return;
         }
 
-        list_del_init (&inode->hash);
+        if (list_empty (&inode->hash))
+                return;
+
+        table = inode->table;
+        hash = hash_gfid (inode->gfid, 65536);
+
+        LOCK (inode_hash_lock (table, hash));
+        {
+                list_del_init (&inode->hash);
+        }
+        UNLOCK (inode_hash_lock (table, hash));
 }
 
 
@@ -274,8 +346,12 @@ __inode_hash (inode_t *inode)
         table = inode->table;
         hash = hash_gfid (inode->gfid, 65536);
 
-        list_del_init (&inode->hash);
-        list_add (&inode->hash, &table->inode_hash[hash]);
+        LOCK (inode_hash_lock (table, hash));
+        {
+                list_del_init (&inode->hash);
+                list_add (&inode->hash, &table->inode_hash[hash]);
+        }
+        UNLOCK (inode_hash_lock (table, hash));
 }
 
 
@@ -321,7 +397,8 @@ __inode_destroy (inode_t *inode)
 
         tmp_pool = inode->table->inode_pool;
 
-        for (index = 0; index < inode->table->xl->graph->xl_count; index++) {
+        for (index = 0; index < (inode->table->xl->graph->xl_count +
+                                 XLATOR_CTX_FOREIGN_SLOTS); index++) {
                 if (inode->_ctx[index].xl_key) {
                         xl = (xlator_t *)(long)inode->_ctx[index].xl_key;
                         old_THIS = THIS;
@@ -407,9 +484,7 @@ __inode_unref (inode_t *inode)
 
         GF_ASSERT (inode->ref);
 
-        --inode->ref;
-
-        if (!inode->ref) {
+        if (!GF_ATOMIC_DEC (inode->ref)) {
                 inode->table->active_size--;
 
                 if (inode->nlookup)
@@ -428,11 +503,13 @@ __inode_ref (inode_t *inode)
         if (!inode)
                 return NULL;
 
+        /* a zero count cannot change under us: the lock-free paths only
+           act on inodes holding a reference already */
         if (!inode->ref) {
                 inode->table->lru_size--;
                 __inode_activate (inode);
         }
-        inode->ref++;
+        GF_ATOMIC_INC (inode->ref);
 
         return inode;
 }
@@ -446,6 +523,12 @@ inode_unref (inode_t *inode)
         if (!inode)
                 return NULL;
 
+        if (inode->ino == 1)
+                return inode;
+
+        if (__inode_unref_active (inode))
+                return inode;
+
         table = inode->table;
 
         pthread_mutex_lock (&table->lock);
@@ -468,6 +551,9 @@ inode_ref (inode_t *inode)
         if (!inode)
                 return NULL;
 
+        if (__inode_ref_active (inode))
+                return inode;
+
         table = inode->table;
 
         pthread_mutex_lock (&table->lock);
@@ -542,7 +628,8 @@ __inode_create (inode_table_t *table)
         INIT_LIST_HEAD (&newi->dentry_list);
 
         newi->_ctx = GF_CALLOC (1, (sizeof (struct _inode_ctx) *
-                                    table->xl->graph->xl_count),
+                                    (table->xl->graph->xl_count +
+                                     XLATOR_CTX_FOREIGN_SLOTS)),
                                 gf_common_mt_inode_ctx);
 
         if (newi->_ctx == NULL) {
@@ -641,6 +728,7 @@ inode_grep (inode_table_t *table, inode_t *parent, const char *name)
 {
         inode_t   *inode = NULL;
         dentry_t  *dentry = NULL;
+        int        hash = 0;
 
         if (!table || !parent || !name) {
                 gf_log_callingfn ("", GF_LOG_WARNING,
@@ -648,6 +736,20 @@ inode_grep (inode_table_t *table, inode_t *parent, const char *name)
                 return NULL;
         }
 
+        hash = hash_dentry (parent, name, table->hashsize);
+
+        LOCK (name_hash_lock (table, hash));
+        {
+                dentry = __dentry_grep (table, parent, name);
+                if (dentry)
+                        inode = __inode_ref_active (dentry->inode);
+        }
+        UNLOCK (name_hash_lock (table, hash));
+
+        if (inode || !dentry)
+                return inode;
+
+        /* found an idle inode, which has to be moved off the lru list */
         pthread_mutex_lock (&table->lock);
         {
                 dentry = __dentry_grep (table, parent, name);
@@ -719,12 +821,34 @@ inode_t *
 inode_find (inode_table_t *table, uuid_t gfid)
 {
         inode_t   *inode = NULL;
+        inode_t   *found = NULL;
+        int        hash = 0;
 
         if (!table) {
                 gf_log_callingfn ("", GF_LOG_WARNING, "table not found");
                 return NULL;
         }
 
+        if (__is_root_gfid (gfid) == 0) {
+                inode = __inode_ref_active (table->root);
+                if (inode)
+                        return inode;
+        } else {
+                hash = hash_gfid (gfid, 65536);
+
+                LOCK (inode_hash_lock (table, hash));
+                {
+                        inode = __inode_find (table, gfid);
+                        if (inode)
+                                found = __inode_ref_active (inode);
+                }
+                UNLOCK (inode_hash_lock (table, hash));
+
+                if (!inode || found)
+                        return inode;
+        }
+
+        /* found an idle inode, which has to be moved off the lru list */
         pthread_mutex_lock (&table->lock);
         {
                 inode = __inode_find (table, gfid);
@@ -1220,6 +1344,11 @@ inode_table_new (size_t lru_limit, xlator_t *xl)
                 INIT_LIST_HEAD (&new->name_hash[i]);
         }
 
+        for (i = 0; i < INODE_TABLE_HASH_SHARDS; i++) {
+                LOCK_INIT (&new->inode_hash_lock[i]);
+                LOCK_INIT (&new->name_hash_lock[i]);
+        }
+
         INIT_LIST_HEAD (&new->active);
         INIT_LIST_HEAD (&new->lru);
         INIT_LIST_HEAD (&new->purge);
@@ -1298,30 +1427,50 @@ out:
 }
 
 
+/* the slot of @xlator in the ctx array of @inode, or -1 if it has none
+ * (with @put, if no free one is left either). an xlator of the graph
+ * which owns the table always lives at its xl_id.
+ */
+static int
+__inode_ctx_index (inode_t *inode, xlator_t *xlator, int put)
+{
+        int count    = 0;
+        int index    = 0;
+        int free_idx = -1;
+
+        count = inode->table->xl->graph->xl_count;
+
+        if ((xlator->graph == inode->table->xl->graph)
+            && (xlator->xl_id < count)) {
+                index = xlator->xl_id;
+                if ((inode->_ctx[index].xl_key == xlator)
+                    || (put && !inode->_ctx[index].xl_key))
+                        return index;
+        }
+
+        for (index = count; index < count + XLATOR_CTX_FOREIGN_SLOTS;
+             index++) {
+                if (inode->_ctx[index].xl_key == xlator)
+                        return index;
+                if (!inode->_ctx[index].xl_key && (free_idx == -1))
+                        free_idx = index;
+        }
+
+        return (put ? free_idx : -1);
+}
+
+
 int
 __inode_ctx_put2 (inode_t *inode, xlator_t *xlator, uint64_t value1,
                   uint64_t value2)
 {
         int ret = 0;
-        int index = 0;
         int put_idx = -1;
 
         if (!inode || !xlator)
                 return -1;
 
-        for (index = 0; index < xlator->graph->xl_count; index++) {
-                if (!inode->_ctx[index].xl_key) {
-                        if (put_idx == -1)
-                                put_idx = index;
-                        /* dont break, to check if key already exists
-                           further on */
-                }
-                if (inode->_ctx[index].xl_key == xlator) {
-                        put_idx = index;
-                        break;
-                }
-        }
-
+        put_idx = __inode_ctx_index (inode, xlator, 1);
         if (put_idx == -1) {
                 ret = -1;
                 goto out;;
@@ -1364,12 +1513,8 @@ __inode_ctx_get2 (inode_t *inode, xlator_t *xlator, uint64_t *value1,
         if (!inode || !xlator)
                 return -1;
 
-        for (index = 0; index < xlator->graph->xl_count; index++) {
-                if (inode->_ctx[index].xl_key == xlator)
-                        break;
-        }
-
-        if (index == xlator->graph->xl_count) {
+        index = __inode_ctx_index (inode, xlator, 0);
+        if (index == -1) {
                 ret = -1;
                 goto out;
         }
@@ -1416,12 +1561,8 @@ inode_ctx_del2 (inode_t *inode, xlator_t *xlator, uint64_t *value1,
 
         LOCK (&inode->lock);
         {
-                for (index = 0; index < xlator->graph->xl_count; index++) {
-                        if (inode->_ctx[index].xl_key == xlator)
-                                break;
-                }
-
-                if (index == xlator->graph->xl_count) {
+                index = __inode_ctx_index (inode, xlator, 0);
+                if (index == -1) {
                         ret = -1;
                         goto unlock;
                 }
@@ -1484,6 +1625,7 @@ inode_dump (inode_t *inode, char *prefix)
         int                ret       = -1;
         xlator_t          *xl        = NULL;
         int                i         = 0;
+        int                ctx_count = 0;
         fd_t              *fd        = NULL;
         struct _inode_ctx *inode_ctx = NULL;
         struct  fd_wrapper {
@@ -1496,6 +1638,8 @@ inode_dump (inode_t *inode, char *prefix)
                 return;
 
         INIT_LIST_HEAD (&fd_list);
+        ctx_count = inode->table->xl->graph->xl_count
+                + XLATOR_CTX_FOREIGN_SLOTS;
 
         ret = TRY_LOCK(&inode->lock);
 
@@ -1517,14 +1661,14 @@ inode_dump (inode_t *inode, char *prefix)
                 gf_proc_dump_build_key(key, prefix, "ia_type");
                 gf_proc_dump_write(key, "%d", inode->ia_type);
                 if (inode->_ctx) {
-                        inode_ctx = GF_CALLOC (inode->table->xl->graph->xl_count,
+                        inode_ctx = GF_CALLOC (ctx_count,
                                                sizeof (*inode_ctx),
                                                gf_common_mt_inode_ctx);
                         if (inode_ctx == NULL) {
                                 goto unlock;
                         }
 
-                        for (i = 0; i < inode->table->xl->graph->xl_count; i++) {
+                        for (i = 0; i < ctx_count; i++) {
                                 inode_ctx[i] = inode->_ctx[i];
                         }
                 }
@@ -1550,7 +1694,7 @@ unlock:
         UNLOCK(&inode->lock);
 
         if (inode_ctx && (dump_options.xl_options.dump_inodectx == _gf_true)) {
-                for (i = 0; i < inode->table->xl->graph->xl_count; i++) {
+                for (i = 0; i < ctx_count; i++) {
                         if (inode_ctx[i].xl_key) {
                                 xl = (xlator_t *)(long)inode_ctx[i].xl_key;
                                 if (xl->dumpops && xl->dumpops->inodectx)
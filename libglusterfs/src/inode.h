@@ -29,6 +29,7 @@
 #include <sys/types.h>
 
 #define DEFAULT_INODE_MEMPOOL_ENTRIES   16384
+#define INODE_TABLE_HASH_SHARDS         64
 struct _inode_table;
 typedef struct _inode_table inode_table_t;
 
@@ -53,6 +54,10 @@ struct _inode_table {
         uint32_t           lru_limit;   /* maximum LRU cache size */
         struct list_head  *inode_hash;  /* buckets for inode hash table */
         struct list_head  *name_hash;   /* buckets for dentry hash table */
+        /* bucket i of either hash is guarded by lock i % shards, taken
+           after table->lock when both are needed */
+        gf_lock_t          inode_hash_lock[INODE_TABLE_HASH_SHARDS];
+        gf_lock_t          name_hash_lock[INODE_TABLE_HASH_SHARDS];
         struct list_head   active;      /* list of inodes currently active (in an fop) */
         uint32_t           active_size; /* count of inodes in active list */
         struct list_head   lru;         /* list of inodes recently used.
@@ -95,7 +100,8 @@ struct _inode {
         uuid_t               gfid;
         gf_lock_t            lock;
         uint64_t             nlookup;
-        uint32_t             ref;           /* reference count on this inode */
+        uint32_t             ref;           /* reference count on this inode,
+                                               0 <-> 1 only under table->lock */
         ino_t                ino;           /* inode number in the storage (persistent) */
         ia_type_t            ia_type;       /* what kind of file */
         struct list_head     fd_list;       /* list of open files on this inode */
@@ -27,21 +27,44 @@
   TODO: implement destroy margins and prefetching of arenas
 */
 
+int
+gf_iobuf_get_arena_index (size_t page_size)
+{
+        int i = 0;
+
+        for (i = 0; i < GF_IOBUF_ARENA_MAX_INDEX; i++) {
+                if (page_size <= (1UL << (i + GF_IOBUF_MIN_PAGE_SHIFT)))
+                        return i;
+        }
+
+        return -1;
+}
+
+
+size_t
+gf_iobuf_get_arena_size (struct iobuf_pool *iobuf_pool, size_t page_size)
+{
+        size_t arena_size = 0;
+
+        arena_size = min (page_size * GF_IOBUF_ARENA_MAX_PAGES,
+                          iobuf_pool->arena_size);
+        arena_size = max (arena_size, page_size * GF_IOBUF_ARENA_MIN_PAGES);
+
+        return arena_size;
+}
+
+
 void
 __iobuf_arena_init_iobufs (struct iobuf_arena *iobuf_arena)
 {
-        size_t              arena_size = 0;
-        size_t              page_size = 0;
         int                 iobuf_cnt = 0;
         struct iobuf       *iobuf = NULL;
-        int                 offset = 0;
+        size_t              offset = 0;
         int                 i = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_arena, out);
 
-        arena_size = iobuf_arena->iobuf_pool->arena_size;
-        page_size  = iobuf_arena->iobuf_pool->page_size;
-        iobuf_cnt  = arena_size / page_size;
+        iobuf_cnt  = iobuf_arena->page_count;
 
         iobuf_arena->iobufs = GF_CALLOC (sizeof (*iobuf), iobuf_cnt,
                                          gf_common_mt_iobuf);
@@ -51,7 +74,6 @@ __iobuf_arena_init_iobufs (struct iobuf_arena *iobuf_arena)
         iobuf = iobuf_arena->iobufs;
         for (i = 0; i < iobuf_cnt; i++) {
                 INIT_LIST_HEAD (&iobuf->list);
-                LOCK_INIT (&iobuf->lock);
 
                 iobuf->iobuf_arena = iobuf_arena;
 
@@ -60,7 +82,7 @@ __iobuf_arena_init_iobufs (struct iobuf_arena *iobuf_arena)
                 list_add (&iobuf->list, &iobuf_arena->passive.list);
                 iobuf_arena->passive_cnt++;
 
-                offset += page_size;
+                offset += iobuf_arena->page_size;
                 iobuf++;
         }
 
@@ -72,17 +94,13 @@ out:
 void
 __iobuf_arena_destroy_iobufs (struct iobuf_arena *iobuf_arena)
 {
-        size_t              arena_size = 0;
-        size_t              page_size = 0;
         int                 iobuf_cnt = 0;
         struct iobuf       *iobuf = NULL;
         int                 i = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_arena, out);
 
-        arena_size = iobuf_arena->iobuf_pool->arena_size;
-        page_size  = iobuf_arena->iobuf_pool->page_size;
-        iobuf_cnt  = arena_size / page_size;
+        iobuf_cnt  = iobuf_arena->page_count;
 
         if (!iobuf_arena->iobufs) {
                 gf_log_callingfn ("", GF_LOG_DEBUG, "iobufs not found");
@@ -107,17 +125,13 @@ out:
 void
 __iobuf_arena_destroy (struct iobuf_arena *iobuf_arena)
 {
-        struct iobuf_pool *iobuf_pool = NULL;
-
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_arena, out);
 
-        iobuf_pool = iobuf_arena->iobuf_pool;
-
         __iobuf_arena_destroy_iobufs (iobuf_arena);
 
         if (iobuf_arena->mem_base
             && iobuf_arena->mem_base != MAP_FAILED)
-                munmap (iobuf_arena->mem_base, iobuf_pool->arena_size);
+                munmap (iobuf_arena->mem_base, iobuf_arena->arena_size);
 
         GF_FREE (iobuf_arena);
 
@@ -127,10 +141,10 @@ out:
 
 
 struct iobuf_arena *
-__iobuf_arena_alloc (struct iobuf_pool *iobuf_pool)
+__iobuf_arena_alloc (struct iobuf_pool *iobuf_pool, size_t page_size,
+                     size_t arena_size)
 {
         struct iobuf_arena *iobuf_arena = NULL;
-        size_t              arena_size = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
@@ -144,7 +158,11 @@ __iobuf_arena_alloc (struct iobuf_pool *iobuf_pool)
         INIT_LIST_HEAD (&iobuf_arena->passive.list);
         iobuf_arena->iobuf_pool = iobuf_pool;
 
-        arena_size = iobuf_pool->arena_size;
+        iobuf_arena->index = gf_iobuf_get_arena_index (page_size);
+        iobuf_arena->page_size = page_size;
+        iobuf_arena->arena_size = arena_size;
+        iobuf_arena->page_count = arena_size / page_size;
+
         iobuf_arena->mem_base = mmap (NULL, arena_size, PROT_READ|PROT_WRITE,
                                       MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
         if (iobuf_arena->mem_base == MAP_FAILED) {
@@ -158,8 +176,6 @@ __iobuf_arena_alloc (struct iobuf_pool *iobuf_pool)
                 goto err;
         }
 
-        iobuf_pool->arena_cnt++;
-
         return iobuf_arena;
 
 err:
@@ -171,14 +187,14 @@ out:
 
 
 struct iobuf_arena *
-__iobuf_arena_unprune (struct iobuf_pool *iobuf_pool)
+__iobuf_arena_unprune (struct iobuf_pool *iobuf_pool, int index)
 {
         struct iobuf_arena *iobuf_arena = NULL;
         struct iobuf_arena *tmp = NULL;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
-        list_for_each_entry (tmp, &iobuf_pool->purge.list, list) {
+        list_for_each_entry (tmp, &iobuf_pool->purge[index].list, list) {
                 list_del_init (&tmp->list);
                 iobuf_arena = tmp;
                 break;
@@ -190,23 +206,30 @@ out:
 
 
 struct iobuf_arena *
-__iobuf_pool_add_arena (struct iobuf_pool *iobuf_pool)
+__iobuf_pool_add_arena (struct iobuf_pool *iobuf_pool, int index)
 {
         struct iobuf_arena *iobuf_arena = NULL;
+        size_t              page_size = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
-        iobuf_arena = __iobuf_arena_unprune (iobuf_pool);
+        iobuf_arena = __iobuf_arena_unprune (iobuf_pool, index);
 
-        if (!iobuf_arena)
-                iobuf_arena = __iobuf_arena_alloc (iobuf_pool);
+        if (!iobuf_arena) {
+                page_size = 1UL << (index + GF_IOBUF_MIN_PAGE_SHIFT);
+                iobuf_arena = __iobuf_arena_alloc
+                        (iobuf_pool, page_size,
+                         gf_iobuf_get_arena_size (iobuf_pool, page_size));
+                if (iobuf_arena)
+                        iobuf_pool->arena_cnt++;
+        }
 
         if (!iobuf_arena) {
                 gf_log ("", GF_LOG_WARNING, "arena not found");
                 return NULL;
         }
 
-        list_add_tail (&iobuf_arena->list, &iobuf_pool->arenas.list);
+        list_add_tail (&iobuf_arena->list, &iobuf_pool->arenas[index].list);
 
 out:
         return iobuf_arena;
@@ -214,7 +237,7 @@ out:
 
 
 struct iobuf_arena *
-iobuf_pool_add_arena (struct iobuf_pool *iobuf_pool)
+iobuf_pool_add_arena (struct iobuf_pool *iobuf_pool, int index)
 {
         struct iobuf_arena *iobuf_arena = NULL;
 
@@ -222,7 +245,7 @@ iobuf_pool_add_arena (struct iobuf_pool *iobuf_pool)
 
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
-                iobuf_arena = __iobuf_pool_add_arena (iobuf_pool);
+                iobuf_arena = __iobuf_pool_add_arena (iobuf_pool, index);
         }
         pthread_mutex_unlock (&iobuf_pool->mutex);
 
@@ -232,21 +255,37 @@ out:
 
 
 void
-iobuf_pool_destroy (struct iobuf_pool *iobuf_pool)
+__iobuf_pool_destroy_arenas (struct iobuf_pool *iobuf_pool,
+                             struct iobuf_arena *head)
 {
         struct iobuf_arena *iobuf_arena = NULL;
         struct iobuf_arena *tmp = NULL;
 
-        GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
-
-        list_for_each_entry_safe (iobuf_arena, tmp, &iobuf_pool->arenas.list,
-                                  list) {
+        list_for_each_entry_safe (iobuf_arena, tmp, &head->list, list) {
 
                 list_del_init (&iobuf_arena->list);
                 iobuf_pool->arena_cnt--;
 
                 __iobuf_arena_destroy (iobuf_arena);
         }
+}
+
+
+void
+iobuf_pool_destroy (struct iobuf_pool *iobuf_pool)
+{
+        int                 i = 0;
+
+        GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
+
+        for (i = 0; i < GF_IOBUF_ARENA_MAX_INDEX; i++) {
+                __iobuf_pool_destroy_arenas (iobuf_pool,
+                                             &iobuf_pool->arenas[i]);
+                __iobuf_pool_destroy_arenas (iobuf_pool,
+                                             &iobuf_pool->filled[i]);
+                __iobuf_pool_destroy_arenas (iobuf_pool,
+                                             &iobuf_pool->purge[i]);
+        }
 
 out:
         return;
@@ -257,6 +296,8 @@ struct iobuf_pool *
 iobuf_pool_new (size_t arena_size, size_t page_size)
 {
         struct iobuf_pool  *iobuf_pool = NULL;
+        int                 index = 0;
+        int                 i = 0;
 
         if (arena_size < page_size) {
                 gf_log ("", GF_LOG_WARNING,
@@ -265,40 +306,52 @@ iobuf_pool_new (size_t arena_size, size_t page_size)
                 return NULL;
         }
 
+        index = gf_iobuf_get_arena_index (page_size);
+        if (index == -1) {
+                gf_log ("", GF_LOG_WARNING,
+                        "page size (%zu) is more than the largest iobuf size"
+                        " class (%lu)", page_size, GF_IOBUF_MAX_PAGE_SIZE);
+                return NULL;
+        }
+
         iobuf_pool = GF_CALLOC (sizeof (*iobuf_pool), 1,
                                 gf_common_mt_iobuf_pool);
         if (!iobuf_pool)
                 return NULL;
 
         pthread_mutex_init (&iobuf_pool->mutex, NULL);
-        INIT_LIST_HEAD (&iobuf_pool->arenas.list);
-        INIT_LIST_HEAD (&iobuf_pool->filled.list);
-        INIT_LIST_HEAD (&iobuf_pool->purge.list);
+        for (i = 0; i < GF_IOBUF_ARENA_MAX_INDEX; i++) {
+                INIT_LIST_HEAD (&iobuf_pool->arenas[i].list);
+                INIT_LIST_HEAD (&iobuf_pool->filled[i].list);
+                INIT_LIST_HEAD (&iobuf_pool->purge[i].list);
+        }
 
         iobuf_pool->arena_size = arena_size;
-        iobuf_pool->page_size  = page_size;
+        iobuf_pool->page_size  = 1UL << (index + GF_IOBUF_MIN_PAGE_SHIFT);
 
-        iobuf_pool_add_arena (iobuf_pool);
+        /* only the default size class is populated up front, the rest are
+           created on first use */
+        iobuf_pool_add_arena (iobuf_pool, index);
 
         return iobuf_pool;
 }
 
 
 void
-__iobuf_pool_prune (struct iobuf_pool *iobuf_pool)
+__iobuf_pool_prune (struct iobuf_pool *iobuf_pool, int index)
 {
         struct iobuf_arena *iobuf_arena = NULL;
         struct iobuf_arena *tmp = NULL;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
-        if (list_empty (&iobuf_pool->arenas.list))
+        if (list_empty (&iobuf_pool->arenas[index].list))
                 /* buffering - preserve this one arena (if at all)
                    for __iobuf_arena_unprune */
                 return;
 
-        list_for_each_entry_safe (iobuf_arena, tmp, &iobuf_pool->purge.list,
-                                  list) {
+        list_for_each_entry_safe (iobuf_arena, tmp,
+                                  &iobuf_pool->purge[index].list, list) {
                 if (iobuf_arena->active_cnt)
                         continue;
 
@@ -314,13 +367,13 @@ out:
 
 
 void
-iobuf_pool_prune (struct iobuf_pool *iobuf_pool)
+iobuf_pool_prune (struct iobuf_pool *iobuf_pool, int index)
 {
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
-                __iobuf_pool_prune (iobuf_pool);
+                __iobuf_pool_prune (iobuf_pool, index);
         }
         pthread_mutex_unlock (&iobuf_pool->mutex);
 
@@ -330,7 +383,7 @@ out:
 
 
 struct iobuf_arena *
-__iobuf_select_arena (struct iobuf_pool *iobuf_pool)
+__iobuf_select_arena (struct iobuf_pool *iobuf_pool, int index)
 {
         struct iobuf_arena *iobuf_arena = NULL;
         struct iobuf_arena *trav = NULL;
@@ -338,7 +391,7 @@ __iobuf_select_arena (struct iobuf_pool *iobuf_pool)
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
         /* look for unused iobuf from the head-most arena */
-        list_for_each_entry (trav, &iobuf_pool->arenas.list, list) {
+        list_for_each_entry (trav, &iobuf_pool->arenas[index].list, list) {
                 if (trav->passive_cnt) {
                         iobuf_arena = trav;
                         break;
@@ -347,7 +400,7 @@ __iobuf_select_arena (struct iobuf_pool *iobuf_pool)
 
         if (!iobuf_arena) {
                 /* all arenas were full */
-                iobuf_arena = __iobuf_pool_add_arena (iobuf_pool);
+                iobuf_arena = __iobuf_pool_add_arena (iobuf_pool, index);
         }
 
 out:
@@ -392,9 +445,10 @@ __iobuf_get (struct iobuf_arena *iobuf_arena)
         list_add (&iobuf->list, &iobuf_arena->active.list);
         iobuf_arena->active_cnt++;
 
-        if (iobuf_arena->passive_cnt == 0) {
+        if ((iobuf_arena->passive_cnt == 0) && (iobuf_arena->index != -1)) {
                 list_del (&iobuf_arena->list);
-                list_add (&iobuf_arena->list, &iobuf_pool->filled.list);
+                list_add (&iobuf_arena->list,
+                          &iobuf_pool->filled[iobuf_arena->index].list);
         }
 
 out:
@@ -403,17 +457,57 @@ out:
 
 
 struct iobuf *
-iobuf_get (struct iobuf_pool *iobuf_pool)
+iobuf_get_standalone (struct iobuf_pool *iobuf_pool, size_t page_size)
+{
+        struct iobuf       *iobuf = NULL;
+        struct iobuf_arena *iobuf_arena = NULL;
+
+        /* a private single-page arena, unmapped again in iobuf_put */
+        page_size = roof (page_size, GF_IOBUF_MIN_PAGE_SIZE);
+
+        pthread_mutex_lock (&iobuf_pool->mutex);
+        {
+                iobuf_arena = __iobuf_arena_alloc (iobuf_pool, page_size,
+                                                   page_size);
+                if (!iobuf_arena) {
+                        gf_log ("", GF_LOG_WARNING, "arena not found");
+                        goto unlock;
+                }
+
+                iobuf_pool->standalone_cnt++;
+
+                iobuf = __iobuf_get (iobuf_arena);
+                __iobuf_ref (iobuf);
+        }
+unlock:
+        pthread_mutex_unlock (&iobuf_pool->mutex);
+
+        return iobuf;
+}
+
+
+struct iobuf *
+iobuf_get2 (struct iobuf_pool *iobuf_pool, size_t page_size)
 {
         struct iobuf       *iobuf = NULL;
         struct iobuf_arena *iobuf_arena = NULL;
+        int                 index = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
+        if (page_size == 0)
+                page_size = iobuf_pool->page_size;
+
+        index = gf_iobuf_get_arena_index (page_size);
+        if (index == -1) {
+                iobuf = iobuf_get_standalone (iobuf_pool, page_size);
+                goto out;
+        }
+
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
                 /* most eligible arena for picking an iobuf */
-                iobuf_arena = __iobuf_select_arena (iobuf_pool);
+                iobuf_arena = __iobuf_select_arena (iobuf_pool, index);
                 if (!iobuf_arena) {
                         gf_log ("", GF_LOG_WARNING, "arena not found");
                         goto unlock;
@@ -435,19 +529,33 @@ out:
 }
 
 
+struct iobuf *
+iobuf_get (struct iobuf_pool *iobuf_pool)
+{
+        GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
+
+        return iobuf_get2 (iobuf_pool, iobuf_pool->page_size);
+out:
+        return NULL;
+}
+
+
 void
 __iobuf_put (struct iobuf *iobuf, struct iobuf_arena *iobuf_arena)
 {
         struct iobuf_pool *iobuf_pool = NULL;
+        int                index = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_arena, out);
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf, out);
 
         iobuf_pool = iobuf_arena->iobuf_pool;
+        index = iobuf_arena->index;
 
         if (iobuf_arena->passive_cnt == 0) {
                 list_del (&iobuf_arena->list);
-                list_add_tail (&iobuf_arena->list, &iobuf_pool->arenas.list);
+                list_add_tail (&iobuf_arena->list,
+                               &iobuf_pool->arenas[index].list);
         }
 
         list_del_init (&iobuf->list);
@@ -458,7 +566,8 @@ __iobuf_put (struct iobuf *iobuf, struct iobuf_arena *iobuf_arena)
 
         if (iobuf_arena->active_cnt == 0) {
                 list_del (&iobuf_arena->list);
-                list_add_tail (&iobuf_arena->list, &iobuf_pool->purge.list);
+                list_add_tail (&iobuf_arena->list,
+                               &iobuf_pool->purge[index].list);
         }
 out:
         return;
@@ -470,6 +579,7 @@ iobuf_put (struct iobuf *iobuf)
 {
         struct iobuf_arena *iobuf_arena = NULL;
         struct iobuf_pool  *iobuf_pool = NULL;
+        int                 index = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf, out);
 
@@ -485,13 +595,29 @@ iobuf_put (struct iobuf *iobuf)
                 return;
         }
 
+        if (iobuf_arena->index == -1) {
+                pthread_mutex_lock (&iobuf_pool->mutex);
+                {
+                        iobuf_pool->standalone_cnt--;
+                }
+                pthread_mutex_unlock (&iobuf_pool->mutex);
+
+                list_del_init (&iobuf->list);
+                __iobuf_arena_destroy (iobuf_arena);
+                goto out;
+        }
+
+        /* the arena may be pruned by someone else once the mutex is
+           dropped, do not touch it after that */
+        index = iobuf_arena->index;
+
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
                 __iobuf_put (iobuf, iobuf_arena);
         }
         pthread_mutex_unlock (&iobuf_pool->mutex);
 
-        iobuf_pool_prune (iobuf_pool);
+        iobuf_pool_prune (iobuf_pool, index);
 
 out:
         return;
@@ -505,12 +631,7 @@ iobuf_unref (struct iobuf *iobuf)
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf, out);
 
-        LOCK (&iobuf->lock);
-        {
-                __iobuf_unref (iobuf);
-                ref = iobuf->ref;
-        }
-        UNLOCK (&iobuf->lock);
+        ref = GF_ATOMIC_DEC (iobuf->ref);
 
         if (!ref)
                 iobuf_put (iobuf);
@@ -525,11 +646,7 @@ iobuf_ref (struct iobuf *iobuf)
 {
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf, out);
 
-        LOCK (&iobuf->lock);
-        {
-                __iobuf_ref (iobuf);
-        }
-        UNLOCK (&iobuf->lock);
+        GF_ATOMIC_INC (iobuf->ref);
 
 out:
         return iobuf;
@@ -548,6 +665,9 @@ iobref_new ()
 
         LOCK_INIT (&iobref->lock);
 
+        iobref->iobrefs = iobref->inline_iobrefs;
+        iobref->alloced = GF_IOBREF_INLINE_COUNT;
+
         iobref->ref++;
 
         return iobref;
@@ -559,11 +679,7 @@ iobref_ref (struct iobref *iobref)
 {
         GF_VALIDATE_OR_GOTO ("iobuf", iobref, out);
 
-        LOCK (&iobref->lock);
-        {
-                iobref->ref++;
-        }
-        UNLOCK (&iobref->lock);
+        GF_ATOMIC_INC (iobref->ref);
 
 out:
         return iobref;
@@ -578,7 +694,7 @@ iobref_destroy (struct iobref *iobref)
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobref, out);
 
-        for (i = 0; i < 8; i++) {
+        for (i = 0; i < iobref->used; i++) {
                 iobuf = iobref->iobrefs[i];
 
                 iobref->iobrefs[i] = NULL;
@@ -586,6 +702,11 @@ iobref_destroy (struct iobref *iobref)
                         iobuf_unref (iobuf);
         }
 
+        if (iobref->iobrefs != iobref->inline_iobrefs)
+                GF_FREE (iobref->iobrefs);
+
+        LOCK_DESTROY (&iobref->lock);
+
         GF_FREE (iobref);
 
 out:
@@ -600,11 +721,7 @@ iobref_unref (struct iobref *iobref)
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobref, out);
 
-        LOCK (&iobref->lock);
-        {
-                ref = (--iobref->ref);
-        }
-        UNLOCK (&iobref->lock);
+        ref = GF_ATOMIC_DEC (iobref->ref);
 
         if (!ref)
                 iobref_destroy (iobref);
@@ -614,23 +731,53 @@ out:
 }
 
 
+int
+__iobref_grow (struct iobref *iobref)
+{
+        struct iobuf **iobrefs = NULL;
+        int            alloced = 0;
+
+        alloced = iobref->alloced * 2;
+
+        if (iobref->iobrefs == iobref->inline_iobrefs) {
+                iobrefs = GF_CALLOC (alloced, sizeof (*iobrefs),
+                                     gf_common_mt_iobrefs);
+                if (!iobrefs)
+                        return -ENOMEM;
+
+                memcpy (iobrefs, iobref->inline_iobrefs,
+                        sizeof (iobref->inline_iobrefs));
+        } else {
+                iobrefs = GF_REALLOC (iobref->iobrefs,
+                                      alloced * sizeof (*iobrefs));
+                if (!iobrefs)
+                        return -ENOMEM;
+        }
+
+        iobref->iobrefs = iobrefs;
+        iobref->alloced = alloced;
+
+        return 0;
+}
+
+
 int
 __iobref_add (struct iobref *iobref, struct iobuf *iobuf)
 {
-        int  i = 0;
         int  ret = -ENOMEM;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobref, out);
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf, out);
 
-        for (i = 0; i < 8; i++) {
-                if (iobref->iobrefs[i] == NULL) {
-                        iobref->iobrefs[i] = iobuf_ref (iobuf);
-                        ret = 0;
-                        break;
-                }
+        if (iobref->used == iobref->alloced) {
+                ret = __iobref_grow (iobref);
+                if (ret)
+                        goto out;
         }
 
+        iobref->iobrefs[iobref->used++] = iobuf_ref (iobuf);
+        ret = 0;
+
 out:
         return ret;
 }
@@ -659,7 +806,7 @@ int
 iobref_merge (struct iobref *to, struct iobref *from)
 {
         int           i = 0;
-        int           ret = -1;
+        int           ret = 0;
         struct iobuf *iobuf = NULL;
 
         GF_VALIDATE_OR_GOTO ("iobuf", to, out);
@@ -667,12 +814,9 @@ iobref_merge (struct iobref *to, struct iobref *from)
 
         LOCK (&from->lock);
         {
-                for (i = 0; i < 8; i++) {
+                for (i = 0; i < from->used; i++) {
                         iobuf = from->iobrefs[i];
 
-                        if (!iobuf)
-                                break;
-
                         ret = iobref_add (to, iobuf);
 
                         if (ret < 0)
@@ -698,12 +842,7 @@ iobuf_size (struct iobuf *iobuf)
                 goto out;
         }
 
-        if (!iobuf->iobuf_arena->iobuf_pool) {
-                gf_log ("", GF_LOG_WARNING, "pool not found");
-                goto out;
-        }
-
-        size = iobuf->iobuf_arena->iobuf_pool->page_size;
+        size = iobuf_pagesize (iobuf);
 out:
         return size;
 }
@@ -719,10 +858,8 @@ iobref_size (struct iobref *iobref)
 
         LOCK (&iobref->lock);
         {
-                for (i = 0; i < 8; i++) {
-                        if (iobref->iobrefs[i])
-                                size += iobuf_size (iobref->iobrefs[i]);
-                }
+                for (i = 0; i < iobref->used; i++)
+                        size += iobuf_size (iobref->iobrefs[i]);
         }
         UNLOCK (&iobref->lock);
 
@@ -734,26 +871,13 @@ void
 iobuf_info_dump (struct iobuf *iobuf, const char *key_prefix)
 {
         char   key[GF_DUMP_MAX_BUF_LEN];
-        struct iobuf my_iobuf;
-        int    ret = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf, out);
 
-        memset(&my_iobuf, 0, sizeof(my_iobuf));
-
-        ret = TRY_LOCK(&iobuf->lock);
-        if (ret) {
-                gf_log("", GF_LOG_WARNING, "Unable to dump iobuf"
-                       " errno: %s", strerror (errno));
-                return;
-        }
-        memcpy(&my_iobuf, iobuf, sizeof(my_iobuf));
-        UNLOCK(&iobuf->lock);
-
         gf_proc_dump_build_key(key, key_prefix,"ref");
-        gf_proc_dump_write(key, "%d", my_iobuf.ref);
+        gf_proc_dump_write(key, "%d", GF_ATOMIC_GET (iobuf->ref));
         gf_proc_dump_build_key(key, key_prefix,"ptr");
-        gf_proc_dump_write(key, "%p", my_iobuf.ptr);
+        gf_proc_dump_write(key, "%p", iobuf->ptr);
 
 out:
         return;
@@ -770,6 +894,8 @@ iobuf_arena_info_dump (struct iobuf_arena *iobuf_arena, const char *key_prefix)
 
         gf_proc_dump_build_key(key, key_prefix,"mem_base");
         gf_proc_dump_write(key, "%p", iobuf_arena->mem_base);
+        gf_proc_dump_build_key(key, key_prefix, "page_size");
+        gf_proc_dump_write(key, "%zu", iobuf_arena->page_size);
         gf_proc_dump_build_key(key, key_prefix, "active_cnt");
         gf_proc_dump_write(key, "%d", iobuf_arena->active_cnt);
         gf_proc_dump_build_key(key, key_prefix, "passive_cnt");
@@ -791,6 +917,7 @@ iobuf_stats_dump (struct iobuf_pool *iobuf_pool)
         char               msg[1024];
         struct iobuf_arena *trav = NULL;
         int                i = 1;
+        int                j = 0;
         int                ret = -1;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
@@ -812,13 +939,24 @@ iobuf_stats_dump (struct iobuf_pool *iobuf_pool)
                            iobuf_pool->arena_size);
         gf_proc_dump_write("iobuf.global.iobuf_pool.arena_cnt", "%d",
                            iobuf_pool->arena_cnt);
-
-        list_for_each_entry (trav, &iobuf_pool->arenas.list, list) {
-                snprintf(msg, sizeof(msg), "iobuf.global.iobuf_pool.arena.%d",
-                         i);
-                gf_proc_dump_add_section(msg);
-                iobuf_arena_info_dump(trav,msg);
-                i++;
+        gf_proc_dump_write("iobuf.global.iobuf_pool.standalone_cnt", "%d",
+                           iobuf_pool->standalone_cnt);
+
+        for (j = 0; j < GF_IOBUF_ARENA_MAX_INDEX; j++) {
+                list_for_each_entry (trav, &iobuf_pool->arenas[j].list, list) {
+                        snprintf(msg, sizeof(msg),
+                                 "iobuf.global.iobuf_pool.arena.%d", i);
+                        gf_proc_dump_add_section(msg);
+                        iobuf_arena_info_dump(trav,msg);
+                        i++;
+                }
+                list_for_each_entry (trav, &iobuf_pool->filled[j].list, list) {
+                        snprintf(msg, sizeof(msg),
+                                 "iobuf.global.iobuf_pool.arena.%d", i);
+                        gf_proc_dump_add_section(msg);
+                        iobuf_arena_info_dump(trav,msg);
+                        i++;
+                }
         }
 
         pthread_mutex_unlock(&iobuf_pool->mutex);
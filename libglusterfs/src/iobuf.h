@@ -49,6 +49,20 @@ struct iobuf_arena;
 /* expandable and contractable pool of memory, internally broken into arenas */
 struct iobuf_pool;
 
+/* arenas are kept per size class, one class for every power of two
+   between 4KB and 1MB. Requests larger than the biggest class get an
+   arena of their own which is unmapped as soon as the iobuf is put back */
+#define GF_IOBUF_MIN_PAGE_SHIFT     12
+#define GF_IOBUF_MAX_PAGE_SHIFT     20
+#define GF_IOBUF_ARENA_MAX_INDEX    (GF_IOBUF_MAX_PAGE_SHIFT            \
+                                     - GF_IOBUF_MIN_PAGE_SHIFT + 1)
+#define GF_IOBUF_MIN_PAGE_SIZE      (1UL << GF_IOBUF_MIN_PAGE_SHIFT)
+#define GF_IOBUF_MAX_PAGE_SIZE      (1UL << GF_IOBUF_MAX_PAGE_SHIFT)
+
+/* bounds on the number of pages carved out of one arena */
+#define GF_IOBUF_ARENA_MIN_PAGES    8
+#define GF_IOBUF_ARENA_MAX_PAGES    256
+
 
 struct iobuf {
         union {
@@ -60,8 +74,8 @@ struct iobuf {
         };
         struct iobuf_arena  *iobuf_arena;
 
-        gf_lock_t            lock; /* for ->ptr and ->ref */
-        int                  ref;  /* 0 == passive, >0 == active */
+        int                  ref;  /* 0 == passive, >0 == active,
+                                      updated with GF_ATOMIC_* */
 
         void                *ptr;  /* usable memory region by the consumer */
 };
@@ -77,6 +91,11 @@ struct iobuf_arena {
         };
         struct iobuf_pool  *iobuf_pool;
 
+        int                 index;      /* size class, -1 if standalone */
+        size_t              page_size;  /* size of all iobufs in arena */
+        size_t              arena_size; /* size of memory region */
+        size_t              page_count;
+
         void               *mem_base;
         struct iobuf       *iobufs;     /* allocated iobufs list */
 
@@ -91,14 +110,20 @@ struct iobuf_arena {
 
 struct iobuf_pool {
         pthread_mutex_t     mutex;
-        size_t              page_size;  /* size of all iobufs in this pool */
-        size_t              arena_size; /* size of memory region in arena */
+        size_t              page_size;  /* default size, given out by
+                                           iobuf_get () */
+        size_t              arena_size; /* upper bound on the size of
+                                           memory region in arena */
 
         int                 arena_cnt;
-        struct iobuf_arena  arenas;     /* head node arena
+        int                 standalone_cnt;
+        struct iobuf_arena  arenas[GF_IOBUF_ARENA_MAX_INDEX];
+                                        /* head node arena
                                            (unused by itself) */
-        struct iobuf_arena  filled;     /* arenas without  free iobufs */
-        struct iobuf_arena  purge;      /* arenas which can be purged */
+        struct iobuf_arena  filled[GF_IOBUF_ARENA_MAX_INDEX];
+                                        /* arenas without free iobufs */
+        struct iobuf_arena  purge[GF_IOBUF_ARENA_MAX_INDEX];
+                                        /* arenas which can be purged */
 };
 
 
@@ -107,6 +132,7 @@ struct iobuf_pool {
 struct iobuf_pool *iobuf_pool_new (size_t arena_size, size_t page_size);
 void iobuf_pool_destroy (struct iobuf_pool *iobuf_pool);
 struct iobuf *iobuf_get (struct iobuf_pool *iobuf_pool);
+struct iobuf *iobuf_get2 (struct iobuf_pool *iobuf_pool, size_t page_size);
 void iobuf_unref (struct iobuf *iobuf);
 struct iobuf *iobuf_ref (struct iobuf *iobuf);
 void iobuf_pool_destroy (struct iobuf_pool *iobuf_pool);
@@ -114,13 +140,19 @@ void iobuf_to_iovec(struct iobuf *iob, struct iovec *iov);
 
 #define iobuf_ptr(iob) ((iob)->ptr)
 #define iobpool_pagesize(iobpool) ((iobpool)->page_size)
-#define iobuf_pagesize(iob) (iobpool_pagesize((iob)->iobuf_arena->iobuf_pool))
+#define iobuf_pagesize(iob) ((iob)->iobuf_arena->page_size)
+
 
+/* number of iobufs an iobref holds before it has to allocate */
+#define GF_IOBREF_INLINE_COUNT 8
 
 struct iobref {
-        gf_lock_t          lock;
-        int                ref;
-        struct iobuf      *iobrefs[8];
+        gf_lock_t          lock;     /* for ->iobrefs, ->alloced, ->used */
+        int                ref;      /* updated with GF_ATOMIC_* */
+        struct iobuf     **iobrefs;  /* ->inline_iobrefs or a heap vector */
+        int                alloced;
+        int                used;
+        struct iobuf      *inline_iobrefs[GF_IOBREF_INLINE_COUNT];
 };
 
 struct iobref *iobref_new ();
@@ -45,5 +45,14 @@ typedef pthread_spinlock_t gf_lock_t;
 typedef pthread_mutex_t gf_lock_t;
 #endif /* HAVE_SPINLOCK */
 
+/* lock-free counters for reference counts. These return the new value. */
+#define GF_ATOMIC_INC(x)  __sync_add_and_fetch (&(x), 1)
+#define GF_ATOMIC_DEC(x)  __sync_sub_and_fetch (&(x), 1)
+#define GF_ATOMIC_GET(x)  __sync_add_and_fetch (&(x), 0)
+#define GF_ATOMIC_ADD(x, n) __sync_add_and_fetch (&(x), (n))
+#define GF_ATOMIC_SUB(x, n) __sync_sub_and_fetch (&(x), (n))
+#define GF_ATOMIC_CAS(x, old, new)                              \
+        __sync_bool_compare_and_swap (&(x), (old), (new))
+
 
 #endif /* _LOCKING_H */
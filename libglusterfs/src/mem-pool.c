@@ -20,6 +20,7 @@
 #include "mem-pool.h"
 #include "logging.h"
 #include "xlator.h"
+#include "statedump.h"
 #include <stdlib.h>
 #include <stdarg.h>
 
@@ -310,9 +311,198 @@ free:
 
 
 
+/* Per-thread magazines
+ *
+ * Every thread which calls mem_get/mem_put is given a slot number in
+ * [0, GF_MEM_POOL_MAX_THREADS). Each pool keeps one magazine per slot,
+ * allocated lazily by the owning thread. Free chunks move between a
+ * magazine and the pool's depot (pool->list) in batches of half a
+ * magazine, so the pool lock is taken once per batch instead of once per
+ * allocation. When a thread exits its magazines are drained back into
+ * the depots of all pools and the slot is recycled.
+ */
+
+static pthread_key_t     mem_pool_thread_key;
+static int               mem_pool_thread_key_inited;
+static pthread_mutex_t   mem_pool_global_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct list_head  mem_pool_global_list = {&mem_pool_global_list,
+                                                 &mem_pool_global_list};
+static char              mem_pool_slots[GF_MEM_POOL_MAX_THREADS];
+
+/* value stored in the thread key when every slot is taken */
+#define GF_MEM_POOL_NO_SLOT    ((void *)(long)(GF_MEM_POOL_MAX_THREADS + 1))
+
+
+static void
+__mem_pool_magazine_drain (struct mem_pool *pool,
+                           struct mem_pool_magazine *mag, int count)
+{
+        struct list_head *list = NULL;
+
+        while (count-- && mag->count) {
+                list = mag->list.next;
+                list_del (list);
+                list_add (list, &pool->list);
+                mag->count--;
+                pool->hot_count--;
+                pool->cold_count++;
+        }
+}
+
+
+static void
+__mem_pool_magazine_refill (struct mem_pool *pool,
+                            struct mem_pool_magazine *mag, int count)
+{
+        struct list_head *list = NULL;
+
+        while (count-- && pool->cold_count) {
+                list = pool->list.next;
+                list_del (list);
+                list_add (list, &mag->list);
+                mag->count++;
+                pool->hot_count++;
+                pool->cold_count--;
+        }
+}
+
+
+static void
+mem_pool_thread_destroy (void *ptr)
+{
+        struct mem_pool          *pool = NULL;
+        struct mem_pool_magazine *mag = NULL;
+        long                      slot = 0;
+
+        if (!ptr || ptr == GF_MEM_POOL_NO_SLOT)
+                return;
+
+        slot = (long)ptr - 1;
+
+        pthread_mutex_lock (&mem_pool_global_lock);
+        {
+                list_for_each_entry (pool, &mem_pool_global_list,
+                                     global_list) {
+                        mag = pool->magazines[slot];
+                        if (!mag || !mag->count)
+                                continue;
+
+                        LOCK (&pool->lock);
+                        {
+                                __mem_pool_magazine_drain (pool, mag,
+                                                           mag->count);
+                        }
+                        UNLOCK (&pool->lock);
+                }
+
+                mem_pool_slots[slot] = 0;
+        }
+        pthread_mutex_unlock (&mem_pool_global_lock);
+}
+
+
+int
+mem_pool_thread_init (void)
+{
+        int  ret = 0;
+
+        if (mem_pool_thread_key_inited)
+                return 0;
+
+        ret = pthread_key_create (&mem_pool_thread_key,
+                                  mem_pool_thread_destroy);
+        if (ret != 0) {
+                gf_log ("mem-pool", GF_LOG_WARNING,
+                        "failed to create the pthread key");
+                return ret;
+        }
+
+        mem_pool_thread_key_inited = 1;
+
+        return ret;
+}
+
+
+static long
+mem_pool_thread_slot (void)
+{
+        void *value = NULL;
+        long  slot = 0;
+
+        if (!mem_pool_thread_key_inited)
+                return -1;
+
+        value = pthread_getspecific (mem_pool_thread_key);
+        if (value == GF_MEM_POOL_NO_SLOT)
+                return -1;
+
+        if (value)
+                return (long)value - 1;
+
+        value = GF_MEM_POOL_NO_SLOT;
+
+        pthread_mutex_lock (&mem_pool_global_lock);
+        {
+                for (slot = 0; slot < GF_MEM_POOL_MAX_THREADS; slot++) {
+                        if (mem_pool_slots[slot])
+                                continue;
+
+                        mem_pool_slots[slot] = 1;
+                        value = (void *)(slot + 1);
+                        break;
+                }
+        }
+        pthread_mutex_unlock (&mem_pool_global_lock);
+
+        if (pthread_setspecific (mem_pool_thread_key, value) != 0) {
+                if (value != GF_MEM_POOL_NO_SLOT) {
+                        pthread_mutex_lock (&mem_pool_global_lock);
+                        mem_pool_slots[slot] = 0;
+                        pthread_mutex_unlock (&mem_pool_global_lock);
+                }
+                return -1;
+        }
+
+        if (value == GF_MEM_POOL_NO_SLOT)
+                return -1;
+
+        return slot;
+}
+
+
+static struct mem_pool_magazine *
+mem_pool_thread_magazine (struct mem_pool *pool)
+{
+        struct mem_pool_magazine *mag = NULL;
+        long                      slot = -1;
+
+        if (!pool->magazine_size)
+                return NULL;
+
+        slot = mem_pool_thread_slot ();
+        if (slot < 0)
+                return NULL;
+
+        mag = pool->magazines[slot];
+        if (mag)
+                return mag;
+
+        /* the slot is private to this thread, nobody else can race on
+           creating the magazine */
+        mag = GF_CALLOC (1, sizeof (*mag), gf_common_mt_mem_pool_magazine);
+        if (!mag)
+                return NULL;
+
+        INIT_LIST_HEAD (&mag->list);
+        pool->magazines[slot] = mag;
+
+        return mag;
+}
+
+
 struct mem_pool *
 mem_pool_new_fn (unsigned long sizeof_type,
-                 unsigned long count)
+                 unsigned long count, const char *name)
 {
         struct mem_pool  *mem_pool = NULL;
         unsigned long     padded_sizeof_type = 0;
@@ -332,10 +522,19 @@ mem_pool_new_fn (unsigned long sizeof_type,
 
         LOCK_INIT (&mem_pool->lock);
         INIT_LIST_HEAD (&mem_pool->list);
+        INIT_LIST_HEAD (&mem_pool->global_list);
 
         mem_pool->padded_sizeof_type = padded_sizeof_type;
         mem_pool->cold_count = count;
         mem_pool->real_sizeof_type = sizeof_type;
+        mem_pool->name = name;
+
+        /* do not let magazines hoard a small pool; below two chunks per
+           magazine batching buys nothing */
+        mem_pool->magazine_size = min (GF_MEM_POOL_MAGAZINE_SIZE,
+                                       count / 16);
+        if (mem_pool->magazine_size < 2)
+                mem_pool->magazine_size = 0;
 
         pool = GF_CALLOC (count, padded_sizeof_type, gf_common_mt_long);
         if (!pool) {
@@ -352,6 +551,12 @@ mem_pool_new_fn (unsigned long sizeof_type,
         mem_pool->pool = pool;
         mem_pool->pool_end = pool + (count * (padded_sizeof_type));
 
+        pthread_mutex_lock (&mem_pool_global_lock);
+        {
+                list_add_tail (&mem_pool->global_list, &mem_pool_global_list);
+        }
+        pthread_mutex_unlock (&mem_pool_global_lock);
+
         return mem_pool;
 }
 
@@ -376,15 +581,46 @@ mem_get0 (struct mem_pool *mem_pool)
 void *
 mem_get (struct mem_pool *mem_pool)
 {
-        struct list_head *list = NULL;
-        void             *ptr = NULL;
-        int             *in_use = NULL;
+        struct list_head         *list = NULL;
+        void                     *ptr = NULL;
+        int                      *in_use = NULL;
+        struct mem_pool_magazine *mag = NULL;
 
         if (!mem_pool) {
                 gf_log ("mem-pool", GF_LOG_ERROR, "invalid argument");
                 return NULL;
         }
 
+        mag = mem_pool_thread_magazine (mem_pool);
+        if (mag) {
+                if (mag->count) {
+                        mag->hits++;
+                } else {
+                        mag->misses++;
+                        LOCK (&mem_pool->lock);
+                        {
+                                __mem_pool_magazine_refill
+                                        (mem_pool, mag,
+                                         mem_pool->magazine_size / 2);
+                        }
+                        UNLOCK (&mem_pool->lock);
+                }
+
+                if (mag->count) {
+                        list = mag->list.next;
+                        list_del (list);
+                        mag->count--;
+
+                        ptr = list;
+                        in_use = (ptr + GF_MEM_POOL_LIST_BOUNDARY);
+                        *in_use = 1;
+
+                        return mem_pool_chunkhead2ptr (ptr);
+                }
+
+                /* depot is empty too, fall through to the heap */
+        }
+
         LOCK (&mem_pool->lock);
         {
                 if (mem_pool->cold_count) {
@@ -460,72 +696,161 @@ __is_member (struct mem_pool *pool, void *ptr)
 void
 mem_put (struct mem_pool *pool, void *ptr)
 {
-        struct list_head *list = NULL;
-        int    *in_use = NULL;
-        void   *head = NULL;
+        struct list_head         *list = NULL;
+        int                      *in_use = NULL;
+        void                     *head = NULL;
+        struct mem_pool_magazine *mag = NULL;
 
         if (!pool || !ptr) {
                 gf_log ("mem-pool", GF_LOG_ERROR, "invalid argument");
                 return;
         }
 
-        LOCK (&pool->lock);
+        /* membership is decided from the address alone, so it needs no
+           lock; the chunk is owned by the caller until it is put back */
+        switch (__is_member (pool, ptr))
         {
+        case 1:
+                list = head = mem_pool_ptr2chunkhead (ptr);
+                in_use = (head + GF_MEM_POOL_LIST_BOUNDARY);
+                if (!is_mem_chunk_in_use(in_use)) {
+                        gf_log_callingfn ("mem-pool", GF_LOG_CRITICAL,
+                                          "mem_put called on freed ptr %p of mem "
+                                          "pool %p", ptr, pool);
+                        break;
+                }
+                *in_use = 0;
+
+                mag = mem_pool_thread_magazine (pool);
+                if (mag) {
+                        if (mag->count < pool->magazine_size) {
+                                mag->hits++;
+                        } else {
+                                mag->misses++;
+                                LOCK (&pool->lock);
+                                {
+                                        __mem_pool_magazine_drain
+                                                (pool, mag,
+                                                 pool->magazine_size / 2);
+                                }
+                                UNLOCK (&pool->lock);
+                        }
+
+                        list_add (list, &mag->list);
+                        mag->count++;
+                        break;
+                }
 
-                switch (__is_member (pool, ptr))
+                LOCK (&pool->lock);
                 {
-                case 1:
-                        list = head = mem_pool_ptr2chunkhead (ptr);
-                        in_use = (head + GF_MEM_POOL_LIST_BOUNDARY);
-                        if (!is_mem_chunk_in_use(in_use)) {
-                                gf_log_callingfn ("mem-pool", GF_LOG_CRITICAL,
-                                                  "mem_put called on freed ptr %p of mem "
-                                                  "pool %p", ptr, pool);
-                                break;
-                        }
                         pool->hot_count--;
                         pool->cold_count++;
-                        *in_use = 0;
                         list_add (list, &pool->list);
-                        break;
-                case -1:
-                        /* For some reason, the address given is within
-                         * the address range of the mem-pool but does not align
-                         * with the expected start of a chunk that includes
-                         * the list headers also. Sounds like a problem in
-                         * layers of clouds up above us. ;)
-                         */
-                        abort ();
-                        break;
-                case 0:
-                        /* The address is outside the range of the mem-pool. We
-                         * assume here that this address was allocated at a
-                         * point when the mem-pool was out of chunks in mem_get
-                         * or the programmer has made a mistake by calling the
-                         * wrong de-allocation interface. We do
-                         * not have enough info to distinguish between the two
-                         * situations.
-                         */
-                        FREE (ptr);
-                        break;
-                default:
-                        /* log error */
-                        break;
                 }
+                UNLOCK (&pool->lock);
+                break;
+        case -1:
+                /* For some reason, the address given is within
+                 * the address range of the mem-pool but does not align
+                 * with the expected start of a chunk that includes
+                 * the list headers also. Sounds like a problem in
+                 * layers of clouds up above us. ;)
+                 */
+                abort ();
+                break;
+        case 0:
+                /* The address is outside the range of the mem-pool. We
+                 * assume here that this address was allocated at a
+                 * point when the mem-pool was out of chunks in mem_get
+                 * or the programmer has made a mistake by calling the
+                 * wrong de-allocation interface. We do
+                 * not have enough info to distinguish between the two
+                 * situations.
+                 */
+                FREE (ptr);
+                break;
+        default:
+                /* log error */
+                break;
         }
-        UNLOCK (&pool->lock);
 }
 
 
 void
 mem_pool_destroy (struct mem_pool *pool)
 {
+        int  i = 0;
+
         if (!pool)
                 return;
 
+        pthread_mutex_lock (&mem_pool_global_lock);
+        {
+                list_del_init (&pool->global_list);
+        }
+        pthread_mutex_unlock (&mem_pool_global_lock);
+
+        for (i = 0; i < GF_MEM_POOL_MAX_THREADS; i++) {
+                if (pool->magazines[i])
+                        GF_FREE (pool->magazines[i]);
+        }
+
         LOCK_DESTROY (&pool->lock);
         GF_FREE (pool->pool);
         GF_FREE (pool);
 
         return;
 }
+
+
+void
+mem_pool_stats_dump (void)
+{
+        char                      key[GF_DUMP_MAX_BUF_LEN];
+        char                      prefix[GF_DUMP_MAX_BUF_LEN];
+        struct mem_pool          *pool = NULL;
+        struct mem_pool_magazine *mag = NULL;
+        int                       i = 0;
+        int                       ret = -1;
+
+        ret = pthread_mutex_trylock (&mem_pool_global_lock);
+        if (ret) {
+                gf_log ("", GF_LOG_WARNING, "Unable to dump mem pools"
+                        " errno: %s", strerror (errno));
+                return;
+        }
+
+        list_for_each_entry (pool, &mem_pool_global_list, global_list) {
+                snprintf (prefix, sizeof (prefix), "mempool.%s.%p",
+                          pool->name, pool);
+                gf_proc_dump_add_section (prefix);
+
+                gf_proc_dump_build_key (key, prefix, "hot-count");
+                gf_proc_dump_write (key, "%d", pool->hot_count);
+                gf_proc_dump_build_key (key, prefix, "cold-count");
+                gf_proc_dump_write (key, "%d", pool->cold_count);
+                gf_proc_dump_build_key (key, prefix, "padded_sizeof");
+                gf_proc_dump_write (key, "%lu", pool->padded_sizeof_type);
+                gf_proc_dump_build_key (key, prefix, "magazine-size");
+                gf_proc_dump_write (key, "%d", pool->magazine_size);
+
+                /* counters are owned by their threads, read them racily */
+                for (i = 0; i < GF_MEM_POOL_MAX_THREADS; i++) {
+                        mag = pool->magazines[i];
+                        if (!mag)
+                                continue;
+
+                        gf_proc_dump_build_key (key, prefix,
+                                                "thread.%d.cached", i);
+                        gf_proc_dump_write (key, "%d", mag->count);
+                        gf_proc_dump_build_key (key, prefix,
+                                                "thread.%d.hits", i);
+                        gf_proc_dump_write (key, "%"PRIu64, mag->hits);
+                        gf_proc_dump_build_key (key, prefix,
+                                                "thread.%d.misses", i);
+                        gf_proc_dump_write (key, "%"PRIu64, mag->misses);
+                }
+        }
+
+        pthread_mutex_unlock (&mem_pool_global_lock);
+}
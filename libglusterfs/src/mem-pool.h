@@ -136,21 +136,41 @@ char * gf_strdup (const char *src)
         return dup_str;
 }
 
-struct mem_pool {
+/* upper bound on threads which get a private magazine in every pool;
+   threads beyond this fall back to the locked depot */
+#define GF_MEM_POOL_MAX_THREADS   128
+#define GF_MEM_POOL_MAGAZINE_SIZE 64
+
+/* per-thread cache of free chunks. Only the owning thread touches
+   @list and @count, so mem_get/mem_put need no lock while the magazine
+   can serve the request. */
+struct mem_pool_magazine {
         struct list_head  list;
-        int               hot_count;
-        int               cold_count;
+        int               count;
+        uint64_t          hits;   /* served without touching the depot */
+        uint64_t          misses; /* had to refill from or drain to depot */
+};
+
+struct mem_pool {
+        struct list_head  list;       /* depot of free chunks */
+        int               hot_count;  /* chunks outside the depot */
+        int               cold_count; /* chunks in the depot */
         gf_lock_t         lock;
         unsigned long     padded_sizeof_type;
         void             *pool;
         void             *pool_end;
         int               real_sizeof_type;
+        const char       *name;
+        struct list_head  global_list;
+        int               magazine_size; /* 0 disables thread caching */
+        struct mem_pool_magazine *magazines[GF_MEM_POOL_MAX_THREADS];
 };
 
 struct mem_pool *
-mem_pool_new_fn (unsigned long sizeof_type, unsigned long count);
+mem_pool_new_fn (unsigned long sizeof_type, unsigned long count,
+                 const char *name);
 
-#define mem_pool_new(type,count) mem_pool_new_fn (sizeof(type), count)
+#define mem_pool_new(type,count) mem_pool_new_fn (sizeof(type), count, #type)
 
 void mem_put (struct mem_pool *pool, void *ptr);
 void *mem_get (struct mem_pool *pool);
@@ -158,6 +178,9 @@ void *mem_get0 (struct mem_pool *pool);
 
 void mem_pool_destroy (struct mem_pool *pool);
 
+int mem_pool_thread_init (void);
+void mem_pool_stats_dump (void);
+
 int gf_mem_acct_is_enabled ();
 void gf_mem_acct_enable_set ();
 
@@ -200,6 +200,8 @@ gf_proc_dump_mem_info ()
 #endif
         gf_proc_dump_xlator_mem_info(&global_xlator);
 
+        mem_pool_stats_dump ();
+
 }
 
 void gf_proc_dump_latency_info (xlator_t *xl);
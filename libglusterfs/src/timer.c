@@ -29,6 +29,117 @@
 
 #define TS(tv) ((((unsigned long long) tv.tv_sec) * 1000000) + (tv.tv_usec))
 
+static uint64_t
+gf_timer_now (void)
+{
+        struct timeval now = {0, };
+
+        gettimeofday (&now, NULL);
+
+        return TS (now) / GF_TIMER_TICK_USEC;
+}
+
+
+static void
+__gf_timer_enqueue (gf_timer_registry_t *reg, gf_timer_t *event)
+{
+        uint64_t expires = 0;
+        uint64_t delta   = 0;
+        int      level   = 0;
+
+        expires = event->expires;
+        if (expires < reg->clk)
+                expires = reg->clk;
+
+        delta = expires - reg->clk;
+
+        for (level = 0; level < GF_TIMER_WHEEL_LEVELS - 1; level++) {
+                if (delta < (1ULL << ((level + 1) * GF_TIMER_WHEEL_BITS)))
+                        break;
+        }
+
+        if (delta >= (1ULL << (GF_TIMER_WHEEL_LEVELS * GF_TIMER_WHEEL_BITS)))
+                expires = reg->clk + (1ULL << (GF_TIMER_WHEEL_LEVELS *
+                                               GF_TIMER_WHEEL_BITS)) - 1;
+
+        list_add_tail (&event->list,
+                       &reg->wheel[level][(expires >> (level * GF_TIMER_WHEEL_BITS))
+                                          & GF_TIMER_WHEEL_MASK]);
+}
+
+
+/* re-files every timer of a slot into the levels below it */
+static void
+__gf_timer_cascade (gf_timer_registry_t *reg, int level)
+{
+        gf_timer_t       *event = NULL;
+        gf_timer_t       *tmp   = NULL;
+        struct list_head  list;
+        int               index = 0;
+
+        index = (reg->clk >> (level * GF_TIMER_WHEEL_BITS))
+                & GF_TIMER_WHEEL_MASK;
+
+        INIT_LIST_HEAD (&list);
+        list_splice_init (&reg->wheel[level][index], &list);
+
+        list_for_each_entry_safe (event, tmp, &list, list) {
+                list_del_init (&event->list);
+                __gf_timer_enqueue (reg, event);
+        }
+}
+
+
+/* moves everything due by @now onto the expired list */
+static void
+__gf_timer_run (gf_timer_registry_t *reg, uint64_t now)
+{
+        int level = 0;
+
+        if (!reg->pending) {
+                if (reg->clk <= now)
+                        reg->clk = now + 1;
+                return;
+        }
+
+        while (reg->clk <= now) {
+                for (level = 1; level < GF_TIMER_WHEEL_LEVELS; level++) {
+                        if ((reg->clk >> ((level - 1) * GF_TIMER_WHEEL_BITS))
+                            & GF_TIMER_WHEEL_MASK)
+                                break;
+                        __gf_timer_cascade (reg, level);
+                }
+
+                list_append_init (&reg->wheel[0][reg->clk &
+                                                 GF_TIMER_WHEEL_MASK],
+                                  &reg->expired);
+                reg->clk++;
+        }
+}
+
+
+/* the first tick the thread has to wake up for: the next busy slot of the
+ * finest wheel, or the next cascade if there is none before it.
+ */
+static uint64_t
+__gf_timer_next (gf_timer_registry_t *reg)
+{
+        uint64_t index = 0;
+
+        /* the cascade for this tick is still to be done */
+        if (!(reg->clk & GF_TIMER_WHEEL_MASK))
+                return reg->clk;
+
+        for (index = reg->clk & GF_TIMER_WHEEL_MASK;
+             index < GF_TIMER_WHEEL_SIZE; index++) {
+                if (!list_empty (&reg->wheel[0][index]))
+                        break;
+        }
+
+        return (reg->clk & ~((uint64_t) GF_TIMER_WHEEL_MASK)) + index;
+}
+
+
 gf_timer_t *
 gf_timer_call_after (glusterfs_ctx_t *ctx,
                      struct timeval delta,
@@ -37,7 +148,6 @@ gf_timer_call_after (glusterfs_ctx_t *ctx,
 {
         gf_timer_registry_t *reg = NULL;
         gf_timer_t *event = NULL;
-        gf_timer_t *trav = NULL;
         unsigned long long at = 0L;
 
         if (ctx == NULL)
@@ -58,50 +168,25 @@ gf_timer_call_after (glusterfs_ctx_t *ctx,
                 return NULL;
         }
         gettimeofday (&event->at, NULL);
-        event->at.tv_usec = ((event->at.tv_usec + delta.tv_usec) % 1000000);
-        event->at.tv_sec += ((event->at.tv_usec + delta.tv_usec) / 1000000);
-        event->at.tv_sec += delta.tv_sec;
-        at = TS (event->at);
+        at = TS (event->at) + TS (delta);
+        event->at.tv_sec = at / 1000000;
+        event->at.tv_usec = at % 1000000;
+        event->expires = (at + GF_TIMER_TICK_USEC - 1) / GF_TIMER_TICK_USEC;
         event->callbk = callbk;
         event->data = data;
         event->xl = THIS;
         pthread_mutex_lock (&reg->lock);
         {
-                trav = reg->active.prev;
-                while (trav != &reg->active) {
-                        if (TS (trav->at) < at)
-                                break;
-                        trav = trav->prev;
-                }
-                event->prev = trav;
-                event->next = event->prev->next;
-                event->prev->next = event;
-                event->next->prev = event;
+                __gf_timer_enqueue (reg, event);
+                reg->pending++;
+
+                if (event->expires < reg->next_wake)
+                        pthread_cond_signal (&reg->cond);
         }
         pthread_mutex_unlock (&reg->lock);
         return event;
 }
 
-int32_t
-gf_timer_call_stale (gf_timer_registry_t *reg,
-                     gf_timer_t *event)
-{
-        if (reg == NULL || event == NULL)
-        {
-                gf_log_callingfn ("timer", GF_LOG_ERROR, "invalid argument");
-                return 0;
-        }
-
-        event->next->prev = event->prev;
-        event->prev->next = event->next;
-        event->next = &reg->stale;
-        event->prev = event->next->prev;
-        event->next->prev = event;
-        event->prev->next = event;
-
-        return 0;
-}
-
 int32_t
 gf_timer_call_cancel (glusterfs_ctx_t *ctx,
                       gf_timer_t *event)
@@ -123,8 +208,9 @@ gf_timer_call_cancel (glusterfs_ctx_t *ctx,
 
         pthread_mutex_lock (&reg->lock);
         {
-                event->next->prev = event->prev;
-                event->prev->next = event->next;
+                list_del (&event->list);
+                if (!event->fired)
+                        reg->pending--;
         }
         pthread_mutex_unlock (&reg->lock);
 
@@ -132,10 +218,44 @@ gf_timer_call_cancel (glusterfs_ctx_t *ctx,
         return 0;
 }
 
+
+static void
+__gf_timer_wait (gf_timer_registry_t *reg)
+{
+        struct timespec    ts   = {0, };
+        unsigned long long wake = 0;
+
+        reg->next_wake = __gf_timer_next (reg);
+
+        wake = reg->next_wake * GF_TIMER_TICK_USEC;
+        ts.tv_sec  = wake / 1000000;
+        ts.tv_nsec = (wake % 1000000) * 1000;
+
+        pthread_cond_timedwait (&reg->cond, &reg->lock, &ts);
+
+        reg->next_wake = 0;
+}
+
+
+static void
+__gf_timer_free_list (struct list_head *head)
+{
+        gf_timer_t *event = NULL;
+        gf_timer_t *tmp   = NULL;
+
+        list_for_each_entry_safe (event, tmp, head, list) {
+                list_del (&event->list);
+                GF_FREE (event);
+        }
+}
+
+
 void *
 gf_timer_proc (void *ctx)
 {
         gf_timer_registry_t *reg = NULL;
+        int                  level = 0;
+        int                  index = 0;
 
         if (ctx == NULL)
         {
@@ -150,48 +270,56 @@ gf_timer_proc (void *ctx)
         }
 
         while (!reg->fin) {
-                unsigned long long now;
-                struct timeval now_tv;
                 gf_timer_t *event = NULL;
 
-                gettimeofday (&now_tv, NULL);
-                now = TS (now_tv);
+                pthread_mutex_lock (&reg->lock);
+                {
+                        __gf_timer_run (reg, gf_timer_now ());
+
+                        if (list_empty (&reg->expired))
+                                __gf_timer_wait (reg);
+                }
+                pthread_mutex_unlock (&reg->lock);
+
+                /* a fired timer stays on the stale list till its owner
+                 * cancels it, which may well happen in the callback.
+                 */
                 while (1) {
-                        unsigned long long at;
-                        char need_cbk = 0;
+                        event = NULL;
 
                         pthread_mutex_lock (&reg->lock);
                         {
-                                event = reg->active.next;
-                                at = TS (event->at);
-                                if (event != &reg->active && now >= at) {
-                                        need_cbk = 1;
-                                        gf_timer_call_stale (reg, event);
+                                if (!list_empty (&reg->expired)) {
+                                        event = list_entry (reg->expired.next,
+                                                            gf_timer_t, list);
+                                        list_move_tail (&event->list,
+                                                        &reg->stale);
+                                        event->fired = 1;
+                                        reg->pending--;
                                 }
                         }
                         pthread_mutex_unlock (&reg->lock);
-                        if (event->xl)
-                                THIS = event->xl;
-                        if (need_cbk)
-                                event->callbk  (event->data);
 
-                        else
+                        if (!event)
                                 break;
+
+                        if (event->xl)
+                                THIS = event->xl;
+                        event->callbk (event->data);
                 }
-                usleep (1000000);
         }
 
         pthread_mutex_lock (&reg->lock);
         {
-                while (reg->active.next != &reg->active) {
-                        gf_timer_call_cancel (ctx, reg->active.next);
-                }
+                for (level = 0; level < GF_TIMER_WHEEL_LEVELS; level++)
+                        for (index = 0; index < GF_TIMER_WHEEL_SIZE; index++)
+                                __gf_timer_free_list (&reg->wheel[level][index]);
 
-                while (reg->stale.next != &reg->stale) {
-                        gf_timer_call_cancel (ctx, reg->stale.next);
-                }
+                __gf_timer_free_list (&reg->expired);
+                __gf_timer_free_list (&reg->stale);
         }
         pthread_mutex_unlock (&reg->lock);
+        pthread_cond_destroy (&reg->cond);
         pthread_mutex_destroy (&reg->lock);
         GF_FREE (((glusterfs_ctx_t *)ctx)->timer);
 
@@ -201,6 +329,9 @@ gf_timer_proc (void *ctx)
 gf_timer_registry_t *
 gf_timer_registry_init (glusterfs_ctx_t *ctx)
 {
+        int level = 0;
+        int index = 0;
+
         if (ctx == NULL) {
                 gf_log_callingfn ("timer", GF_LOG_ERROR, "invalid argument");
                 return NULL;
@@ -215,10 +346,13 @@ gf_timer_registry_init (glusterfs_ctx_t *ctx)
                         goto out;
 
                 pthread_mutex_init (&reg->lock, NULL);
-                reg->active.next = &reg->active;
-                reg->active.prev = &reg->active;
-                reg->stale.next = &reg->stale;
-                reg->stale.prev = &reg->stale;
+                pthread_cond_init (&reg->cond, NULL);
+                INIT_LIST_HEAD (&reg->stale);
+                INIT_LIST_HEAD (&reg->expired);
+                for (level = 0; level < GF_TIMER_WHEEL_LEVELS; level++)
+                        for (index = 0; index < GF_TIMER_WHEEL_SIZE; index++)
+                                INIT_LIST_HEAD (&reg->wheel[level][index]);
+                reg->clk = gf_timer_now ();
 
                 ctx->timer = reg;
                 pthread_create (&reg->th, NULL, gf_timer_proc, ctx);
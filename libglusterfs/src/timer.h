@@ -32,9 +32,21 @@
 
 typedef void (*gf_timer_cbk_t) (void *);
 
+/* timers are kept in a hierarchical timing wheel: GF_TIMER_WHEEL_LEVELS
+ * wheels of GF_TIMER_WHEEL_SIZE slots, each slot of a level spanning a full
+ * revolution of the level below it. the finest slot is one tick long.
+ */
+#define GF_TIMER_TICK_USEC      10000
+#define GF_TIMER_WHEEL_BITS     8
+#define GF_TIMER_WHEEL_SIZE     (1 << GF_TIMER_WHEEL_BITS)
+#define GF_TIMER_WHEEL_MASK     (GF_TIMER_WHEEL_SIZE - 1)
+#define GF_TIMER_WHEEL_LEVELS   4
+
 struct _gf_timer {
-        struct _gf_timer *next, *prev;
+        struct list_head  list;
         struct timeval    at;
+        uint64_t          expires;      /* in ticks */
+        char              fired;
         gf_timer_cbk_t    callbk;
         void             *data;
         xlator_t         *xl;
@@ -43,8 +55,13 @@ struct _gf_timer {
 struct _gf_timer_registry {
         pthread_t        th;
         char             fin;
-        struct _gf_timer stale;
-        struct _gf_timer active;
+        struct list_head stale;
+        struct list_head expired;
+        struct list_head wheel[GF_TIMER_WHEEL_LEVELS][GF_TIMER_WHEEL_SIZE];
+        uint64_t         clk;           /* next tick to be processed */
+        uint64_t         next_wake;     /* 0 while the timer thread runs */
+        uint64_t         pending;       /* timers not yet fired */
+        pthread_cond_t   cond;
         pthread_mutex_t  lock;
 };
 
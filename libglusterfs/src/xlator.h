@@ -796,6 +796,11 @@ typedef struct vol_opt_list {
 } volume_opt_list_t;
 
 
+/* inode and fd ctx arrays hold a slot per xlator of the owning graph,
+ * indexed by xl_id, followed by these for xlators from outside it (fuse).
+ */
+#define XLATOR_CTX_FOREIGN_SLOTS 1
+
 struct _xlator {
         /* Built during parsing */
         char          *name;
@@ -828,6 +833,8 @@ struct _xlator {
         /* Misc */
         glusterfs_ctx_t    *ctx;
         glusterfs_graph_t  *graph; /* not set for fuse */
+        int                 xl_id; /* slot in the inode/fd ctx arrays of
+                                      tables owned by this graph */
         inode_table_t      *itable;
         char                init_succeeded;
         void               *private;
@@ -51,6 +51,23 @@ rpc_clnt_new_callid (struct rpc_clnt *clnt)
 }
 
 
+static inline struct list_head *
+__saved_frames_bucket (struct saved_frames *frames, uint64_t callid)
+{
+        return &frames->hash[callid & (RPC_CLNT_SAVED_FRAMES_HASH - 1)];
+}
+
+
+static void
+__saved_frames_unlink (struct saved_frames *frames,
+                       struct saved_frame *saved_frame)
+{
+        list_del_init (&saved_frame->list);
+        list_del_init (&saved_frame->hash);
+        frames->count--;
+}
+
+
 struct saved_frame *
 __saved_frames_get_timedout (struct saved_frames *frames, uint32_t timeout,
                              struct timeval *current)
@@ -61,8 +78,7 @@ __saved_frames_get_timedout (struct saved_frames *frames, uint32_t timeout,
 		tmp = list_entry (frames->sf.list.next, typeof (*tmp), list);
 		if ((tmp->saved_at.tv_sec + timeout) < current->tv_sec) {
 			bailout_frame = tmp;
-			list_del_init (&bailout_frame->list);
-			frames->count--;
+			__saved_frames_unlink (frames, bailout_frame);
 		}
 	}
 
@@ -84,6 +100,7 @@ __saved_frames_put (struct saved_frames *frames, void *frame,
 
         memset (saved_frame, 0, sizeof (*saved_frame));
 	INIT_LIST_HEAD (&saved_frame->list);
+        INIT_LIST_HEAD (&saved_frame->hash);
 
 	saved_frame->capital_this = THIS;
 	saved_frame->frame        = frame;
@@ -91,6 +108,8 @@ __saved_frames_put (struct saved_frames *frames, void *frame,
 	gettimeofday (&saved_frame->saved_at, NULL);
 
 	list_add_tail (&saved_frame->list, &frames->sf.list);
+        list_add_tail (&saved_frame->hash,
+                       __saved_frames_bucket (frames, rpcreq->xid));
 	frames->count++;
 
 out:
@@ -107,8 +126,7 @@ saved_frames_delete (struct saved_frame *saved_frame,
 
         pthread_mutex_lock (&conn->lock);
         {
-                list_del_init (&saved_frame->list);
-                conn->saved_frames->count--;
+                __saved_frames_unlink (conn->saved_frames, saved_frame);
         }
         pthread_mutex_unlock (&conn->lock);
 
@@ -244,6 +262,7 @@ struct saved_frames *
 saved_frames_new (void)
 {
 	struct saved_frames *saved_frames = NULL;
+        int                  i            = 0;
 
 	saved_frames = GF_CALLOC (1, sizeof (*saved_frames),
                                   gf_common_mt_rpcclnt_savedframe_t);
@@ -253,6 +272,9 @@ saved_frames_new (void)
 
 	INIT_LIST_HEAD (&saved_frames->sf.list);
 
+        for (i = 0; i < RPC_CLNT_SAVED_FRAMES_HASH; i++)
+                INIT_LIST_HEAD (&saved_frames->hash[i]);
+
 	return saved_frames;
 }
 
@@ -269,7 +291,8 @@ __saved_frame_copy (struct saved_frames *frames, int64_t callid,
                 goto out;
         }
 
-	list_for_each_entry (tmp, &frames->sf.list, list) {
+	list_for_each_entry (tmp, __saved_frames_bucket (frames, callid),
+                             hash) {
 		if (tmp->rpcreq->xid == callid) {
 			*saved_frame = *tmp;
                         ret = 0;
@@ -288,10 +311,10 @@ __saved_frame_get (struct saved_frames *frames, int64_t callid)
 	struct saved_frame *saved_frame = NULL;
 	struct saved_frame *tmp = NULL;
 
-	list_for_each_entry (tmp, &frames->sf.list, list) {
+	list_for_each_entry (tmp, __saved_frames_bucket (frames, callid),
+                             hash) {
 		if (tmp->rpcreq->xid == callid) {
-			list_del_init (&tmp->list);
-			frames->count--;
+			__saved_frames_unlink (frames, tmp);
 			saved_frame = tmp;
 			break;
 		}
@@ -347,6 +370,7 @@ saved_frames_unwind (struct saved_frames *saved_frames)
                                        trav->rpcreq->conn->rpc_clnt->reqpool);
 
 		list_del_init (&trav->list);
+                list_del_init (&trav->hash);
                 mem_put (saved_frames_pool, trav);
 	}
 }
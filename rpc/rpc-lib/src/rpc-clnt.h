@@ -61,11 +61,16 @@ struct saved_frame {
 	struct timeval           saved_at;
         struct rpc_req          *rpcreq;
         rpc_transport_rsp_t      rsp;
+        struct list_head         hash;
 };
 
+/* xids are handed out sequentially, so masking spreads them evenly */
+#define RPC_CLNT_SAVED_FRAMES_HASH 1024
+
 struct saved_frames {
 	int64_t            count;
-	struct saved_frame sf;
+	struct saved_frame sf;  /* in order of submission, for call_bail */
+        struct list_head   hash[RPC_CLNT_SAVED_FRAMES_HASH];  /* by xid */
 };
 
 
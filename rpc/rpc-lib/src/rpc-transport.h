@@ -209,6 +209,8 @@ struct rpc_transport {
 
         uint64_t                   total_bytes_read;
         uint64_t                   total_bytes_write;
+        uint64_t                   total_write_calls;
+        uint64_t                   total_msgs_sent;
 
         struct list_head           list;
 };
@@ -171,6 +171,7 @@ __socket_rwv (rpc_transport_t *this, struct iovec *vector, int count,
         while (opcount) {
                 if (write) {
                         ret = writev (sock, opvector, opcount);
+                        this->total_write_calls++;
 
                         if (ret == 0 || (ret == -1 && errno == EAGAIN)) {
                                 /* done for now */
@@ -240,16 +241,180 @@ out:
 }
 
 
+/* hands out bytes held in the receive buffer into @vector, advancing it
+ * past what was filled. returns the number of bytes copied.
+ */
+static size_t
+__socket_rbuf_copyout (socket_private_t *priv, struct iovec **vector,
+                       int *count)
+{
+        struct iovec *opvector = *vector;
+        int           opcount  = *count;
+        size_t        avail    = 0;
+        size_t        copy     = 0;
+        size_t        copied   = 0;
+
+        avail = priv->rbuf.end - priv->rbuf.start;
+
+        while (avail && opcount) {
+                copy = min (avail, opvector[0].iov_len);
+                memcpy (opvector[0].iov_base,
+                        priv->rbuf.base + priv->rbuf.start, copy);
+
+                priv->rbuf.start += copy;
+                avail -= copy;
+                copied += copy;
+
+                opvector[0].iov_base += copy;
+                opvector[0].iov_len -= copy;
+
+                while (opcount && !opvector[0].iov_len) {
+                        opvector++;
+                        opcount--;
+                }
+        }
+
+        if (priv->rbuf.start == priv->rbuf.end)
+                priv->rbuf.start = priv->rbuf.end = 0;
+
+        *vector = opvector;
+        *count  = opcount;
+
+        return copied;
+}
+
+
+int
+__socket_rbuf_pending (rpc_transport_t *this)
+{
+        socket_private_t *priv = this->private;
+
+        return (priv->rbuf.end != priv->rbuf.start);
+}
+
+
+/* reads go through a per-connection receive buffer: whatever is buffered
+ * is handed out first, then a single readv () fills the rest of @vector
+ * directly and spills whatever else the socket holds into the buffer, so
+ * the next few parts of the record (or the next records) cost no syscall.
+ * bulk payloads still land in the caller's iobuf without an extra copy.
+ * the buffer is only refilled once drained, so it is always read from
+ * start to end and never wraps.
+ */
 int
 __socket_readv (rpc_transport_t *this, struct iovec *vector, int count,
                 struct iovec **pending_vector, int *pending_count,
                 size_t *bytes)
 {
-        int ret = -1;
+        socket_private_t *priv = NULL;
+        struct iovec      opvector[MAX_IOVEC + 1];
+        struct iovec     *current = NULL;
+        int               opcount = 0;
+        int               moved = 0;
+        int               ret = -1;
+        size_t            total = 0;
 
-        ret = __socket_rwv (this, vector, count,
-                            pending_vector, pending_count, bytes, 0);
+        GF_VALIDATE_OR_GOTO ("socket", this, out);
+        GF_VALIDATE_OR_GOTO ("socket", this->private, out);
+
+        priv = this->private;
+
+        current = vector;
+        opcount = count;
+
+        while (opcount && !current[0].iov_len) {
+                current++;
+                opcount--;
+        }
 
+        total = __socket_rbuf_copyout (priv, &current, &opcount);
+
+        if (opcount && (priv->rbuf.base == NULL) && (opcount <= MAX_IOVEC))
+                priv->rbuf.base = GF_MALLOC (SOCKET_RBUF_SIZE,
+                                             gf_common_mt_char);
+
+        if (opcount && ((priv->rbuf.base == NULL) || (opcount > MAX_IOVEC))) {
+                /* no room to add the buffer to the vector (or no buffer),
+                 * read straight into the vector. the buffer is empty by
+                 * now, so this does not overtake anything buffered.
+                 */
+                ret = __socket_rwv (this, current, opcount, pending_vector,
+                                    pending_count, bytes, 0);
+                if (bytes != NULL)
+                        *bytes += total;
+                goto out;
+        }
+
+        while (opcount) {
+                /* the buffer is empty here: everything buffered has just
+                 * been handed out above.
+                 */
+                memcpy (opvector, current, opcount * sizeof (*opvector));
+                opvector[opcount].iov_base = priv->rbuf.base;
+                opvector[opcount].iov_len  = SOCKET_RBUF_SIZE;
+
+                ret = readv (priv->sock, opvector, opcount + 1);
+                if (ret == -1 && errno == EAGAIN) {
+                        /* done for now */
+                        break;
+                }
+
+                if (ret == 0) {
+                        /* Mostly due to 'umount' in client */
+
+                        gf_log (this->name, GF_LOG_DEBUG,
+                                "EOF from peer %s", this->peerinfo.identifier);
+                        opcount = -1;
+                        errno = ENOTCONN;
+                        break;
+                }
+                if (ret == -1) {
+                        if (errno == EINTR)
+                                continue;
+
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "readv failed (%s)", strerror (errno));
+                        opcount = -1;
+                        break;
+                }
+
+                this->total_bytes_read += ret;
+
+                moved = 0;
+                while (opcount && (moved < ret)) {
+                        if ((ret - moved) >= current[0].iov_len) {
+                                moved += current[0].iov_len;
+                                current++;
+                                opcount--;
+                        } else {
+                                current[0].iov_len -= (ret - moved);
+                                current[0].iov_base += (ret - moved);
+                                moved += (ret - moved);
+                        }
+                        while (opcount && !current[0].iov_len) {
+                                current++;
+                                opcount--;
+                        }
+                }
+
+                total += moved;
+
+                /* the remainder went into the buffer */
+                priv->rbuf.start = 0;
+                priv->rbuf.end   = ret - moved;
+        }
+
+        if (bytes != NULL)
+                *bytes = total;
+
+        if (pending_vector)
+                *pending_vector = current;
+
+        if (pending_count)
+                *pending_count = opcount;
+
+        ret = opcount;
+out:
         return ret;
 }
 
@@ -482,11 +647,14 @@ __socket_reset (rpc_transport_t *this)
 
         memset (&priv->incoming, 0, sizeof (priv->incoming));
 
+        priv->rbuf.start = priv->rbuf.end = 0;
+
         event_unregister (this->ctx->event_pool, priv->sock, priv->idx);
 
         close (priv->sock);
         priv->sock = -1;
         priv->idx = -1;
+        priv->corked = 0;
         priv->connected = -1;
 
 out:
@@ -633,6 +801,7 @@ __socket_ioq_churn_entry (rpc_transport_t *this, struct ioq *entry)
         if (ret == 0) {
                 /* current entry was completely written */
                 GF_ASSERT (entry->pending_count == 0);
+                this->total_msgs_sent++;
                 __socket_ioq_entry_free (entry);
         }
 
@@ -640,6 +809,91 @@ __socket_ioq_churn_entry (rpc_transport_t *this, struct ioq *entry)
 }
 
 
+void
+__socket_cork (rpc_transport_t *this, int cork)
+{
+#ifdef TCP_CORK
+        socket_private_t *priv = NULL;
+        int               family = 0;
+
+        priv = this->private;
+        family = this->peerinfo.sockaddr.ss_family;
+
+        if ((family != AF_INET) && (family != AF_INET6))
+                return;
+
+        if (priv->corked == cork)
+                return;
+
+        if (setsockopt (priv->sock, IPPROTO_TCP, TCP_CORK, &cork,
+                        sizeof (cork)) == -1) {
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "setsockopt (TCP_CORK) failed (%s)", strerror (errno));
+                return;
+        }
+
+        priv->corked = cork;
+#endif
+}
+
+
+/* write as much of the ioq as fits in one writev (). Entries written
+ * completely are retired, a partially written one is left at the head.
+ * Returns 0 when the whole batch went out, > 0 if the socket filled up
+ * and -1 on error.
+ */
+int
+__socket_ioq_churn_batch (rpc_transport_t *this)
+{
+        socket_private_t *priv    = NULL;
+        struct ioq       *entry   = NULL;
+        struct ioq       *tmp     = NULL;
+        struct iovec      vector[SOCKET_IOQ_BATCH_IOVEC];
+        struct iovec     *pending = NULL;
+        int               pending_count = 0;
+        int               count   = 0;
+        int               done    = 0;
+        int               ret     = -1;
+
+        priv = this->private;
+
+        list_for_each_entry (entry, &priv->ioq, list) {
+                if (count + entry->pending_count > SOCKET_IOQ_BATCH_IOVEC)
+                        break;
+
+                memcpy (&vector[count], entry->pending_vector,
+                        entry->pending_count * sizeof (struct iovec));
+                count += entry->pending_count;
+        }
+
+        ret = __socket_writev (this, vector, count, &pending, &pending_count);
+        if (ret == -1)
+                goto out;
+
+        done = count - pending_count;
+        count = 0;
+
+        list_for_each_entry_safe (entry, tmp, &priv->ioq, list) {
+                if (count + entry->pending_count <= done) {
+                        count += entry->pending_count;
+                        this->total_msgs_sent++;
+                        __socket_ioq_entry_free (entry);
+                        continue;
+                }
+
+                if (pending_count) {
+                        /* carry the partial write over into the entry */
+                        entry->pending_vector += done - count;
+                        entry->pending_count  -= done - count;
+                        entry->pending_vector[0] = *pending;
+                }
+                break;
+        }
+out:
+        return ret;
+}
+
+
 int
 __socket_ioq_churn (rpc_transport_t *this)
 {
@@ -652,7 +906,22 @@ __socket_ioq_churn (rpc_transport_t *this)
 
         priv = this->private;
 
-        while (!list_empty (&priv->ioq)) {
+        while (priv->ioq_batch && !list_empty (&priv->ioq)) {
+                ret = __socket_ioq_churn_batch (this);
+
+                if (ret != 0)
+                        break;
+
+                /* more than one writev () worth queued, hold back
+                   partial segments till the burst is out */
+                if (priv->cork && !list_empty (&priv->ioq))
+                        __socket_cork (this, 1);
+        }
+
+        if (priv->corked)
+                __socket_cork (this, 0);
+
+        while (!priv->ioq_batch && !list_empty (&priv->ioq)) {
                 /* pick next entry */
                 entry = priv->ioq_next;
 
@@ -885,7 +1154,11 @@ __socket_read_vectored_request (rpc_transport_t *this)
 
         case SP_STATE_READ_VERFBYTES:
                 if (priv->incoming.payload_vector.iov_base == NULL) {
-                        iobuf = iobuf_get (this->ctx->iobuf_pool);
+                        remaining_size = RPC_FRAGSIZE (priv->incoming.fraghdr)
+                                - priv->incoming.frag.bytes_read;
+
+                        iobuf = iobuf_get2 (this->ctx->iobuf_pool,
+                                            remaining_size);
                         if (!iobuf) {
                                 ret = -1;
                                 break;
@@ -1023,6 +1296,7 @@ __socket_read_accepted_successful_reply (rpc_transport_t *this)
         int               ret                      = 0;
         struct iobuf     *iobuf                    = NULL;
         uint32_t          gluster_read_rsp_hdr_len = 0;
+        uint32_t          remaining_size           = 0;
         gfs3_read_rsp     read_rsp                 = {0, };
 
         GF_VALIDATE_OR_GOTO ("socket", this, out);
@@ -1056,7 +1330,11 @@ __socket_read_accepted_successful_reply (rpc_transport_t *this)
                         = SP_STATE_READ_PROC_HEADER;
 
                 if (priv->incoming.payload_vector.iov_base == NULL) {
-                        iobuf = iobuf_get (this->ctx->iobuf_pool);
+                        remaining_size = RPC_FRAGSIZE (priv->incoming.fraghdr)
+                                - priv->incoming.frag.bytes_read;
+
+                        iobuf = iobuf_get2 (this->ctx->iobuf_pool,
+                                            remaining_size);
                         if (iobuf == NULL) {
                                 ret = -1;
                                 goto out;
@@ -1447,6 +1725,8 @@ __socket_proto_state_machine (rpc_transport_t *this,
         struct iobuf     *iobuf  = NULL;
         struct iobref    *iobref = NULL;
         struct iovec      vector[2];
+        struct iobuf_pool *iobuf_pool = NULL;
+        size_t            iobuf_size = 0;
 
         GF_VALIDATE_OR_GOTO ("socket", this, out);
         GF_VALIDATE_OR_GOTO ("socket", this->private, out);
@@ -1456,13 +1736,6 @@ __socket_proto_state_machine (rpc_transport_t *this,
                 switch (priv->incoming.record_state) {
 
                 case SP_STATE_NADA:
-                        iobuf = iobuf_get (this->ctx->iobuf_pool);
-                        if (!iobuf) {
-                                ret = -ENOMEM;
-                                goto out;
-                        }
-
-                        priv->incoming.iobuf = iobuf;
                         priv->incoming.iobuf_size = 0;
                         priv->incoming.total_bytes_read = 0;
                         priv->incoming.payload_vector.iov_len = 0;
@@ -1471,7 +1744,6 @@ __socket_proto_state_machine (rpc_transport_t *this,
                         priv->incoming.pending_vector->iov_base =
                                 &priv->incoming.fraghdr;
 
-                        priv->incoming.frag.fragcurrent = iobuf_ptr (iobuf);
                         priv->incoming.pending_vector->iov_len  =
                                 sizeof (priv->incoming.fraghdr);
 
@@ -1510,6 +1782,31 @@ __socket_proto_state_machine (rpc_transport_t *this,
                 case SP_STATE_READ_FRAGHDR:
 
                         priv->incoming.fraghdr = ntoh32 (priv->incoming.fraghdr);
+
+                        if (priv->incoming.iobuf == NULL) {
+                                /* size the buffer to the record now that it
+                                 * is known. Bulk payloads are read into
+                                 * iobufs of their own further down, so
+                                 * anything bigger than a default page only
+                                 * needs a default page here.
+                                 */
+                                iobuf_pool = this->ctx->iobuf_pool;
+                                iobuf_size = iobpool_pagesize (iobuf_pool);
+
+                                if (RPC_LASTFRAG (priv->incoming.fraghdr))
+                                        iobuf_size = min (iobuf_size,
+                                                          RPC_FRAGSIZE (priv->incoming.fraghdr));
+
+                                iobuf = iobuf_get2 (iobuf_pool, iobuf_size);
+                                if (!iobuf) {
+                                        ret = -ENOMEM;
+                                        goto out;
+                                }
+
+                                priv->incoming.iobuf = iobuf;
+                                priv->incoming.frag.fragcurrent
+                                        = iobuf_ptr (iobuf);
+                        }
                         priv->incoming.record_state = SP_STATE_READING_FRAG;
                         priv->incoming.total_bytes_read
                                 += RPC_FRAGSIZE(priv->incoming.fraghdr);
@@ -1639,16 +1936,33 @@ int
 socket_event_poll_in (rpc_transport_t *this)
 {
         int                     ret    = -1;
+        int                     more   = 0;
         rpc_transport_pollin_t *pollin = NULL;
+        socket_private_t       *priv   = NULL;
 
-        ret = socket_proto_state_machine (this, &pollin);
+        priv = this->private;
+
+        /* records left in the receive buffer raise no further POLLIN, so
+         * keep parsing till it runs dry.
+         */
+        do {
+                pollin = NULL;
+                ret = socket_proto_state_machine (this, &pollin);
+
+                if (pollin == NULL)
+                        break;
 
-        if (pollin != NULL) {
                 ret = rpc_transport_notify (this, RPC_TRANSPORT_MSG_RECEIVED,
                                             pollin);
 
                 rpc_transport_pollin_destroy (pollin);
-        }
+
+                pthread_mutex_lock (&priv->lock);
+                {
+                        more = __socket_rbuf_pending (this);
+                }
+                pthread_mutex_unlock (&priv->lock);
+        } while ((ret >= 0) && more);
 
         return ret;
 }
@@ -2281,7 +2595,13 @@ socket_submit_request (rpc_transport_t *this, rpc_transport_req_t *req)
                         goto unlock;
 
                 if (list_empty (&priv->ioq)) {
-                        ret = __socket_ioq_churn_entry (this, entry);
+                        if (priv->ioq_batch) {
+                                /* let the burst collect, it goes out
+                                   in one writev () on POLLOUT */
+                                ret = 1;
+                        } else {
+                                ret = __socket_ioq_churn_entry (this, entry);
+                        }
 
                         if (ret == 0)
                                 need_append = 0;
@@ -2342,7 +2662,13 @@ socket_submit_reply (rpc_transport_t *this, rpc_transport_reply_t *reply)
                 if (!entry)
                         goto unlock;
                 if (list_empty (&priv->ioq)) {
-                        ret = __socket_ioq_churn_entry (this, entry);
+                        if (priv->ioq_batch) {
+                                /* let the burst collect, it goes out
+                                   in one writev () on POLLOUT */
+                                ret = 1;
+                        } else {
+                                ret = __socket_ioq_churn_entry (this, entry);
+                        }
 
                         if (ret == 0)
                                 need_append = 0;
@@ -2617,6 +2943,32 @@ socket_init (rpc_transport_t *this)
                 priv->keepaliveidle = keepalive;
         }
 
+        optstr = NULL;
+        if (dict_get_str (this->options, "transport.socket.ioq-batch",
+                          &optstr) == 0) {
+                if (gf_string2boolean (optstr, &tmp_bool) == -1) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "'transport.socket.ioq-batch' takes only "
+                                "boolean options, not taking any action");
+                        tmp_bool = 0;
+                }
+
+                priv->ioq_batch = tmp_bool;
+        }
+
+        optstr = NULL;
+        if (dict_get_str (this->options, "transport.socket.cork",
+                          &optstr) == 0) {
+                if (gf_string2boolean (optstr, &tmp_bool) == -1) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "'transport.socket.cork' takes only "
+                                "boolean options, not taking any action");
+                        tmp_bool = 0;
+                }
+
+                priv->cork = tmp_bool;
+        }
+
         priv->windowsize = (int)windowsize;
 out:
         this->private = priv;
@@ -2647,6 +2999,8 @@ fini (rpc_transport_t *this)
                         "transport %p destroyed", this);
 
                 pthread_mutex_destroy (&priv->lock);
+                if (priv->rbuf.base)
+                        GF_FREE (priv->rbuf.base);
                 GF_FREE (priv);
         }
 
@@ -2719,5 +3073,11 @@ struct volume_options options[] = {
         { .key   = {"transport.socket.keepalive-time"},
           .type  = GF_OPTION_TYPE_INT
         },
+        { .key   = {"transport.socket.ioq-batch"},
+          .type  = GF_OPTION_TYPE_BOOL
+        },
+        { .key   = {"transport.socket.cork"},
+          .type  = GF_OPTION_TYPE_BOOL
+        },
         { .key = {NULL} }
 };
@@ -37,6 +37,12 @@
 #define MAX_IOVEC 16
 #endif /* MAX_IOVEC */
 
+/* iovecs gathered from the ioq into a single writev () */
+#define SOCKET_IOQ_BATCH_IOVEC 1024
+
+/* bytes read ahead of the state machine in a single readv () */
+#define SOCKET_RBUF_SIZE (64 * GF_UNIT_KB)
+
 #define GF_DEFAULT_SOCKET_LISTEN_PORT  GF_DEFAULT_BASE_PORT
 
 #define RPC_MAX_FRAGMENT_SIZE 0x7fffffff
@@ -185,6 +191,11 @@ typedef struct {
                 msg_type_t           msg_type;
                 size_t               total_bytes_read;
         } incoming;
+        struct {
+                char                *base;   /* SOCKET_RBUF_SIZE bytes */
+                size_t               start;  /* first unparsed byte */
+                size_t               end;    /* one past the last byte */
+        } rbuf;
         pthread_mutex_t        lock;
         int                    windowsize;
         char                   lowlat;
@@ -192,6 +203,9 @@ typedef struct {
         int                    keepalive;
         int                    keepaliveidle;
         int                    keepaliveintvl;
+        char                   ioq_batch;  /* coalesce the ioq on POLLOUT */
+        char                   cork;       /* TCP_CORK batched bursts */
+        char                   corked;
 } socket_private_t;
 
 
@@ -884,10 +884,11 @@ xdr_from_unlink_req (struct iovec outmsg, void *req)
 /* Client decode */
 
 ssize_t
-xdr_to_lookup_rsp (struct iovec outmsg, void *rsp)
+xdr_to_lookup_rsp (struct iovec outmsg, void *rsp, struct iovec *payload)
 {
-        return xdr_to_generic (outmsg, (void *)rsp,
-                                      (xdrproc_t)xdr_gfs3_lookup_rsp);
+        return xdr_to_generic_payload (outmsg, (void *)rsp,
+                                       (xdrproc_t)xdr_gfs3_lookup_rsp,
+                                       payload);
 
 }
 
@@ -742,7 +742,7 @@ xdr_to_readdir_rsp (struct iovec inmsg, void *args);
 ssize_t
 xdr_to_opendir_rsp (struct iovec inmsg, void *args);
 ssize_t
-xdr_to_lookup_rsp (struct iovec inmsg, void *args);
+xdr_to_lookup_rsp (struct iovec inmsg, void *args, struct iovec *payload);
 ssize_t
 xdr_to_readv_rsp (struct iovec inmsg, void *args);
 ssize_t
@@ -65,6 +65,8 @@ allocate_domain (const char *volume)
         INIT_LIST_HEAD (&dom->inode_list);
         INIT_LIST_HEAD (&dom->entrylk_list);
         INIT_LIST_HEAD (&dom->blocked_entrylks);
+        INIT_LIST_HEAD (&dom->entrylk_all);
+        INIT_LIST_HEAD (&dom->blocked_entrylk_all);
         INIT_LIST_HEAD (&dom->inodelk_list);
         INIT_LIST_HEAD (&dom->blocked_inodelks);
 
@@ -502,6 +504,11 @@ out:
 void
 __delete_lock (pl_inode_t *pl_inode, posix_lock_t *lock)
 {
+        if (lock->blocked)
+                pl_itree_remove (&pl_inode->blocked_locks, &lock->range);
+        else
+                pl_itree_remove (&pl_inode->granted_locks, &lock->range);
+
         list_del_init (&lock->list);
 }
 
@@ -535,6 +542,13 @@ __insert_lock (pl_inode_t *pl_inode, posix_lock_t *lock)
 {
         list_add_tail (&lock->list, &pl_inode->ext_list);
 
+        if (lock->blocked)
+                pl_itree_insert (&pl_inode->blocked_locks, &lock->range,
+                                 lock->fl_start, lock->fl_end);
+        else
+                pl_itree_insert (&pl_inode->granted_locks, &lock->range,
+                                 lock->fl_start, lock->fl_end);
+
         return;
 }
 
@@ -565,22 +579,6 @@ same_owner (posix_lock_t *l1, posix_lock_t *l2)
 }
 
 
-/* Delete all F_UNLCK locks */
-void
-__delete_unlck_locks (pl_inode_t *pl_inode)
-{
-        posix_lock_t *l = NULL;
-        posix_lock_t *tmp = NULL;
-
-        list_for_each_entry_safe (l, tmp, &pl_inode->ext_list, list) {
-                if (l->fl_type == F_UNLCK) {
-                        __delete_lock (pl_inode, l);
-                        __destroy_lock (l);
-                }
-        }
-}
-
-
 /* Add two locks */
 static posix_lock_t *
 add_locks (posix_lock_t *l1, posix_lock_t *l2)
@@ -595,6 +593,8 @@ add_locks (posix_lock_t *l1, posix_lock_t *l2)
         sum->fl_start = min (l1->fl_start, l2->fl_start);
         sum->fl_end   = max (l1->fl_end, l2->fl_end);
 
+        INIT_LIST_HEAD (&sum->list);
+
         return sum;
 }
 
@@ -709,25 +709,66 @@ done:
         return v;
 }
 
+struct _overlap {
+        posix_lock_t *lock;
+        posix_lock_t *found;
+};
+
+static int
+overlap_any (pl_itree_node_t *node, void *data)
+{
+        struct _overlap *q = data;
+
+        q->found = pl_itree_entry (node, posix_lock_t, range);
+        return 1;
+}
+
+static int
+overlap_conflict (pl_itree_node_t *node, void *data)
+{
+        struct _overlap *q = data;
+        posix_lock_t    *l = NULL;
+
+        l = pl_itree_entry (node, posix_lock_t, range);
+
+        if (((l->fl_type == F_WRLCK) || (q->lock->fl_type == F_WRLCK))
+            && !same_owner (l, q->lock)) {
+                q->found = l;
+                return 1;
+        }
+
+        return 0;
+}
+
+static int
+overlap_same_owner (pl_itree_node_t *node, void *data)
+{
+        struct _overlap *q = data;
+        posix_lock_t    *l = NULL;
+
+        l = pl_itree_entry (node, posix_lock_t, range);
+
+        if (same_owner (l, q->lock)) {
+                q->found = l;
+                return 1;
+        }
+
+        return 0;
+}
+
 /*
-  Start searching from {begin}, and return the first lock that
-  conflicts, NULL if no conflict
-  If {begin} is NULL, then start from the beginning of the list
+  Return the granted lock with the lowest start offset which overlaps
+  {lock}, NULL if there is none
 */
 static posix_lock_t *
 first_overlap (pl_inode_t *pl_inode, posix_lock_t *lock)
 {
-        posix_lock_t *l = NULL;
+        struct _overlap q = {lock, NULL};
 
-        list_for_each_entry (l, &pl_inode->ext_list, list) {
-                if (l->blocked)
-                        continue;
-
-                if (locks_overlap (l, lock))
-                        return l;
-        }
+        pl_itree_walk (pl_inode->granted_locks, lock->fl_start, lock->fl_end,
+                       overlap_any, &q);
 
-        return NULL;
+        return q.found;
 }
 
 
@@ -736,21 +777,15 @@ first_overlap (pl_inode_t *pl_inode, posix_lock_t *lock)
 static int
 __is_lock_grantable (pl_inode_t *pl_inode, posix_lock_t *lock)
 {
-        posix_lock_t *l = NULL;
-        int           ret = 1;
-
-        list_for_each_entry (l, &pl_inode->ext_list, list) {
-                if (!l->blocked && locks_overlap (lock, l)) {
-                        if (((l->fl_type == F_WRLCK)
-                             || (lock->fl_type == F_WRLCK))
-                            && (lock->fl_type != F_UNLCK)
-                            && !same_owner (l, lock)) {
-                                ret = 0;
-                                break;
-                        }
-                }
-        }
-        return ret;
+        struct _overlap q = {lock, NULL};
+
+        if (lock->fl_type == F_UNLCK)
+                return 1;
+
+        pl_itree_walk (pl_inode->granted_locks, lock->fl_start, lock->fl_end,
+                       overlap_conflict, &q);
+
+        return (q.found == NULL);
 }
 
 
@@ -761,71 +796,62 @@ static void
 __insert_and_merge (pl_inode_t *pl_inode, posix_lock_t *lock)
 {
         posix_lock_t  *conf = NULL;
-        posix_lock_t  *t = NULL;
         posix_lock_t  *sum = NULL;
         int            i = 0;
         struct _values v = { .locks = {0, 0, 0} };
+        struct _overlap q = {lock, NULL};
 
-        list_for_each_entry_safe (conf, t, &pl_inode->ext_list, list) {
-                if (!locks_overlap (conf, lock))
-                        continue;
-
-                if (same_owner (conf, lock)) {
-                        if (conf->fl_type == lock->fl_type) {
-                                sum = add_locks (lock, conf);
+        /* only the owner's own overlapping locks are merged or split,
+           locks of other owners are left alone */
+        pl_itree_walk (pl_inode->granted_locks, lock->fl_start, lock->fl_end,
+                       overlap_same_owner, &q);
 
-                                sum->fl_type    = lock->fl_type;
-                                sum->transport  = lock->transport;
-                                sum->fd_num     = lock->fd_num;
-                                sum->client_pid = lock->client_pid;
-                                sum->owner      = lock->owner;
+        conf = q.found;
+        if (conf) {
+                if (conf->fl_type == lock->fl_type) {
+                        sum = add_locks (lock, conf);
 
-                                __delete_lock (pl_inode, conf);
-                                __destroy_lock (conf);
+                        sum->fl_type    = lock->fl_type;
+                        sum->transport  = lock->transport;
+                        sum->fd_num     = lock->fd_num;
+                        sum->client_pid = lock->client_pid;
+                        sum->owner      = lock->owner;
 
-                                __destroy_lock (lock);
-                                __insert_and_merge (pl_inode, sum);
+                        __delete_lock (pl_inode, conf);
+                        __destroy_lock (conf);
 
-                                return;
-                        } else {
-                                sum = add_locks (lock, conf);
+                        __destroy_lock (lock);
+                        __insert_and_merge (pl_inode, sum);
 
-                                sum->fl_type    = conf->fl_type;
-                                sum->transport  = conf->transport;
-                                sum->fd_num     = conf->fd_num;
-                                sum->client_pid = conf->client_pid;
-                                sum->owner      = conf->owner;
+                        return;
+                } else {
+                        sum = add_locks (lock, conf);
 
-                                v = subtract_locks (sum, lock);
+                        sum->fl_type    = conf->fl_type;
+                        sum->transport  = conf->transport;
+                        sum->fd_num     = conf->fd_num;
+                        sum->client_pid = conf->client_pid;
+                        sum->owner      = conf->owner;
 
-                                __delete_lock (pl_inode, conf);
-                                __destroy_lock (conf);
+                        v = subtract_locks (sum, lock);
 
-                                __delete_lock (pl_inode, lock);
-                                __destroy_lock (lock);
+                        __delete_lock (pl_inode, conf);
+                        __destroy_lock (conf);
 
-                                __destroy_lock (sum);
+                        __delete_lock (pl_inode, lock);
+                        __destroy_lock (lock);
 
-                                for (i = 0; i < 3; i++) {
-                                        if (!v.locks[i])
-                                                continue;
+                        __destroy_lock (sum);
 
-                                        INIT_LIST_HEAD (&v.locks[i]->list);
-                                        __insert_and_merge (pl_inode,
-                                                            v.locks[i]);
-                                }
+                        for (i = 0; i < 3; i++) {
+                                if (!v.locks[i])
+                                        continue;
 
-                                __delete_unlck_locks (pl_inode);
-                                return;
+                                INIT_LIST_HEAD (&v.locks[i]->list);
+                                __insert_and_merge (pl_inode,
+                                                    v.locks[i]);
                         }
-                }
-
-                if (lock->fl_type == F_UNLCK) {
-                        continue;
-                }
 
-                if ((conf->fl_type == F_RDLCK) && (lock->fl_type == F_RDLCK)) {
-                        __insert_lock (pl_inode, lock);
                         return;
                 }
         }
@@ -839,25 +865,46 @@ __insert_and_merge (pl_inode_t *pl_inode, posix_lock_t *lock)
 }
 
 
-void
-__grant_blocked_locks (xlator_t *this, pl_inode_t *pl_inode, struct list_head *granted)
+struct _unblocked {
+        pl_inode_t       *pl_inode;
+        struct list_head *list;
+};
+
+static int
+collect_unblocked (pl_itree_node_t *node, void *data)
+{
+        struct _unblocked *u = data;
+        posix_lock_t      *l = NULL;
+
+        l = pl_itree_entry (node, posix_lock_t, range);
+
+        if (!first_overlap (u->pl_inode, l))
+                list_move_tail (&l->list, u->list);
+
+        return 0;
+}
+
+
+/* Only blocked locks overlapping [start, end] are looked at; the caller
+   passes the range in which granted locks were removed or changed */
+static void
+__grant_blocked_locks (xlator_t *this, pl_inode_t *pl_inode,
+                       off_t start, off_t end, struct list_head *granted)
 {
         struct list_head  tmp_list;
         posix_lock_t     *l = NULL;
         posix_lock_t     *tmp = NULL;
         posix_lock_t     *conf = NULL;
+        struct _unblocked u = {pl_inode, &tmp_list};
 
         INIT_LIST_HEAD (&tmp_list);
 
-        list_for_each_entry_safe (l, tmp, &pl_inode->ext_list, list) {
-                if (l->blocked) {
-                        conf = first_overlap (pl_inode, l);
-                        if (conf)
-                                continue;
+        pl_itree_walk (pl_inode->blocked_locks, start, end,
+                       collect_unblocked, &u);
 
-                        l->blocked = 0;
-                        list_move_tail (&l->list, &tmp_list);
-                }
+        list_for_each_entry (l, &tmp_list, list) {
+                pl_itree_remove (&pl_inode->blocked_locks, &l->range);
+                l->blocked = 0;
         }
 
         list_for_each_entry_safe (l, tmp, &tmp_list, list) {
@@ -897,8 +944,9 @@ __grant_blocked_locks (xlator_t *this, pl_inode_t *pl_inode, struct list_head *g
 }
 
 
-void
-grant_blocked_locks (xlator_t *this, pl_inode_t *pl_inode)
+static void
+grant_blocked_locks_range (xlator_t *this, pl_inode_t *pl_inode,
+                           off_t start, off_t end)
 {
         struct list_head granted_list;
         posix_lock_t     *tmp = NULL;
@@ -908,7 +956,8 @@ grant_blocked_locks (xlator_t *this, pl_inode_t *pl_inode)
 
         pthread_mutex_lock (&pl_inode->mutex);
         {
-                __grant_blocked_locks (this, pl_inode, &granted_list);
+                __grant_blocked_locks (this, pl_inode, start, end,
+                                       &granted_list);
         }
         pthread_mutex_unlock (&pl_inode->mutex);
 
@@ -926,6 +975,13 @@ grant_blocked_locks (xlator_t *this, pl_inode_t *pl_inode)
         return;
 }
 
+
+void
+grant_blocked_locks (xlator_t *this, pl_inode_t *pl_inode)
+{
+        grant_blocked_locks_range (this, pl_inode, 0, LLONG_MAX);
+}
+
 static int
 pl_send_prelock_unlock (xlator_t *this, pl_inode_t *pl_inode,
                         posix_lock_t *old_lock)
@@ -955,7 +1011,8 @@ pl_send_prelock_unlock (xlator_t *this, pl_inode_t *pl_inode,
 
         __insert_and_merge (pl_inode, unlock_lock);
 
-        __grant_blocked_locks (this, pl_inode, &granted_list);
+        __grant_blocked_locks (this, pl_inode, old_lock->fl_start,
+                               old_lock->fl_end, &granted_list);
 
         list_for_each_entry_safe (lock, tmp, &granted_list, list) {
                 list_del_init (&lock->list);
@@ -977,9 +1034,15 @@ pl_setlk (xlator_t *this, pl_inode_t *pl_inode, posix_lock_t *lock,
           int can_block)
 {
         int              ret = 0;
+        off_t            start = 0;
+        off_t            end = 0;
 
         errno = 0;
 
+        /* {lock} may be merged and freed below */
+        start = lock->fl_start;
+        end   = lock->fl_end;
+
         pthread_mutex_lock (&pl_inode->mutex);
         {
                 /* Send unlock before the actual lock to
@@ -1033,7 +1096,7 @@ pl_setlk (xlator_t *this, pl_inode_t *pl_inode, posix_lock_t *lock,
         }
         pthread_mutex_unlock (&pl_inode->mutex);
 
-        grant_blocked_locks (this, pl_inode);
+        grant_blocked_locks_range (this, pl_inode, start, end);
 
         do_blocked_rw (pl_inode);
 
@@ -57,7 +57,7 @@ void
 grant_blocked_inode_locks (xlator_t *this, pl_inode_t *pl_inode, pl_dom_list_t *dom);
 
 void
-__delete_inode_lock (pl_inode_lock_t *lock);
+__delete_inode_lock (pl_dom_list_t *dom, pl_inode_lock_t *lock);
 
 void
 __destroy_inode_lock (pl_inode_lock_t *lock);
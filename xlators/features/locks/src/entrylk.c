@@ -29,6 +29,7 @@
 #include "logging.h"
 #include "common-utils.h"
 #include "list.h"
+#include "hashfn.h"
 
 #include "locks.h"
 #include "common.h"
@@ -55,6 +56,7 @@ new_entrylk_lock (pl_inode_t *pinode, const char *basename, entrylk_type type,
 
         INIT_LIST_HEAD (&newlock->domain_list);
         INIT_LIST_HEAD (&newlock->blocked_locks);
+        INIT_LIST_HEAD (&newlock->hash_list);
 
 out:
         return newlock;
@@ -68,16 +70,77 @@ out:
 
 #define all_names(basename) ((basename == NULL) ? 1 : 0)
 
-/**
- * names_conflict - do two names conflict?
- * @n1: name
- * @n2: name
- */
+static int
+names_equal (const char *n1, const char *n2)
+{
+        return (n1 == NULL && n2 == NULL) || (n1 && n2 && !strcmp (n1, n2));
+}
+
+
+/* Entry locks of a domain are also indexed by a hash of the basename, so
+   that locks on unrelated names in a big directory don't have to be
+   compared against each other. Full-directory locks (NULL basename) are
+   kept on lists of their own. */
+
+#define ENTRYLK_HASH_SIZE 128
 
 static int
-names_conflict (const char *n1, const char *n2)
+__entrylk_index_init (pl_dom_list_t *dom)
+{
+        int i = 0;
+
+        if (dom->entrylk_hash)
+                return 0;
+
+        dom->entrylk_hash = GF_CALLOC (2 * ENTRYLK_HASH_SIZE,
+                                       sizeof (struct list_head),
+                                       gf_locks_mt_entrylk_hash);
+        if (!dom->entrylk_hash)
+                return -1;
+
+        for (i = 0; i < 2 * ENTRYLK_HASH_SIZE; i++)
+                INIT_LIST_HEAD (&dom->entrylk_hash[i]);
+
+        dom->blocked_entrylk_hash = dom->entrylk_hash + ENTRYLK_HASH_SIZE;
+
+        return 0;
+}
+
+
+static struct list_head *
+__entrylk_bucket (pl_dom_list_t *dom, const char *basename, int blocked)
 {
-        return all_names (n1) || all_names (n2) || !strcmp (n1, n2);
+        uint32_t hash = 0;
+
+        if (all_names (basename))
+                return (blocked ? &dom->blocked_entrylk_all
+                        : &dom->entrylk_all);
+
+        if (!dom->entrylk_hash)
+                return NULL;
+
+        hash = SuperFastHash (basename, strlen (basename))
+                % ENTRYLK_HASH_SIZE;
+
+        return (blocked ? &dom->blocked_entrylk_hash[hash]
+                : &dom->entrylk_hash[hash]);
+}
+
+
+static pl_entry_lock_t *
+__entrylk_find (struct list_head *bucket, const char *basename)
+{
+        pl_entry_lock_t *lock = NULL;
+
+        if (!bucket)
+                return NULL;
+
+        list_for_each_entry (lock, bucket, hash_list) {
+                if (names_equal (lock->basename, basename))
+                        return lock;
+        }
+
+        return NULL;
 }
 
 
@@ -99,33 +162,36 @@ __same_entrylk_owner (pl_entry_lock_t *l1, pl_entry_lock_t *l2)
 static pl_entry_lock_t *
 __lock_grantable (pl_dom_list_t *dom, const char *basename, entrylk_type type)
 {
-        pl_entry_lock_t *lock = NULL;
-
         if (list_empty (&dom->entrylk_list))
                 return NULL;
 
-        list_for_each_entry (lock, &dom->entrylk_list, domain_list) {
-                if (names_conflict (lock->basename, basename))
-                        return lock;
-        }
+        /* a full-directory lock conflicts with any lock */
+        if (all_names (basename))
+                return list_entry (dom->entrylk_list.next,
+                                   pl_entry_lock_t, domain_list);
 
-        return NULL;
+        if (!list_empty (&dom->entrylk_all))
+                return list_entry (dom->entrylk_all.next,
+                                   pl_entry_lock_t, hash_list);
+
+        return __entrylk_find (__entrylk_bucket (dom, basename, 0), basename);
 }
 
 static pl_entry_lock_t *
 __blocked_lock_conflict (pl_dom_list_t *dom, const char *basename, entrylk_type type)
 {
-        pl_entry_lock_t *lock = NULL;
-
         if (list_empty (&dom->blocked_entrylks))
                 return NULL;
 
-        list_for_each_entry (lock, &dom->blocked_entrylks, blocked_locks) {
-                if (names_conflict (lock->basename, basename))
-                        return lock;
-        }
+        if (all_names (basename))
+                return list_entry (dom->blocked_entrylks.next,
+                                   pl_entry_lock_t, blocked_locks);
 
-        return NULL;
+        if (!list_empty (&dom->blocked_entrylk_all))
+                return list_entry (dom->blocked_entrylk_all.next,
+                                   pl_entry_lock_t, hash_list);
+
+        return __entrylk_find (__entrylk_bucket (dom, basename, 1), basename);
 }
 
 static int
@@ -146,12 +212,6 @@ __owner_has_lock (pl_dom_list_t *dom, pl_entry_lock_t *newlock)
         return 0;
 }
 
-static int
-names_equal (const char *n1, const char *n2)
-{
-        return (n1 == NULL && n2 == NULL) || (n1 && n2 && !strcmp (n1, n2));
-}
-
 void
 pl_print_entrylk (char *str, int size, entrylk_cmd cmd, entrylk_type type,
                   const char *basename, const char *domain)
@@ -284,21 +344,21 @@ entrylk_trace_block (xlator_t *this, call_frame_t *frame, const char *volume,
 static pl_entry_lock_t *
 __find_most_matching_lock (pl_dom_list_t *dom, const char *basename)
 {
-        pl_entry_lock_t *lock;
-        pl_entry_lock_t *all = NULL;
         pl_entry_lock_t *exact = NULL;
 
         if (list_empty (&dom->entrylk_list))
                 return NULL;
 
-        list_for_each_entry (lock, &dom->entrylk_list, domain_list) {
-                if (all_names (lock->basename))
-                        all = lock;
-                else if (names_equal (lock->basename, basename))
-                        exact = lock;
-        }
+        if (!all_names (basename))
+                exact = __entrylk_find (__entrylk_bucket (dom, basename, 0),
+                                        basename);
+        if (exact)
+                return exact;
+
+        if (list_empty (&dom->entrylk_all))
+                return NULL;
 
-        return (exact ? exact : all);
+        return list_entry (dom->entrylk_all.next, pl_entry_lock_t, hash_list);
 }
 
 /**
@@ -328,6 +388,11 @@ __lock_name (pl_inode_t *pinode, const char *basename, entrylk_type type,
         client_pid = frame->root->pid;
         owner      = frame->root->lk_owner;
 
+        if (!all_names (basename) && __entrylk_index_init (dom)) {
+                ret = -ENOMEM;
+                goto out;
+        }
+
         lock = new_entrylk_lock (pinode, basename, type, trans, client_pid, owner, dom->domain);
         if (!lock) {
                 ret = -ENOMEM;
@@ -350,6 +415,8 @@ __lock_name (pl_inode_t *pinode, const char *basename, entrylk_type type,
                 }
 
                 list_add_tail (&lock->blocked_locks, &dom->blocked_entrylks);
+                list_add_tail (&lock->hash_list,
+                               __entrylk_bucket (dom, basename, 1));
 
                 gf_log (this->name, GF_LOG_TRACE,
                         "Blocking lock: {pinode=%p, basename=%s}",
@@ -371,6 +438,8 @@ __lock_name (pl_inode_t *pinode, const char *basename, entrylk_type type,
                 lock->this      = this;
 
                 list_add_tail (&lock->blocked_locks, &dom->blocked_entrylks);
+                list_add_tail (&lock->hash_list,
+                               __entrylk_bucket (dom, basename, 1));
 
                 gf_log (this->name, GF_LOG_TRACE,
                         "Lock is grantable, but blocking to prevent starvation");
@@ -385,6 +454,8 @@ __lock_name (pl_inode_t *pinode, const char *basename, entrylk_type type,
 
         case ENTRYLK_WRLCK:
                 list_add_tail (&lock->domain_list, &dom->entrylk_list);
+                list_add_tail (&lock->hash_list,
+                               __entrylk_bucket (dom, basename, 0));
                 break;
 
         default:
@@ -427,6 +498,7 @@ __unlock_name (pl_dom_list_t *dom, const char *basename, entrylk_type type)
 
                 if (type == ENTRYLK_WRLCK) {
                         list_del_init (&lock->domain_list);
+                        list_del_init (&lock->hash_list);
                         ret_lock = lock;
                 }
         } else {
@@ -440,18 +512,42 @@ out:
 }
 
 
+/* Retry blocked locks after {unlocked} went away; NULL {unlocked}
+   retries everything. When no full-directory lock is waiting, locks on
+   other names neither wait for a named lock nor influence each other,
+   so only the waiters on the same name need to be looked at. */
 void
 __grant_blocked_entry_locks (xlator_t *this, pl_inode_t *pl_inode,
-                             pl_dom_list_t *dom, struct list_head *granted)
+                             pl_dom_list_t *dom, pl_entry_lock_t *unlocked,
+                             struct list_head *granted)
 {
         int              bl_ret = 0;
         pl_entry_lock_t *bl   = NULL;
         pl_entry_lock_t *tmp  = NULL;
+        struct list_head *bucket = NULL;
 
         struct list_head blocked_list;
 
         INIT_LIST_HEAD (&blocked_list);
-        list_splice_init (&dom->blocked_entrylks, &blocked_list);
+
+        if (!unlocked || all_names (unlocked->basename)
+            || !list_empty (&dom->blocked_entrylk_all)) {
+                list_splice_init (&dom->blocked_entrylks, &blocked_list);
+        } else {
+                bucket = __entrylk_bucket (dom, unlocked->basename, 1);
+                if (bucket) {
+                        list_for_each_entry (bl, bucket, hash_list) {
+                                if (names_equal (bl->basename,
+                                                 unlocked->basename))
+                                        list_move_tail (&bl->blocked_locks,
+                                                        &blocked_list);
+                        }
+                }
+        }
+
+        /* none of the retried locks may block the others */
+        list_for_each_entry (bl, &blocked_list, blocked_locks)
+                list_del_init (&bl->hash_list);
 
         list_for_each_entry_safe (bl, tmp, &blocked_list,
                                   blocked_locks) {
@@ -492,7 +588,8 @@ grant_blocked_entry_locks (xlator_t *this, pl_inode_t *pl_inode,
 
         pthread_mutex_lock (&pl_inode->mutex);
         {
-                __grant_blocked_entry_locks (this, pl_inode, dom, &granted_list);
+                __grant_blocked_entry_locks (this, pl_inode, dom, unlocked,
+                                             &granted_list);
         }
         pthread_mutex_unlock (&pl_inode->mutex);
 
@@ -538,6 +635,7 @@ release_entry_locks_for_transport (xlator_t *this, pl_inode_t *pinode,
                                 continue;
 
                         list_del_init (&lock->blocked_locks);
+                        list_del_init (&lock->hash_list);
 
                         gf_log (this->name, GF_LOG_TRACE,
                                 "releasing lock on  held by "
@@ -553,6 +651,7 @@ release_entry_locks_for_transport (xlator_t *this, pl_inode_t *pinode,
                                 continue;
 
                         list_del_init (&lock->domain_list);
+                        list_del_init (&lock->hash_list);
 
                         gf_log (this->name, GF_LOG_TRACE,
                                 "releasing lock on  held by "
@@ -562,7 +661,8 @@ release_entry_locks_for_transport (xlator_t *this, pl_inode_t *pinode,
                         GF_FREE (lock);
                 }
 
-                __grant_blocked_entry_locks (this, pinode, dom, &granted);
+                __grant_blocked_entry_locks (this, pinode, dom, NULL,
+                                             &granted);
 
         }
 
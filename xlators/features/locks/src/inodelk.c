@@ -34,8 +34,9 @@
 #include "common.h"
 
 void
-__delete_inode_lock (pl_inode_lock_t *lock)
+__delete_inode_lock (pl_dom_list_t *dom, pl_inode_lock_t *lock)
 {
+        pl_itree_remove (&dom->inodelk_tree, &lock->range);
         list_del (&lock->list);
 }
 
@@ -111,14 +112,6 @@ pl_print_inodelk (char *str, int size, int cmd, struct gf_flock *flock, const ch
                   (unsigned long long) flock->l_pid);
 }
 
-/* Determine if the two inodelks overlap reach other's lock regions */
-static int
-inodelk_overlap (pl_inode_lock_t *l1, pl_inode_lock_t *l2)
-{
-        return ((l1->fl_end >= l2->fl_start) &&
-                (l2->fl_end >= l1->fl_start));
-}
-
 /* Returns true if the 2 inodelks have the same owner */
 static int same_inodelk_owner (pl_inode_lock_t *l1, pl_inode_lock_t *l2)
 {
@@ -126,50 +119,51 @@ static int same_inodelk_owner (pl_inode_lock_t *l1, pl_inode_lock_t *l2)
                 (l1->transport  == l2->transport));
 }
 
-/* Returns true if the 2 inodelks conflict with each other */
+struct _inodelk_query {
+        pl_inode_lock_t *lock;
+        pl_inode_lock_t *found;
+};
+
 static int
-inodelk_conflict (pl_inode_lock_t *l1, pl_inode_lock_t *l2)
+inodelk_conflict_cbk (pl_itree_node_t *node, void *data)
 {
-        return (inodelk_overlap (l1, l2) &&
-                inodelk_type_conflict (l1, l2));
+        struct _inodelk_query *q = data;
+        pl_inode_lock_t       *l = NULL;
+
+        l = pl_itree_entry (node, pl_inode_lock_t, range);
+
+        if (inodelk_type_conflict (q->lock, l)) {
+                q->found = l;
+                return 1;
+        }
+
+        return 0;
 }
 
 /* Determine if lock is grantable or not */
 static pl_inode_lock_t *
 __inodelk_grantable (pl_dom_list_t *dom, pl_inode_lock_t *lock)
 {
-        pl_inode_lock_t *l = NULL;
-        pl_inode_lock_t *ret = NULL;
-        if (list_empty (&dom->inodelk_list))
-                goto out;
-        list_for_each_entry (l, &dom->inodelk_list, list){
-                if (inodelk_conflict (lock, l)) {
-                        ret = l;
-                        goto out;
-                }
-        }
-out:
-        return ret;
+        struct _inodelk_query q = {lock, NULL};
+
+        pl_itree_walk (dom->inodelk_tree, lock->fl_start, lock->fl_end,
+                       inodelk_conflict_cbk, &q);
+
+        return q.found;
 }
 
 static pl_inode_lock_t *
 __blocked_lock_conflict (pl_dom_list_t *dom, pl_inode_lock_t *lock)
 {
-        pl_inode_lock_t *l   = NULL;
-        pl_inode_lock_t *ret = NULL;
+        struct _inodelk_query q = {lock, NULL};
 
         if (list_empty (&dom->blocked_entrylks))
                 return NULL;
 
-        list_for_each_entry (l, &dom->blocked_inodelks, blocked_locks) {
-                if (inodelk_conflict (lock, l)) {
-                        ret = l;
-                        goto out;
-                }
-        }
+        pl_itree_walk (dom->blocked_tree, lock->fl_start, lock->fl_end,
+                       inodelk_conflict_cbk, &q);
 
-out:
-        return ret;
+        return q.found;
 }
 
 static int
@@ -208,6 +202,8 @@ __lock_inodelk (xlator_t *this, pl_inode_t *pl_inode, pl_inode_lock_t *lock,
                         goto out;
 
                 list_add_tail (&lock->blocked_locks, &dom->blocked_inodelks);
+                pl_itree_insert (&dom->blocked_tree, &lock->range,
+                                 lock->fl_start, lock->fl_end);
 
                 gf_log (this->name, GF_LOG_TRACE,
                         "%s (pid=%d) lk-owner:%"PRIu64" %"PRId64" - %"PRId64" => Blocked",
@@ -227,6 +223,8 @@ __lock_inodelk (xlator_t *this, pl_inode_t *pl_inode, pl_inode_lock_t *lock,
                         goto out;
 
                 list_add_tail (&lock->blocked_locks, &dom->blocked_inodelks);
+                pl_itree_insert (&dom->blocked_tree, &lock->range,
+                                 lock->fl_start, lock->fl_end);
 
                 gf_log (this->name, GF_LOG_TRACE,
                         "Lock is grantable, but blocking to prevent starvation");
@@ -242,6 +240,8 @@ __lock_inodelk (xlator_t *this, pl_inode_t *pl_inode, pl_inode_lock_t *lock,
                 goto out;
         }
         list_add (&lock->list, &dom->inodelk_list);
+        pl_itree_insert (&dom->inodelk_tree, &lock->range,
+                         lock->fl_start, lock->fl_end);
 
         ret = 0;
 
@@ -261,16 +261,33 @@ inodelks_equal (pl_inode_lock_t *l1, pl_inode_lock_t *l2)
 }
 
 
+static int
+inodelk_match_cbk (pl_itree_node_t *node, void *data)
+{
+        struct _inodelk_query *q = data;
+        pl_inode_lock_t       *l = NULL;
+
+        l = pl_itree_entry (node, pl_inode_lock_t, range);
+
+        if (inodelks_equal (l, q->lock) &&
+            same_inodelk_owner (l, q->lock)) {
+                q->found = l;
+                return 1;
+        }
+
+        return 0;
+}
+
 static pl_inode_lock_t *
 find_matching_inodelk (pl_inode_lock_t *lock, pl_dom_list_t *dom)
 {
-        pl_inode_lock_t *l = NULL;
-        list_for_each_entry (l, &dom->inodelk_list, list) {
-                if (inodelks_equal (l, lock) &&
-                    same_inodelk_owner (l, lock))
-                        return l;
-        }
-        return NULL;
+        struct _inodelk_query q = {lock, NULL};
+
+        /* an exact match covers lock->fl_start */
+        pl_itree_walk (dom->inodelk_tree, lock->fl_start, lock->fl_start,
+                       inodelk_match_cbk, &q);
+
+        return q.found;
 }
 
 /* Set F_UNLCK removes a lock which has the exact same lock boundaries
@@ -288,7 +305,7 @@ __inode_unlock_lock (xlator_t *this, pl_inode_lock_t *lock, pl_dom_list_t *dom)
                         " Matching lock not found for unlock");
                 goto out;
         }
-        __delete_inode_lock (conf);
+        __delete_inode_lock (dom, conf);
         gf_log (this->name, GF_LOG_DEBUG,
                 " Matching lock found for unlock");
         __destroy_inode_lock (lock);
@@ -299,9 +316,24 @@ out:
 
 
 }
+static int
+collect_blocked_inodelk (pl_itree_node_t *node, void *data)
+{
+        struct list_head *list = data;
+        pl_inode_lock_t  *l = NULL;
+
+        l = pl_itree_entry (node, pl_inode_lock_t, range);
+        list_move_tail (&l->blocked_locks, list);
+
+        return 0;
+}
+
+/* Retry the blocked locks overlapping [start, end], the range in which
+   granted locks went away */
 static void
 __grant_blocked_inode_locks (xlator_t *this, pl_inode_t *pl_inode,
-                             struct list_head *granted, pl_dom_list_t *dom)
+                             struct list_head *granted, pl_dom_list_t *dom,
+                             off_t start, off_t end)
 {
         int              bl_ret = 0;
         pl_inode_lock_t *bl = NULL;
@@ -310,7 +342,12 @@ __grant_blocked_inode_locks (xlator_t *this, pl_inode_t *pl_inode,
         struct list_head blocked_list;
 
         INIT_LIST_HEAD (&blocked_list);
-        list_splice_init (&dom->blocked_inodelks, &blocked_list);
+
+        pl_itree_walk (dom->blocked_tree, start, end,
+                       collect_blocked_inodelk, &blocked_list);
+
+        list_for_each_entry (bl, &blocked_list, blocked_locks)
+                pl_itree_remove (&dom->blocked_tree, &bl->range);
 
         list_for_each_entry_safe (bl, tmp, &blocked_list, blocked_locks) {
 
@@ -325,9 +362,9 @@ __grant_blocked_inode_locks (xlator_t *this, pl_inode_t *pl_inode,
         return;
 }
 
-/* Grant all inodelks blocked on a lock */
-void
-grant_blocked_inode_locks (xlator_t *this, pl_inode_t *pl_inode, pl_dom_list_t *dom)
+static void
+grant_blocked_inode_locks_range (xlator_t *this, pl_inode_t *pl_inode,
+                                 pl_dom_list_t *dom, off_t start, off_t end)
 {
         struct list_head granted;
         pl_inode_lock_t *lock;
@@ -342,7 +379,8 @@ grant_blocked_inode_locks (xlator_t *this, pl_inode_t *pl_inode, pl_dom_list_t *
 
         pthread_mutex_lock (&pl_inode->mutex);
         {
-                __grant_blocked_inode_locks (this, pl_inode, &granted, dom);
+                __grant_blocked_inode_locks (this, pl_inode, &granted, dom,
+                                             start, end);
         }
         pthread_mutex_unlock (&pl_inode->mutex);
 
@@ -363,6 +401,13 @@ grant_blocked_inode_locks (xlator_t *this, pl_inode_t *pl_inode, pl_dom_list_t *
 
 }
 
+/* Grant all inodelks blocked on a lock */
+void
+grant_blocked_inode_locks (xlator_t *this, pl_inode_t *pl_inode, pl_dom_list_t *dom)
+{
+        grant_blocked_inode_locks_range (this, pl_inode, dom, 0, LLONG_MAX);
+}
+
 /* Release all inodelks from this transport */
 static int
 release_inode_locks_of_transport (xlator_t *this, pl_dom_list_t *dom,
@@ -390,6 +435,7 @@ release_inode_locks_of_transport (xlator_t *this, pl_dom_list_t *dom,
                         if (l->transport != trans)
                                 continue;
 
+                        pl_itree_remove (&dom->blocked_tree, &l->range);
                         list_del_init (&l->blocked_locks);
 
                         if (inode_path (inode, NULL, &path) < 0) {
@@ -413,7 +459,7 @@ release_inode_locks_of_transport (xlator_t *this, pl_dom_list_t *dom,
                         if (l->transport != trans)
                                 continue;
 
-                        __delete_inode_lock (l);
+                        __delete_inode_lock (dom, l);
                         __destroy_inode_lock (l);
 
 
@@ -457,6 +503,8 @@ pl_inode_setlk (xlator_t *this, pl_inode_t *pl_inode, pl_inode_lock_t *lock,
 {
         int ret = -EINVAL;
         pl_inode_lock_t *retlock = NULL;
+        off_t start = lock->fl_start;
+        off_t end = lock->fl_end;
 
         pthread_mutex_lock (&pl_inode->mutex);
         {
@@ -499,7 +547,7 @@ pl_inode_setlk (xlator_t *this, pl_inode_t *pl_inode, pl_inode_lock_t *lock,
         }
 out:
         pthread_mutex_unlock (&pl_inode->mutex);
-        grant_blocked_inode_locks (this, pl_inode, dom);
+        grant_blocked_inode_locks_range (this, pl_inode, dom, start, end);
         return ret;
 }
 
@@ -0,0 +1,197 @@
+/*
+  Copyright (c) 2010 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include "interval-tree.h"
+
+/* Lock structures come from the allocator, so a multiplicative hash of
+   the node address is random enough to keep the treap balanced. */
+static uint32_t
+pl_itree_prio (pl_itree_node_t *node)
+{
+        uint64_t key = (uint64_t)(unsigned long) node;
+
+        key = (key >> 4) * 0x9e3779b97f4a7c15ULL;
+
+        return (uint32_t)(key >> 32);
+}
+
+
+static int
+pl_itree_less (pl_itree_node_t *a, pl_itree_node_t *b)
+{
+        if (a->start != b->start)
+                return (a->start < b->start);
+
+        return ((unsigned long) a < (unsigned long) b);
+}
+
+
+static void
+pl_itree_update (pl_itree_node_t *node)
+{
+        node->max = node->end;
+
+        if (node->left && node->left->max > node->max)
+                node->max = node->left->max;
+
+        if (node->right && node->right->max > node->max)
+                node->max = node->right->max;
+}
+
+
+/* Split @tree into the nodes ordered before @key and the rest */
+static void
+pl_itree_split (pl_itree_node_t *tree, pl_itree_node_t *key,
+                pl_itree_node_t **left, pl_itree_node_t **right)
+{
+        if (!tree) {
+                *left = *right = NULL;
+                return;
+        }
+
+        if (pl_itree_less (tree, key)) {
+                pl_itree_split (tree->right, key, &tree->right, right);
+                *left = tree;
+        } else {
+                pl_itree_split (tree->left, key, left, &tree->left);
+                *right = tree;
+        }
+
+        pl_itree_update (tree);
+}
+
+
+/* Join two treaps where every node of @left orders before @right */
+static pl_itree_node_t *
+pl_itree_join (pl_itree_node_t *left, pl_itree_node_t *right)
+{
+        if (!left)
+                return right;
+        if (!right)
+                return left;
+
+        if (left->prio > right->prio) {
+                left->right = pl_itree_join (left->right, right);
+                pl_itree_update (left);
+                return left;
+        }
+
+        right->left = pl_itree_join (left, right->left);
+        pl_itree_update (right);
+        return right;
+}
+
+
+static pl_itree_node_t *
+__pl_itree_insert (pl_itree_node_t *tree, pl_itree_node_t *node)
+{
+        if (!tree)
+                return node;
+
+        if (node->prio > tree->prio) {
+                pl_itree_split (tree, node, &node->left, &node->right);
+                pl_itree_update (node);
+                return node;
+        }
+
+        if (pl_itree_less (node, tree))
+                tree->left = __pl_itree_insert (tree->left, node);
+        else
+                tree->right = __pl_itree_insert (tree->right, node);
+
+        pl_itree_update (tree);
+        return tree;
+}
+
+
+static pl_itree_node_t *
+__pl_itree_remove (pl_itree_node_t *tree, pl_itree_node_t *node)
+{
+        if (!tree)
+                return NULL;
+
+        if (tree == node)
+                return pl_itree_join (tree->left, tree->right);
+
+        if (pl_itree_less (node, tree))
+                tree->left = __pl_itree_remove (tree->left, node);
+        else
+                tree->right = __pl_itree_remove (tree->right, node);
+
+        pl_itree_update (tree);
+        return tree;
+}
+
+
+void
+pl_itree_insert (pl_itree_node_t **root, pl_itree_node_t *node,
+                 off_t start, off_t end)
+{
+        node->left  = NULL;
+        node->right = NULL;
+        node->start = start;
+        node->end   = end;
+        node->max   = end;
+        node->prio  = pl_itree_prio (node);
+
+        *root = __pl_itree_insert (*root, node);
+}
+
+
+/* Removing a node which is not in the tree is a no-op */
+void
+pl_itree_remove (pl_itree_node_t **root, pl_itree_node_t *node)
+{
+        *root = __pl_itree_remove (*root, node);
+
+        node->left  = NULL;
+        node->right = NULL;
+}
+
+
+int
+pl_itree_walk (pl_itree_node_t *root, off_t start, off_t end,
+               pl_itree_fn_t fn, void *data)
+{
+        int ret = 0;
+
+        if (!root || root->max < start)
+                return 0;
+
+        ret = pl_itree_walk (root->left, start, end, fn, data);
+        if (ret)
+                return ret;
+
+        /* everything to the right starts at or after root */
+        if (root->start > end)
+                return 0;
+
+        if (root->end >= start) {
+                ret = fn (root, data);
+                if (ret)
+                        return ret;
+        }
+
+        return pl_itree_walk (root->right, start, end, fn, data);
+}
@@ -0,0 +1,61 @@
+/*
+  Copyright (c) 2010 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __INTERVAL_TREE_H__
+#define __INTERVAL_TREE_H__
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Intrusive interval tree (a treap augmented with the largest end offset
+   of each subtree). Nodes are embedded in the lock structures and are
+   keyed by (start, node address), so equal ranges can coexist. Ranges
+   are inclusive at both ends.
+*/
+struct pl_itree_node {
+        struct pl_itree_node *left;
+        struct pl_itree_node *right;
+        off_t                 start;
+        off_t                 end;
+        off_t                 max;      /* largest end in this subtree */
+        uint32_t              prio;
+};
+typedef struct pl_itree_node pl_itree_node_t;
+
+/* Called for each node overlapping the queried range, in order of start
+   offset. A non-zero return stops the walk and is passed back to the
+   caller. The tree must not be modified from within the callback. */
+typedef int (*pl_itree_fn_t) (pl_itree_node_t *node, void *data);
+
+#define pl_itree_entry(ptr, type, member)                               \
+        ((type *)((char *)(ptr) - offsetof (type, member)))
+
+void
+pl_itree_insert (pl_itree_node_t **root, pl_itree_node_t *node,
+                 off_t start, off_t end);
+
+void
+pl_itree_remove (pl_itree_node_t **root, pl_itree_node_t *node);
+
+int
+pl_itree_walk (pl_itree_node_t *root, off_t start, off_t end,
+               pl_itree_fn_t fn, void *data);
+
+#endif /* __INTERVAL_TREE_H__ */
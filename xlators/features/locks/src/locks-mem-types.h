@@ -34,6 +34,7 @@ enum gf_locks_mem_types_ {
         gf_locks_mt_posix_locks_private_t,
         gf_locks_mt_pl_local_t,
         gf_locks_mt_pl_fdctx_t,
+        gf_locks_mt_entrylk_hash,
         gf_locks_mt_end
 };
 #endif
@@ -29,6 +29,7 @@
 #include "stack.h"
 #include "call-stub.h"
 #include "locks-mem-types.h"
+#include "interval-tree.h"
 
 #define POSIX_LOCKS "posix-locks"
 struct __pl_fd;
@@ -54,6 +55,8 @@ struct __posix_lock {
         void              *transport;     /* to identify client node */
         pid_t              client_pid;    /* pid of client process */
         uint64_t           owner;         /* lock owner from fuse */
+
+        pl_itree_node_t    range;   /* node in granted_locks/blocked_locks */
 };
 typedef struct __posix_lock posix_lock_t;
 
@@ -79,6 +82,8 @@ struct __pl_inode_lock {
         void              *transport;     /* to identify client node */
         pid_t              client_pid;    /* pid of client process */
         uint64_t           owner;
+
+        pl_itree_node_t    range;   /* node in inodelk_tree/blocked_tree */
 };
 typedef struct __pl_inode_lock pl_inode_lock_t;
 
@@ -94,14 +99,22 @@ struct __pl_dom_list_t {
         const char        *domain;
         struct list_head   entrylk_list;     /* List of entry locks */
         struct list_head   blocked_entrylks; /* List of all blocked entrylks */
+        struct list_head  *entrylk_hash;     /* granted named entrylks by basename,
+                                                allocated on first use */
+        struct list_head  *blocked_entrylk_hash; /* blocked ones, same table */
+        struct list_head   entrylk_all;      /* granted full-directory entrylks */
+        struct list_head   blocked_entrylk_all; /* blocked full-directory entrylks */
         struct list_head   inodelk_list;     /* List of inode locks */
         struct list_head   blocked_inodelks; /* List of all blocked inodelks */
+        pl_itree_node_t   *inodelk_tree;     /* inodelk_list by range */
+        pl_itree_node_t   *blocked_tree;     /* blocked_inodelks by range */
 };
 typedef struct __pl_dom_list_t pl_dom_list_t;
 
 struct __entry_lock {
         struct list_head  domain_list;    /* list_head back to pl_dom_list_t */
         struct list_head  blocked_locks; /* list_head back to blocked_entrylks */
+        struct list_head  hash_list;     /* basename bucket or entrylk_all */
 
         call_frame_t     *frame;
         xlator_t         *this;
@@ -126,6 +139,8 @@ struct __pl_inode {
 
         struct list_head dom_list;       /* list of domains */
         struct list_head ext_list;       /* list of fcntl locks */
+        pl_itree_node_t *granted_locks;  /* granted fcntl locks by range */
+        pl_itree_node_t *blocked_locks;  /* blocked fcntl locks by range */
         struct list_head rw_list;        /* list of waiting r/w requests */
         struct list_head reservelk_list;        /* list of reservelks */
         struct list_head blocked_reservelks;        /* list of blocked reservelks */
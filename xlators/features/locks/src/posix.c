@@ -123,12 +123,23 @@ pl_truncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 }
 
 
+static int
+other_owner_lock (pl_itree_node_t *node, void *data)
+{
+        posix_lock_t *region = data;
+        posix_lock_t *l = NULL;
+
+        l = pl_itree_entry (node, posix_lock_t, range);
+
+        return !same_owner (region, l);
+}
+
+
 static int
 truncate_allowed (pl_inode_t *pl_inode,
                   void *transport, pid_t client_pid,
                   uint64_t owner, off_t offset)
 {
-        posix_lock_t *l = NULL;
         posix_lock_t  region = {.list = {0, }, };
         int           ret = 1;
 
@@ -140,15 +151,12 @@ truncate_allowed (pl_inode_t *pl_inode,
 
         pthread_mutex_lock (&pl_inode->mutex);
         {
-                list_for_each_entry (l, &pl_inode->ext_list, list) {
-                        if (!l->blocked
-                            && locks_overlap (&region, l)
-                            && !same_owner (&region, l)) {
-                                ret = 0;
-                                gf_log (POSIX_LOCKS, GF_LOG_TRACE, "Truncate "
-                                        "allowed");
-                                break;
-                        }
+                if (pl_itree_walk (pl_inode->granted_locks, region.fl_start,
+                                   region.fl_end, other_owner_lock,
+                                   &region)) {
+                        ret = 0;
+                        gf_log (POSIX_LOCKS, GF_LOG_TRACE, "Truncate "
+                                "allowed");
                 }
         }
         pthread_mutex_unlock (&pl_inode->mutex);
@@ -299,7 +307,8 @@ delete_locks_of_fd (xlator_t *this, pl_inode_t *pl_inode, fd_t *fd)
                list_for_each_entry_safe (l, tmp, &pl_inode->ext_list, list) {
                        if ((l->fd_num == fd_to_fdnum(fd))) {
                                if (l->blocked) {
-                                       list_move_tail (&l->list, &blocked_list);
+                                       __delete_lock (pl_inode, l);
+                                       list_add_tail (&l->list, &blocked_list);
                                        continue;
                                }
                                __delete_lock (pl_inode, l);
@@ -579,23 +588,47 @@ do_blocked_rw (pl_inode_t *pl_inode)
 }
 
 
+static int
+rw_conflict (pl_itree_node_t *node, void *data)
+{
+        posix_lock_t *region = data;
+        posix_lock_t *l = NULL;
+
+        l = pl_itree_entry (node, posix_lock_t, range);
+
+        if (same_owner (l, region))
+                return 0;
+
+        /* reads only conflict with write locks */
+        if ((region->fl_type == F_RDLCK) && (l->fl_type != F_WRLCK))
+                return 0;
+
+        return 1;
+}
+
+
 static int
 __rw_allowable (pl_inode_t *pl_inode, posix_lock_t *region,
                 glusterfs_fop_t op)
 {
-        posix_lock_t *l = NULL;
-        int           ret = 1;
+        posix_lock_t  query = {.list = {0, }, };
 
-        list_for_each_entry (l, &pl_inode->ext_list, list) {
-                if (locks_overlap (l, region) && !same_owner (l, region)) {
-                        if ((op == GF_FOP_READ) && (l->fl_type != F_WRLCK))
-                                continue;
-                        ret = 0;
-                        break;
-                }
-        }
+        query.fl_start  = region->fl_start;
+        query.fl_end    = region->fl_end;
+        query.fl_type   = (op == GF_FOP_READ) ? F_RDLCK : F_WRLCK;
+        query.transport = region->transport;
+        query.owner     = region->owner;
 
-        return ret;
+        /* blocked locks are checked as well */
+        if (pl_itree_walk (pl_inode->granted_locks, query.fl_start,
+                           query.fl_end, rw_conflict, &query))
+                return 0;
+
+        if (pl_itree_walk (pl_inode->blocked_locks, query.fl_start,
+                           query.fl_end, rw_conflict, &query))
+                return 0;
+
+        return 1;
 }
 
 
@@ -1192,7 +1225,7 @@ pl_forget (xlator_t *this,
                                         "Pending inode locks found, releasing.");
 
                                 list_for_each_entry_safe (ino_l, ino_tmp, &dom->inodelk_list, list) {
-                                        __delete_inode_lock (ino_l);
+                                        __delete_inode_lock (dom, ino_l);
                                         __destroy_inode_lock (ino_l);
                                 }
 
@@ -1218,6 +1251,8 @@ pl_forget (xlator_t *this,
                         list_del (&dom->inode_list);
                         gf_log ("posix-locks", GF_LOG_TRACE,
                                 " Cleaning up domain: %s", dom->domain);
+                        if (dom->entrylk_hash)
+                                GF_FREE (dom->entrylk_hash);
                         GF_FREE ((char *)(dom->domain));
                         GF_FREE (dom);
                 }
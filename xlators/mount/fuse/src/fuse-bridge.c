@@ -56,7 +56,7 @@ send_fuse_iov (xlator_t *this, fuse_in_header_t *finh, struct iovec *iov_out,
                 fouh->len += iov_out[i].iov_len;
         fouh->unique = finh->unique;
 
-        res = writev (priv->fd, iov_out, count);
+        res = writev (FUSE_FINH_READER (priv, finh)->fd, iov_out, count);
 
         if (res == -1)
                 return errno;
@@ -1834,7 +1834,6 @@ void
 fuse_write_resume (fuse_state_t *state)
 {
         struct iobref *iobref = NULL;
-        struct iobuf  *iobuf = NULL;
 
         if (!state->fd || !state->fd->inode) {
                 send_fuse_err (state->this, state->finh, EBADFD);
@@ -1853,8 +1852,7 @@ fuse_write_resume (fuse_state_t *state)
                 return;
         }
 
-        iobuf = ((fuse_private_t *) (state->this->private))->iobuf;
-        iobref_add (iobref, iobuf);
+        iobref_add (iobref, state->iobuf);
 
         FUSE_FOP (state, fuse_writev_cbk, GF_FOP_WRITE, writev, state->fd,
                   &state->vector, 1, state->off, iobref);
@@ -1896,6 +1894,7 @@ fuse_write (xlator_t *this, fuse_in_header_t *finh, void *msg)
 
         state->vector.iov_base = msg;
         state->vector.iov_len  = fwi->size;
+        state->iobuf = iobuf_ref (FUSE_FINH_READER (priv, finh)->iobuf);
 
         fuse_resolve_and_resume (state, fuse_write_resume);
 
@@ -2886,7 +2885,7 @@ fuse_init (xlator_t *this, fuse_in_header_t *finh, void *msg)
                 fino.congestion_threshold = 48;
         }
         if (fini->minor < 9)
-                *priv->msg0_len_p = sizeof(*finh) + FUSE_COMPAT_WRITE_IN_SIZE;
+                priv->msg0_len = sizeof(*finh) + FUSE_COMPAT_WRITE_IN_SIZE;
 #endif
         ret = send_fuse_obj (this, finh, &fino);
         if (ret == 0)
@@ -3030,13 +3029,24 @@ fuse_graph_sync (xlator_t *this)
 
         priv = this->private;
 
+        /* checked unlocked, a switch almost never is pending */
+        if (!priv->next_graph && !priv->graph_switching)
+                return 0;
+
         pthread_mutex_lock (&priv->sync_mutex);
         {
+                /* requests are held while another reader switches, so
+                   that none reaches the new graph before its root does */
+                while (priv->graph_switching)
+                        pthread_cond_wait (&priv->sync_cond,
+                                           &priv->sync_mutex);
+
                 if (!priv->next_graph)
                         goto unlock;
 
                 priv->active_subvol = priv->next_graph->top;
                 priv->next_graph = NULL;
+                priv->graph_switching = 1;
                 need_first_lookup = 1;
 
                 gettimeofday (&now, NULL);
@@ -3060,68 +3070,139 @@ unlock:
 
         if (need_first_lookup) {
                 fuse_first_lookup (this);
+
+                pthread_mutex_lock (&priv->sync_mutex);
+                {
+                        priv->graph_switching = 0;
+                        pthread_cond_broadcast (&priv->sync_cond);
+                }
+                pthread_mutex_unlock (&priv->sync_mutex);
         }
 
         return 0;
 }
 
 
+#ifdef GF_LINUX_HOST_OS
+#ifndef FUSE_DEV_IOC_CLONE
+#define FUSE_DEV_IOC_CLONE _IOR(229, 0, uint32_t)
+#endif
+#endif
+
+/* A cloned fd gets a request queue of its own in the kernel, so readers
+   do not contend on the queue of the mount fd. Not supported by kernels
+   older than 4.2, where all readers share the mount fd. */
+static int
+fuse_clone_fd (xlator_t *this, int fd)
+{
+#ifdef FUSE_DEV_IOC_CLONE
+        int      clone_fd  = -1;
+        uint32_t master_fd = fd;
+
+        clone_fd = open ("/dev/fuse", O_RDWR);
+        if (clone_fd == -1)
+                return -1;
+
+        if (ioctl (clone_fd, FUSE_DEV_IOC_CLONE, &master_fd) == -1) {
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "cloning /dev/fuse fd failed (%s)", strerror (errno));
+                close (clone_fd);
+                return -1;
+        }
+
+        return clone_fd;
+#else
+        return -1;
+#endif
+}
+
+
+static void *fuse_thread_proc (void *data);
+
+/* the first reader starts the others once INIT has been answered, so that
+   they all read with the negotiated header size */
+static void
+fuse_spawn_readers (xlator_t *this)
+{
+        fuse_private_t *priv   = NULL;
+        fuse_reader_t  *reader = NULL;
+        int             i      = 0;
+        int             ret    = 0;
+
+        priv = this->private;
+        priv->readers_started = 1;
+
+        for (i = 1; i < priv->reader_thread_count; i++) {
+                reader = &priv->readers[i];
+
+                reader->fd = fuse_clone_fd (this, priv->fd);
+                if (reader->fd == -1)
+                        reader->fd = priv->fd;
+
+                ret = pthread_create (&reader->thread, NULL,
+                                      fuse_thread_proc, reader);
+                if (ret != 0) {
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "starting fuse reader %d failed (%s)",
+                                i, strerror (ret));
+                        if (reader->fd != priv->fd)
+                                close (reader->fd);
+                        reader->fd = -1;
+                        break;
+                }
+        }
+
+        gf_log (this->name, GF_LOG_DEBUG, "%d fuse reader(s) running", i);
+}
+
+
 static void *
 fuse_thread_proc (void *data)
 {
         char           *mount_point = NULL;
         xlator_t       *this = NULL;
         fuse_private_t *priv = NULL;
+        fuse_reader_t  *reader = NULL;
         ssize_t         res = 0;
+        size_t          len = 0;
         struct iobuf   *iobuf = NULL;
         fuse_in_header_t *finh;
         struct iovec iov_in[2];
         void *msg = NULL;
-        const size_t msg0_size = sizeof (*finh) + 128;
         fuse_handler_t **fuse_ops = NULL;
+        int             last = 0;
 
-        this = data;
+        reader = data;
+        this = reader->this;
         priv = this->private;
         fuse_ops = priv->fuse_ops;
 
         THIS = this;
 
-        iov_in[0].iov_len = sizeof (*finh) + sizeof (struct fuse_write_in);
+        iov_in[0].iov_base = reader->hdr;
         iov_in[1].iov_len = ((struct iobuf_pool *)this->ctx->iobuf_pool)
                               ->page_size;
-        priv->msg0_len_p = &iov_in[0].iov_len;
 
         for (;;) {
                 /* THIS has to be reset here */
                 THIS = this;
 
-                if (priv->init_recvd)
-                        fuse_graph_sync (this);
+                if (priv->init_recvd && !priv->readers_started
+                    && reader->idx == 0)
+                        fuse_spawn_readers (this);
 
                 iobuf = iobuf_get (this->ctx->iobuf_pool);
-                /* Add extra 128 byte to the first iov so that it can
-                 * accomodate "ordinary" non-write requests. It's not
-                 * guaranteed to be big enough, as SETXATTR and namespace
-                 * operations with very long names may grow behind it,
-                 * but it's good enough in most cases (and we can handle
-                 * rest via realloc).
-                 */
-                iov_in[0].iov_base = GF_CALLOC (1, msg0_size,
-                                                gf_fuse_mt_iov_base);
-
-                if (!iobuf || !iov_in[0].iov_base) {
+                if (!iobuf) {
                         gf_log (this->name, GF_LOG_ERROR,
                                 "Out of memory");
-                        if (iobuf)
-                                iobuf_unref (iobuf);
-                        GF_FREE (iov_in[0].iov_base);
                         sleep (10);
                         continue;
                 }
 
+                iov_in[0].iov_len = priv->msg0_len;
                 iov_in[1].iov_base = iobuf->ptr;
 
-                res = readv (priv->fd, iov_in, 2);
+                res = readv (reader->fd, iov_in, 2);
 
                 if (res == -1) {
                         if (errno == ENODEV || errno == EBADF) {
@@ -3146,7 +3227,7 @@ fuse_thread_proc (void *data)
                         break;
                 }
 
-                finh = (fuse_in_header_t *)iov_in[0].iov_base;
+                finh = (fuse_in_header_t *)reader->hdr;
 
                 if (res != finh->len
 #ifdef GF_DARWIN_HOST_OS
@@ -3164,51 +3245,65 @@ fuse_thread_proc (void *data)
                         break;
                 }
 
-                priv->iobuf = iobuf;
+                finh->padding = reader->idx;
 
+                if (priv->init_recvd)
+                        fuse_graph_sync (this);
+
+                /* the handler owns the request from here on, so it gets
+                 * a copy of what landed in the header buffer, followed
+                 * by any spill-over into the iobuf unless it is WRITE
+                 * payload
+                 */
                 if (finh->opcode == FUSE_WRITE)
-                        msg = iov_in[1].iov_base;
-                else {
-                        if (res > msg0_size) {
-                                iov_in[0].iov_base =
-                                  GF_REALLOC (iov_in[0].iov_base, res);
-                                if (iov_in[0].iov_base)
-                                        finh = (fuse_in_header_t *)
-                                                 iov_in[0].iov_base;
-                                else {
-                                        gf_log ("glusterfs-fuse", GF_LOG_ERROR,
-                                                "Out of memory");
-                                        send_fuse_err (this, finh, ENOMEM);
-
-                                        goto cont_err;
-                                }
-                        }
+                        len = iov_in[0].iov_len;
+                else
+                        len = res;
 
-                        if (res > iov_in[0].iov_len)
-                                memcpy (iov_in[0].iov_base + iov_in[0].iov_len,
-                                        iov_in[1].iov_base,
-                                        res - iov_in[0].iov_len);
+                finh = GF_CALLOC (1, len, gf_fuse_mt_iov_base);
+                if (!finh) {
+                        gf_log ("glusterfs-fuse", GF_LOG_ERROR,
+                                "Out of memory");
+                        send_fuse_err (this, reader->hdr, ENOMEM);
 
-                        msg = finh + 1;
+                        goto cont_err;
                 }
-#ifdef GF_DARWIN_HOST_OS
+
+                memcpy (finh, reader->hdr, min (len, iov_in[0].iov_len));
+                if (len > iov_in[0].iov_len)
+                        memcpy ((char *)finh + iov_in[0].iov_len,
+                                iov_in[1].iov_base, len - iov_in[0].iov_len);
+
+                if (finh->opcode == FUSE_WRITE)
+                        msg = iov_in[1].iov_base;
+                else
+                        msg = finh + 1;
+
+                reader->iobuf = iobuf;
                 if (finh->opcode >= FUSE_OP_HIGH)
-                        /* turn down MacFUSE specific messages */
+                        /* turn down MacFUSE specific messages, and
+                           requests of newer kernels (eg. STATX) */
                         fuse_enosys (this, finh, msg);
                 else
-#endif
-                fuse_ops[finh->opcode] (this, finh, msg);
-
-                iobuf_unref (iobuf);
-                continue;
+                        fuse_ops[finh->opcode] (this, finh, msg);
+                reader->iobuf = NULL;
 
  cont_err:
                 iobuf_unref (iobuf);
-                GF_FREE (iov_in[0].iov_base);
         }
 
         iobuf_unref (iobuf);
-        GF_FREE (iov_in[0].iov_base);
+
+        /* every reader sees the mount go away, one of them cleans up */
+        pthread_mutex_lock (&priv->sync_mutex);
+        {
+                last = !priv->reader_exited;
+                priv->reader_exited = 1;
+        }
+        pthread_mutex_unlock (&priv->sync_mutex);
+
+        if (!last)
+                return NULL;
 
         if (dict_get (this->options, ZR_MOUNTPOINT_OPT))
                 mount_point = data_to_str (dict_get (this->options,
@@ -3260,8 +3355,8 @@ fuse_priv_dump (xlator_t  *this)
                             private->volfile_size);
         gf_proc_dump_write("xlator.mount.fuse.mount_point", "%s",
                             private->mount_point);
-        gf_proc_dump_write("xlator.mount.fuse.iobuf", "%u",
-                            private->iobuf);
+        gf_proc_dump_write("xlator.mount.fuse.reader_thread_count", "%d",
+                            private->reader_thread_count);
         gf_proc_dump_write("xlator.mount.fuse.fuse_thread_started", "%d",
                             (int)private->fuse_thread_started);
         gf_proc_dump_write("xlator.mount.fuse.direct_io_mode", "%d",
@@ -3362,7 +3457,8 @@ notify (xlator_t *this, int32_t event, void *data, ...)
                         private->fuse_thread_started = 1;
 
                         ret = pthread_create (&private->fuse_thread, NULL,
-                                              fuse_thread_proc, this);
+                                              fuse_thread_proc,
+                                              &private->readers[0]);
                         if (ret != 0) {
                                 gf_log (this->name, GF_LOG_DEBUG,
                                         "pthread_create() failed (%s)",
@@ -3610,6 +3706,40 @@ init (xlator_t *this_xl)
                 priv->fuse_dump_fd = ret;
         }
 
+        priv->reader_thread_count = 1;
+        ret = dict_get_int32 (options, "reader-thread-count",
+                              &priv->reader_thread_count);
+        if (ret == 0 && (priv->reader_thread_count < 1 ||
+                         priv->reader_thread_count > FUSE_READER_THREADS_MAX)) {
+                gf_log ("glusterfs-fuse", GF_LOG_ERROR,
+                        "reader-thread-count must be between 1 and %d",
+                        FUSE_READER_THREADS_MAX);
+                goto cleanup_exit;
+        }
+
+        priv->readers = GF_CALLOC (priv->reader_thread_count,
+                                   sizeof (*priv->readers),
+                                   gf_fuse_mt_fuse_reader_t);
+        if (!priv->readers) {
+                gf_log ("glusterfs-fuse", GF_LOG_ERROR,
+                        "Out of memory");
+                goto cleanup_exit;
+        }
+
+        for (i = 0; i < priv->reader_thread_count; i++) {
+                priv->readers[i].this = this_xl;
+                priv->readers[i].idx  = i;
+                priv->readers[i].fd   = -1;
+                priv->readers[i].hdr  = GF_CALLOC (1, FUSE_MSG0_SIZE,
+                                                   gf_fuse_mt_iov_base);
+                if (!priv->readers[i].hdr) {
+                        gf_log ("glusterfs-fuse", GF_LOG_ERROR,
+                                "Out of memory");
+                        goto cleanup_exit;
+                }
+        }
+        priv->msg0_len = FUSE_MSG0_SIZE;
+
         sync_mtab = _gf_false;
         ret = dict_get_str (options, "sync-mtab", &value_string);
         if (ret == 0) {
@@ -3649,6 +3779,8 @@ init (xlator_t *this_xl)
         if (priv->fd == -1)
                 goto cleanup_exit;
 
+        priv->readers[0].fd = priv->fd;
+
         pthread_mutex_init (&priv->fuse_dump_mutex, NULL);
         pthread_cond_init (&priv->sync_cond, NULL);
         pthread_mutex_init (&priv->sync_mutex, NULL);
@@ -3674,6 +3806,11 @@ cleanup_exit:
         if (fsname_allocated)
                 GF_FREE (fsname);
         if (priv) {
+                if (priv->readers) {
+                        for (i = 0; i < priv->reader_thread_count; i++)
+                                GF_FREE (priv->readers[i].hdr);
+                        GF_FREE (priv->readers);
+                }
                 GF_FREE (priv->mount_point);
                 close (priv->fd);
                 close (priv->fuse_dump_fd);
@@ -3688,6 +3825,7 @@ fini (xlator_t *this_xl)
 {
         fuse_private_t *priv = NULL;
         char *mount_point = NULL;
+        int   i = 0;
 
         if (this_xl == NULL)
                 return;
@@ -3705,6 +3843,11 @@ fini (xlator_t *this_xl)
                 dict_del (this_xl->options, ZR_MOUNTPOINT_OPT);
                 gf_fuse_unmount (mount_point, priv->fd);
                 close (priv->fuse_dump_fd);
+
+                for (i = 1; i < priv->reader_thread_count; i++)
+                        if (priv->readers[i].fd != -1
+                            && priv->readers[i].fd != priv->fd)
+                                close (priv->readers[i].fd);
         }
 }
 
@@ -3745,5 +3888,10 @@ struct volume_options options[] = {
         { .key  = {"sync-mtab"},
           .type = GF_OPTION_TYPE_BOOL
         },
+        { .key  = {"reader-thread-count"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 1,
+          .max  = FUSE_READER_THREADS_MAX
+        },
         { .key = {NULL} },
 };
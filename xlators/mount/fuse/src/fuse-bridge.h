@@ -27,6 +27,7 @@
 #include <dirent.h>
 #include <sys/mount.h>
 #include <sys/time.h>
+#include <sys/ioctl.h>
 #include <fnmatch.h>
 
 #ifndef _CONFIG_H
@@ -68,23 +69,44 @@
 
 #define MAX_FUSE_PROC_DELAY 1
 
+#define FUSE_READER_THREADS_MAX 16
+
+/* header and write_in of a request land in the header buffer of the
+   reader, the rest goes to an iobuf */
+#define FUSE_MSG0_SIZE (sizeof (struct fuse_in_header)          \
+                        + sizeof (struct fuse_write_in))
+
 typedef struct fuse_in_header fuse_in_header_t;
 typedef void (fuse_handler_t) (xlator_t *this, fuse_in_header_t *finh,
                                void *msg);
 
+struct fuse_reader {
+        xlator_t            *this;
+        int                  idx;
+        int                  fd;        /* /dev/fuse fd or a clone of it */
+        pthread_t            thread;
+        void                *hdr;       /* FUSE_MSG0_SIZE bytes */
+        struct iobuf        *iobuf;     /* of the request being handled */
+};
+typedef struct fuse_reader fuse_reader_t;
+
 struct fuse_private {
         int                  fd;
         uint32_t             proto_minor;
         char                *volfile;
         size_t               volfile_size;
         char                *mount_point;
-        struct iobuf        *iobuf;
 
         pthread_t            fuse_thread;
         char                 fuse_thread_started;
 
+        int32_t              reader_thread_count;
+        fuse_reader_t       *readers;
+        char                 readers_started;
+        char                 reader_exited;
+
         uint32_t             direct_io_mode;
-        size_t              *msg0_len_p;
+        size_t               msg0_len;
 
         double               entry_timeout;
         double               attribute_timeout;
@@ -103,6 +125,7 @@ struct fuse_private {
         int                  fuse_dump_fd;
 
         glusterfs_graph_t   *next_graph;
+        char                 graph_switching; /* first lookup under way */
         xlator_t            *active_subvol;
 
         pid_t                client_pid;
@@ -110,6 +133,11 @@ struct fuse_private {
 };
 typedef struct fuse_private fuse_private_t;
 
+/* The kernel does not use the padding of the request header. We keep the
+   index of the reader which read the request there, as a reply has to be
+   written to the (possibly cloned) fd the request came from. */
+#define FUSE_FINH_READER(priv, finh) (&(priv)->readers[(finh)->padding])
+
 #define _FH_TO_FD(fh) ((fd_t *)(uintptr_t)(fh))
 
 #define FH_TO_FD(fh) ((_FH_TO_FD (fh))?(fd_ref (_FH_TO_FD (fh))):((fd_t *) 0))
@@ -271,6 +299,7 @@ typedef struct {
         struct iatt    attr;
         struct gf_flock   lk_lock;
         struct iovec   vector;
+        struct iobuf  *iobuf;
 
         uuid_t         gfid;
 } fuse_state_t;
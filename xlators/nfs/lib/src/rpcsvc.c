@@ -2255,7 +2255,7 @@ nfs_rpcsvc_handle_vectored_rpc_call (rpcsvc_conn_t *conn)
         }
 
         if (newbuf) {
-                rs->vectoriob = iobuf_get (svc->ctx->iobuf_pool);
+                rs->vectoriob = iobuf_get2 (svc->ctx->iobuf_pool, remfrag);
                 rs->fragcurrent = iobuf_ptr (rs->vectoriob);
                 rs->vecstate = RPCSVC_VECTOR_READVEC;
                 rs->remainingfrag = remfrag;
@@ -51,40 +51,6 @@ ioc_hashfn (void *data, int len)
         return (offset >> ioc_log2_page_size);
 }
 
-inline ioc_inode_t *
-ioc_inode_reupdate (ioc_inode_t *ioc_inode)
-{
-	ioc_table_t *table = ioc_inode->table;
-
-	list_add_tail (&ioc_inode->inode_lru,
-		       &table->inode_lru[ioc_inode->weight]);
-
-	return ioc_inode;
-}
-
-inline ioc_inode_t *
-ioc_get_inode (dict_t *dict, char *name)
-{
-	ioc_inode_t *ioc_inode = NULL;
-	data_t      *ioc_inode_data = dict_get (dict, name);
-	ioc_table_t *table = NULL;
-
-	if (ioc_inode_data) {
-		ioc_inode = data_to_ptr (ioc_inode_data);
-		table = ioc_inode->table;
-
-		ioc_table_lock (table);
-		{
-			if (list_empty (&ioc_inode->inode_lru)) {
-				ioc_inode = ioc_inode_reupdate (ioc_inode);
-			}
-		}
-		ioc_table_unlock (table);
-	}
-
-	return ioc_inode;
-}
-
 int32_t
 ioc_inode_need_revalidate (ioc_inode_t *ioc_inode)
 {
@@ -136,13 +102,8 @@ ioc_inode_flush (ioc_inode_t *ioc_inode)
 	}
 	ioc_inode_unlock (ioc_inode);
 
-	if (destroy_size) {
-		ioc_table_lock (ioc_inode->table);
-		{
-			ioc_inode->table->cache_used -= destroy_size;
-		}
-		ioc_table_unlock (ioc_inode->table);
-	}
+	if (destroy_size)
+		GF_ATOMIC_SUB (ioc_inode->table->cache_used, destroy_size);
 
 	return;
 }
@@ -243,13 +204,6 @@ ioc_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 ioc_inode_flush (ioc_inode);
         }
 
-        ioc_table_lock (ioc_inode->table);
-        {
-                list_move_tail (&ioc_inode->inode_lru,
-                                &table->inode_lru[ioc_inode->weight]);
-        }
-        ioc_table_unlock (ioc_inode->table);
-
 out:
         if (frame->local != NULL) {
                 local = frame->local;
@@ -364,13 +318,8 @@ ioc_cache_validate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 		local_stbuf = NULL;
 	}
 
-	if (destroy_size) {
-		ioc_table_lock (ioc_inode->table);
-		{
-			ioc_inode->table->cache_used -= destroy_size;
-		}
-		ioc_table_unlock (ioc_inode->table);
-	}
+	if (destroy_size)
+		GF_ATOMIC_SUB (ioc_inode->table->cache_used, destroy_size);
 
 	if (op_ret < 0)
 		local_stbuf = NULL;
@@ -543,13 +492,6 @@ ioc_open_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
                 inode_ctx_get (fd->inode, this, &tmp_ioc_inode);
                 ioc_inode = (ioc_inode_t *)(long)tmp_ioc_inode;
 
-                ioc_table_lock (ioc_inode->table);
-                {
-                        list_move_tail (&ioc_inode->inode_lru,
-                                        &table->inode_lru[ioc_inode->weight]);
-                }
-                ioc_table_unlock (ioc_inode->table);
-
                 ioc_inode_lock (ioc_inode);
                 {
                         if ((table->min_file_size > ioc_inode->ia_size)
@@ -881,18 +823,7 @@ ioc_readv_disabled_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 int32_t
 ioc_need_prune (ioc_table_t *table)
 {
-	int64_t cache_difference = 0;
-
-	ioc_table_lock (table);
-	{
-		cache_difference = table->cache_used - table->cache_size;
-	}
-	ioc_table_unlock (table);
-
-	if (cache_difference > 0)
-		return 1;
-	else
-		return 0;
+	return (GF_ATOMIC_GET (table->cache_used) > table->cache_size);
 }
 
 /*
@@ -1008,7 +939,7 @@ ioc_dispatch_requests (call_frame_t *frame, ioc_inode_t *ioc_inode, fd_t *fd,
 
 		if (fault) {
 			fault = 0;
-			/* new page created, increase the table->cache_used */
+			/* new page created, charged to the table when filled */
 			ioc_page_fault (ioc_inode, frame, fd, trav_offset);
 		}
 
@@ -1038,10 +969,6 @@ ioc_dispatch_requests (call_frame_t *frame, ioc_inode_t *ioc_inode, fd_t *fd,
 out:
 	ioc_frame_return (frame);
 
-	if (ioc_need_prune (ioc_inode->table)) {
-		ioc_prune (ioc_inode->table);
-	}
-
 	return;
 }
 
@@ -1063,7 +990,6 @@ ioc_readv (call_frame_t *frame, xlator_t *this, fd_t *fd,
 	uint64_t     tmp_ioc_inode = 0;
 	ioc_inode_t  *ioc_inode = NULL;
 	ioc_local_t  *local = NULL;
-	uint32_t     weight = 0;
         ioc_table_t  *table = NULL;
         uint32_t     num_pages = 0;
         int32_t      op_errno = -1;
@@ -1163,15 +1089,6 @@ ioc_readv (call_frame_t *frame, xlator_t *this, fd_t *fd,
 		"NEW REQ (%p) offset = %"PRId64" && size = %"GF_PRI_SIZET"",
 		frame, offset, size);
 
-	weight = ioc_inode->weight;
-
-	ioc_table_lock (ioc_inode->table);
-	{
-		list_move_tail (&ioc_inode->inode_lru,
-				&ioc_inode->table->inode_lru[weight]);
-	}
-	ioc_table_unlock (ioc_inode->table);
-
 	ioc_dispatch_requests (frame, ioc_inode, fd, offset, size);
 	return 0;
 
@@ -1689,6 +1606,10 @@ reconfigure (xlator_t *this, dict_t *options)
 	}
 
 	ioc_table_unlock (table);
+
+        /* cache-size may have shrunk */
+        if (ioc_need_prune (table))
+                ioc_prune (table);
 out:
 	return ret;
 
@@ -1699,6 +1620,17 @@ out:
  * @this:
  *
  */
+static void
+ioc_table_free_shards (ioc_table_t *table)
+{
+        int i = 0;
+
+        for (i = 0; i < IOC_TABLE_SHARDS; i++) {
+                GF_FREE (table->shards[i].a1in);
+                GF_FREE (table->shards[i].am);
+        }
+}
+
 int32_t
 init (xlator_t *this)
 {
@@ -1709,6 +1641,8 @@ init (xlator_t *this)
         int32_t          ret = -1;
         glusterfs_ctx_t *ctx = NULL;
         data_t          *data = 0;
+        struct ioc_shard *shard = NULL;
+        int              i = 0;
 
 	if (!this->children || this->children->next) {
 		gf_log (this->name, GF_LOG_ERROR,
@@ -1825,15 +1759,27 @@ init (xlator_t *this)
                         goto out;
         }
 
-	table->inode_lru = GF_CALLOC (table->max_pri,
-                                      sizeof (struct list_head),
-                                      gf_ioc_mt_list_head);
-        if (table->inode_lru == NULL) {
-                goto out;
-        }
+        table->shard_pri = table->max_pri;
+        for (i = 0; i < IOC_TABLE_SHARDS; i++) {
+                shard = &table->shards[i];
+
+                pthread_mutex_init (&shard->lock, NULL);
+                INIT_LIST_HEAD (&shard->a1out);
 
-	for (index = 0; index < (table->max_pri); index++)
-		INIT_LIST_HEAD (&table->inode_lru[index]);
+                shard->a1in = GF_CALLOC (table->shard_pri,
+                                         sizeof (struct list_head),
+                                         gf_ioc_mt_list_head);
+                shard->am = GF_CALLOC (table->shard_pri,
+                                       sizeof (struct list_head),
+                                       gf_ioc_mt_list_head);
+                if ((shard->a1in == NULL) || (shard->am == NULL))
+                        goto out;
+
+                for (index = 0; index < table->shard_pri; index++) {
+                        INIT_LIST_HEAD (&shard->a1in[index]);
+                        INIT_LIST_HEAD (&shard->am[index]);
+                }
+        }
 
 	pthread_mutex_init (&table->table_lock, NULL);
 	this->private = table;
@@ -1845,7 +1791,7 @@ init (xlator_t *this)
 out:
         if (ret == -1) {
                 if (table != NULL) {
-                        GF_FREE (table->inode_lru);
+                        ioc_table_free_shards (table);
                         GF_FREE (table);
                 }
         }
@@ -1859,6 +1805,9 @@ ioc_priv_dump (xlator_t *this)
         ioc_table_t     *priv = NULL;
         char            key_prefix[GF_DUMP_MAX_BUF_LEN];
         char            key[GF_DUMP_MAX_BUF_LEN];
+        uint64_t        a1in_size = 0;
+        uint64_t        a1out_count = 0;
+        int             i = 0;
 
         if (!this || !this->private)
                 goto out;
@@ -1877,6 +1826,20 @@ ioc_priv_dump (xlator_t *this)
         gf_proc_dump_build_key (key, key_prefix, "inode_count");
         gf_proc_dump_write (key, "%u", priv->inode_count);
 
+        for (i = 0; i < IOC_TABLE_SHARDS; i++) {
+                a1in_size += priv->shards[i].a1in_size;
+                a1out_count += priv->shards[i].a1out_count;
+        }
+
+        gf_proc_dump_build_key (key, key_prefix, "a1in_size");
+        gf_proc_dump_write (key, "%"PRIu64, a1in_size);
+        gf_proc_dump_build_key (key, key_prefix, "a1out_count");
+        gf_proc_dump_write (key, "%"PRIu64, a1out_count);
+        gf_proc_dump_build_key (key, key_prefix, "promoted");
+        gf_proc_dump_write (key, "%"PRIu64, priv->promoted);
+        gf_proc_dump_build_key (key, key_prefix, "rejected");
+        gf_proc_dump_write (key, "%"PRIu64, priv->rejected);
+
 out:
         return 0;
 }
@@ -1903,6 +1866,7 @@ fini (xlator_t *this)
         }
 
 	pthread_mutex_destroy (&table->table_lock);
+        ioc_table_free_shards (table);
 	GF_FREE (table);
 
 	this->private = NULL;
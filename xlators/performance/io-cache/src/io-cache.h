@@ -42,6 +42,7 @@
 #define IOC_PAGE_SIZE    (1024 * 128)   /* 128KB */
 #define IOC_CACHE_SIZE   (32 * 1024 * 1024)
 #define IOC_PAGE_TABLE_BUCKET_COUNT 1
+#define IOC_TABLE_SHARDS 16
 
 struct ioc_table;
 struct ioc_local;
@@ -109,16 +110,44 @@ struct ioc_local {
         dict_t           *xattr_req;
 };
 
+/*
+ * replacement is 2Q, per shard and priority. a page is charged to the
+ * cache when its data arrives and is queued on a1in. it moves to am only
+ * if it is read again after having been evicted from a1in, which leaves
+ * a ghost (the page without data) on a1out. so a long sequential read
+ * churns through a1in without pushing out pages which are read again.
+ */
+enum ioc_page_queue {
+        IOC_QUEUE_NONE = 0,     /* in transit, or not charged */
+        IOC_QUEUE_A1IN,         /* read once, FIFO */
+        IOC_QUEUE_AM,           /* read again, LRU */
+        IOC_QUEUE_A1OUT,        /* ghost of a page evicted from a1in */
+};
+
+struct ioc_shard {
+        pthread_mutex_t   lock;
+        struct list_head *a1in;         /* one per priority */
+        struct list_head *am;           /* one per priority */
+        struct list_head  a1out;
+        uint64_t          a1in_size;
+        uint32_t          a1out_count;
+};
+
 /*
  * ioc_page - structure to store page of data from file
  *
  */
 struct ioc_page {
         struct list_head    page_lru;
+        struct list_head    page_2q;  /* on a queue of the inode's shard */
         struct ioc_inode    *inode;   /* inode this page belongs to */
         struct ioc_priority *priority;
         char                dirty;
         char                ready;
+        char                queue;    /* enum ioc_page_queue */
+        char                referenced; /* revived from a ghost */
+        uint32_t            pri;      /* queue index in the shard */
+        size_t              charged;  /* bytes counted in cache_used */
         struct iovec        *vector;
         int32_t             count;
         off_t               offset;
@@ -150,7 +179,7 @@ struct ioc_inode {
                                             * list of inodes, maintained by
                                             * io-cache translator
                                             */
-        struct list_head       inode_lru;
+        struct ioc_shard      *shard;
         struct ioc_waitq      *waitq;
         pthread_mutex_t        inode_lock;
         uint32_t               weight;      /*
@@ -162,12 +191,16 @@ struct ioc_inode {
 struct ioc_table {
         uint64_t         page_size;
         uint64_t         cache_size;
-        uint64_t         cache_used;
+        uint64_t         cache_used;   /* GF_ATOMIC_*, never above
+                                          cache_size */
         int64_t          min_file_size;
         int64_t          max_file_size;
         struct list_head inodes; /* list of inodes cached */
         struct list_head active;
-        struct list_head *inode_lru;
+        struct ioc_shard shards[IOC_TABLE_SHARDS];
+        uint32_t         shard_pri;    /* queues per shard */
+        uint64_t         promoted;     /* ghosts read again */
+        uint64_t         rejected;     /* pages not admitted */
         struct list_head priority_list;
         int32_t          readv_count;
         pthread_mutex_t  table_lock;
@@ -336,6 +369,12 @@ ioc_cache_still_valid (ioc_inode_t *ioc_inode, struct iatt *stbuf);
 int32_t
 ioc_prune (ioc_table_t *table);
 
+int32_t
+ioc_table_reserve (ioc_table_t *table, struct ioc_shard *shard, size_t size);
+
+void
+ioc_page_admit (ioc_inode_t *ioc_inode, off_t offset, size_t size);
+
 int32_t
 ioc_need_prune (ioc_table_t *table);
 
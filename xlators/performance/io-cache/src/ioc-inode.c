@@ -192,18 +192,19 @@ ioc_inode_update (ioc_table_t *table, inode_t *inode, uint32_t weight)
         INIT_LIST_HEAD (&ioc_inode->cache.page_lru);
         pthread_mutex_init (&ioc_inode->inode_lock, NULL);
         ioc_inode->weight = weight;
+        ioc_inode->shard = &table->shards[((unsigned long) ioc_inode >> 6)
+                                          % IOC_TABLE_SHARDS];
 
         ioc_table_lock (table);
         {
                 table->inode_count++;
                 list_add (&ioc_inode->inode_list, &table->inodes);
-                list_add_tail (&ioc_inode->inode_lru,
-                               &table->inode_lru[weight]);
         }
         ioc_table_unlock (table);
 
         gf_log (table->xl->name, GF_LOG_TRACE,
-                "adding to inode_lru[%d]", weight);
+                "adding to shard %ld, weight %d",
+                (long)(ioc_inode->shard - table->shards), weight);
 
 out:
         return ioc_inode;
@@ -230,7 +231,6 @@ ioc_inode_destroy (ioc_inode_t *ioc_inode)
         {
                 table->inode_count--;
                 list_del (&ioc_inode->inode_list);
-                list_del (&ioc_inode->inode_lru);
         }
         ioc_table_unlock (table);
 
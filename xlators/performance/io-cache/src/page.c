@@ -31,40 +31,47 @@
 #include <assert.h>
 #include <sys/time.h>
 
-char
-ioc_empty (struct ioc_cache *cache)
+static ioc_page_t *
+__ioc_page_lookup (ioc_inode_t *ioc_inode, off_t offset)
 {
-        char is_empty = -1;
+        off_t  rounded_offset = 0;
 
-        GF_VALIDATE_OR_GOTO ("io-cache", cache, out);
+        rounded_offset = floor (offset, ioc_inode->table->page_size);
 
-        is_empty = list_empty (&cache->page_lru);
-
-out:
-        return is_empty;
+        return rbthash_get (ioc_inode->cache.page_table, &rounded_offset,
+                            sizeof (rounded_offset));
 }
 
 
 ioc_page_t *
 ioc_page_get (ioc_inode_t *ioc_inode, off_t offset)
 {
-        ioc_page_t   *page           = NULL;
-        ioc_table_t  *table          = NULL;
-        off_t         rounded_offset = 0;
+        ioc_page_t       *page  = NULL;
+        struct ioc_shard *shard = NULL;
 
         GF_VALIDATE_OR_GOTO ("io-cache", ioc_inode, out);
+        GF_VALIDATE_OR_GOTO ("io-cache", ioc_inode->table, out);
 
-        table = ioc_inode->table;
-        GF_VALIDATE_OR_GOTO ("io-cache", ioc_inode, out);
+        page = __ioc_page_lookup (ioc_inode, offset);
+        if (page == NULL)
+                goto out;
 
-        rounded_offset = floor (offset, table->page_size);
+        if (page->queue == IOC_QUEUE_A1OUT) {
+                /* a ghost, has no data */
+                page = NULL;
+                goto out;
+        }
 
-        page = rbthash_get (ioc_inode->cache.page_table, &rounded_offset,
-                            sizeof (rounded_offset));
+        /* push the page to the end of the lru list */
+        list_move_tail (&page->page_lru, &ioc_inode->cache.page_lru);
 
-        if (page != NULL) {
-                /* push the page to the end of the lru list */
-                list_move_tail (&page->page_lru, &ioc_inode->cache.page_lru);
+        if (page->queue == IOC_QUEUE_AM) {
+                shard = ioc_inode->shard;
+                pthread_mutex_lock (&shard->lock);
+                {
+                        list_move_tail (&page->page_2q, &shard->am[page->pri]);
+                }
+                pthread_mutex_unlock (&shard->lock);
         }
 
 out:
@@ -72,11 +79,63 @@ out:
 }
 
 
+/* takes @page off its queue, returns the bytes it was charged.
+ * shard lock held.
+ */
+static size_t
+__ioc_page_unqueue (struct ioc_shard *shard, ioc_page_t *page)
+{
+        size_t charged = 0;
+
+        switch (page->queue) {
+        case IOC_QUEUE_A1IN:
+                shard->a1in_size -= page->charged;
+                /* fall through */
+        case IOC_QUEUE_AM:
+                charged = page->charged;
+                break;
+        case IOC_QUEUE_A1OUT:
+                shard->a1out_count--;
+                break;
+        default:
+                return 0;
+        }
+
+        list_del_init (&page->page_2q);
+        page->queue = IOC_QUEUE_NONE;
+        page->charged = 0;
+
+        return charged;
+}
+
+
+/* inode lock held */
+static size_t
+ioc_page_unqueue (ioc_page_t *page)
+{
+        struct ioc_shard *shard   = NULL;
+        size_t            charged = 0;
+
+        if (page->queue == IOC_QUEUE_NONE)
+                return 0;
+
+        shard = page->inode->shard;
+        pthread_mutex_lock (&shard->lock);
+        {
+                charged = __ioc_page_unqueue (shard, page);
+        }
+        pthread_mutex_unlock (&shard->lock);
+
+        return charged;
+}
+
+
 /*
  * ioc_page_destroy -
  *
  * @page:
  *
+ * returns the bytes to uncharge from the cache, -1 if the page is busy.
  */
 int64_t
 ioc_page_destroy (ioc_page_t *page)
@@ -85,13 +144,12 @@ ioc_page_destroy (ioc_page_t *page)
 
         GF_VALIDATE_OR_GOTO ("io-cache", page, out);
 
-        if (page->iobref)
-                page_size = iobref_size (page->iobref);
-
         if (page->waitq) {
                 /* frames waiting on this page, do not destroy this page */
                 page_size = -1;
         } else {
+                page_size = ioc_page_unqueue (page);
+
                 rbthash_remove (page->inode->cache.page_table, &page->offset,
                                 sizeof (page->offset));
                 list_del (&page->page_lru);
@@ -119,9 +177,176 @@ out:
         return page_size;
 }
 
+
+/* drops the data of a page evicted from a1in, keeping it as a ghost.
+ * shard and inode locks held, page already unqueued.
+ */
+static void
+__ioc_page_ghost (ioc_table_t *table, struct ioc_shard *shard,
+                  ioc_page_t *page)
+{
+        if (page->vector) {
+                iobref_unref (page->iobref);
+                GF_FREE (page->vector);
+                page->vector = NULL;
+        }
+
+        page->iobref = NULL;
+        page->count = 0;
+        page->size = 0;
+        page->ready = 0;
+
+        page->queue = IOC_QUEUE_A1OUT;
+        list_add_tail (&page->page_2q, &shard->a1out);
+        shard->a1out_count++;
+}
+
+
+/* shard lock held */
+static void
+__ioc_shard_trim_ghosts (ioc_table_t *table, struct ioc_shard *shard)
+{
+        ioc_page_t  *page      = NULL;
+        ioc_page_t  *next      = NULL;
+        ioc_inode_t *ioc_inode = NULL;
+        uint32_t     max       = 0;
+
+        /* A1out holds half the cache's worth of pages, split over the
+           shards */
+        max = table->cache_size / table->page_size / 2 / IOC_TABLE_SHARDS;
+        if (!max)
+                max = 1;
+
+        list_for_each_entry_safe (page, next, &shard->a1out, page_2q) {
+                if (shard->a1out_count <= max)
+                        break;
+
+                ioc_inode = page->inode;
+                if (pthread_mutex_trylock (&ioc_inode->inode_lock))
+                        continue;
+                {
+                        __ioc_page_unqueue (shard, page);
+                        ioc_page_destroy (page);
+                }
+                pthread_mutex_unlock (&ioc_inode->inode_lock);
+        }
+}
+
+
+/* evicts pages of @list until @size bytes are freed. pages whose inode
+ * is locked by someone else are passed over, which also avoids locking
+ * against the order of ioc_page_unqueue (inode, then shard).
+ */
+static size_t
+__ioc_shard_evict (ioc_table_t *table, struct ioc_shard *shard,
+                   struct list_head *list, size_t size)
+{
+        ioc_page_t  *page      = NULL;
+        ioc_page_t  *next      = NULL;
+        ioc_inode_t *ioc_inode = NULL;
+        size_t       freed     = 0;
+        char         queue     = 0;
+
+        list_for_each_entry_safe (page, next, list, page_2q) {
+                if (freed >= size)
+                        break;
+
+                ioc_inode = page->inode;
+                if (pthread_mutex_trylock (&ioc_inode->inode_lock))
+                        continue;
+                {
+                        if (page->waitq)
+                                goto unlock;
+
+                        queue = page->queue;
+                        freed += __ioc_page_unqueue (shard, page);
+
+                        if (queue == IOC_QUEUE_A1IN)
+                                __ioc_page_ghost (table, shard, page);
+                        else
+                                ioc_page_destroy (page);
+                }
+        unlock:
+                pthread_mutex_unlock (&ioc_inode->inode_lock);
+        }
+
+        return freed;
+}
+
+
+/* evicts from a1in only, or from am before a1in, lowest priority first */
+static size_t
+__ioc_shard_prune (ioc_table_t *table, struct ioc_shard *shard, size_t size,
+                   char a1in_only)
+{
+        size_t   freed = 0;
+        uint32_t pri   = 0;
+
+        for (pri = 0; (pri < table->shard_pri) && (freed < size); pri++) {
+                if (!a1in_only)
+                        freed += __ioc_shard_evict (table, shard,
+                                                    &shard->am[pri],
+                                                    size - freed);
+
+                if (freed < size)
+                        freed += __ioc_shard_evict (table, shard,
+                                                    &shard->a1in[pri],
+                                                    size - freed);
+        }
+
+        __ioc_shard_trim_ghosts (table, shard);
+
+        return freed;
+}
+
+
+/* frees @size bytes, starting with the shard at @first. as in 2Q, pages
+ * seen only once are evicted first while a1in holds more than a quarter
+ * of the cache.
+ */
+static size_t
+__ioc_prune (ioc_table_t *table, uint32_t first, size_t size)
+{
+        struct ioc_shard *shard     = NULL;
+        size_t            freed     = 0;
+        uint64_t          a1in_size = 0;
+        uint32_t          i         = 0;
+        int               pass      = 0;
+
+        for (i = 0; i < IOC_TABLE_SHARDS; i++)
+                a1in_size += table->shards[i].a1in_size;
+
+        pass = (a1in_size > table->cache_size / 4) ? 0 : 1;
+
+        for (; (pass < 2) && (freed < size); pass++) {
+                for (i = 0; (i < IOC_TABLE_SHARDS) && (freed < size); i++) {
+                        shard = &table->shards[(first + i)
+                                               % IOC_TABLE_SHARDS];
+
+                        pthread_mutex_lock (&shard->lock);
+                        {
+                                freed += __ioc_shard_prune (table, shard,
+                                                            size - freed,
+                                                            (pass == 0));
+                        }
+                        pthread_mutex_unlock (&shard->lock);
+                }
+        }
+
+        if (freed)
+                GF_ATOMIC_SUB (table->cache_used, freed);
+
+        gf_log (table->xl->name, GF_LOG_TRACE,
+                "pruned %"GF_PRI_SIZET" bytes, table->cache_used = %"PRIu64
+                " && table->cache_size = %"PRIu64, freed, table->cache_used,
+                table->cache_size);
+
+        return freed;
+}
+
+
 /*
- * ioc_prune - prune the cache. we have a limit to the number of pages we
- *             can have in-memory.
+ * ioc_prune - prune the cache down to cache_size, after it shrank.
  *
  * @table: ioc_table_t of this translator
  *
@@ -129,74 +354,110 @@ out:
 int32_t
 ioc_prune (ioc_table_t *table)
 {
-        ioc_inode_t *curr          = NULL, *next_ioc_inode = NULL;
-        ioc_page_t  *page          = NULL, *next = NULL;
-        int32_t      ret           = -1;
-        int32_t      index         = 0;
-        uint64_t     size_to_prune = 0;
-        uint64_t     size_pruned   = 0;
+        uint64_t used = 0;
 
         GF_VALIDATE_OR_GOTO ("io-cache", table, out);
 
-        ioc_table_lock (table);
-        {
-                size_to_prune = table->cache_used - table->cache_size;
-                /* take out the least recently used inode */
-                for (index=0; index < table->max_pri; index++) {
-                        list_for_each_entry_safe (curr, next_ioc_inode,
-                                                  &table->inode_lru[index],
-                                                  inode_lru) {
-                                /* prune page-by-page for this inode, till
-                                 * we reach the equilibrium */
-                                ioc_inode_lock (curr);
-                                /* { */
-
-                                list_for_each_entry_safe (page, next,
-                                                          &curr->cache.page_lru,
-                                                          page_lru) {
-                                        /* done with all pages, and not
-                                         * reached equilibrium yet??
-                                         * continue with next inode in
-                                         * lru_list */
-                                        size_pruned += page->size;
-                                        ret = ioc_page_destroy (page);
-
-                                        if (ret != -1)
-                                                table->cache_used -= ret;
-
-                                        gf_log (table->xl->name, GF_LOG_TRACE,
-                                                "index = %d && table->cache_"
-                                                "used = %"PRIu64" && table->"
-                                                "cache_size = %"PRIu64,
-                                                index, table->cache_used,
-                                                table->cache_size);
-
-                                        if (size_pruned >= size_to_prune)
-                                                break;
-                                } /* list_for_each_entry_safe(page...) */
+        used = GF_ATOMIC_GET (table->cache_used);
+        if (used > table->cache_size)
+                __ioc_prune (table, 0, used - table->cache_size);
 
-                                if (ioc_empty (&curr->cache)) {
-                                        list_del_init (&curr->inode_lru);
-                                }
+out:
+        return 0;
+}
 
-                                /* } */
-                                ioc_inode_unlock (curr);
 
-                                if (size_pruned >= size_to_prune)
-                                        break;
-                        } /* list_for_each_entry_safe (curr...) */
+/*
+ * ioc_table_reserve - charge @size bytes to the cache, evicting to make
+ *                     room. fails if not enough could be evicted.
+ */
+int32_t
+ioc_table_reserve (ioc_table_t *table, struct ioc_shard *shard, size_t size)
+{
+        uint64_t used  = 0;
+        int      tries = 0;
+
+        for (;;) {
+                used = table->cache_used;
+                if (used + size <= table->cache_size) {
+                        if (GF_ATOMIC_CAS (table->cache_used, used,
+                                           used + size))
+                                return 0;
+                        continue;
+                }
 
-                        if (size_pruned >= size_to_prune)
-                                break;
-                } /* for(index=0;...) */
+                if (tries++ > 1)
+                        break;
 
-        } /* ioc_inode_table locked region end */
-        ioc_table_unlock (table);
+                if (!__ioc_prune (table, shard - table->shards,
+                                  used + size - table->cache_size))
+                        break;
+        }
 
-out:
-        return 0;
+        return -1;
+}
+
+
+/*
+ * ioc_page_admit - charge the page just filled at @offset and queue it
+ *                  for replacement, or drop it if the cache is full of
+ *                  busy pages. called without the inode lock.
+ */
+void
+ioc_page_admit (ioc_inode_t *ioc_inode, off_t offset, size_t size)
+{
+        ioc_table_t      *table    = NULL;
+        struct ioc_shard *shard    = NULL;
+        ioc_page_t       *page     = NULL;
+        int32_t           ret      = -1;
+        char              admitted = 0;
+
+        table = ioc_inode->table;
+        shard = ioc_inode->shard;
+
+        ret = ioc_table_reserve (table, shard, size);
+
+        ioc_inode_lock (ioc_inode);
+        {
+                page = __ioc_page_lookup (ioc_inode, offset);
+                if (!page || !page->vector
+                    || (page->queue != IOC_QUEUE_NONE))
+                        goto unlock;
+
+                if (ret == -1) {
+                        GF_ATOMIC_INC (table->rejected);
+                        ioc_page_destroy (page);
+                        goto unlock;
+                }
+
+                page->charged = size;
+                page->pri = min (ioc_inode->weight, table->shard_pri - 1);
+
+                pthread_mutex_lock (&shard->lock);
+                {
+                        if (page->referenced) {
+                                page->queue = IOC_QUEUE_AM;
+                                list_add_tail (&page->page_2q,
+                                               &shard->am[page->pri]);
+                        } else {
+                                page->queue = IOC_QUEUE_A1IN;
+                                list_add_tail (&page->page_2q,
+                                               &shard->a1in[page->pri]);
+                                shard->a1in_size += size;
+                        }
+                }
+                pthread_mutex_unlock (&shard->lock);
+
+                admitted = 1;
+        }
+unlock:
+        ioc_inode_unlock (ioc_inode);
+
+        if ((ret == 0) && !admitted)
+                GF_ATOMIC_SUB (table->cache_used, size);
 }
 
+
 /*
  * ioc_page_create - create a new page.
  *
@@ -219,6 +480,16 @@ ioc_page_create (ioc_inode_t *ioc_inode, off_t offset)
 
         rounded_offset = floor (offset, table->page_size);
 
+        page = __ioc_page_lookup (ioc_inode, offset);
+        if (page && (page->queue == IOC_QUEUE_A1OUT)) {
+                /* read again after its eviction from a1in */
+                ioc_page_unqueue (page);
+                page->referenced = 1;
+                GF_ATOMIC_INC (table->promoted);
+                goto out;
+        }
+        page = NULL;
+
         newpage = GF_CALLOC (1, sizeof (*newpage), gf_ioc_mt_ioc_newpage_t);
         if (newpage == NULL) {
                 goto out;
@@ -232,6 +503,7 @@ ioc_page_create (ioc_inode_t *ioc_inode, off_t offset)
 
         newpage->offset = rounded_offset;
         newpage->inode = ioc_inode;
+        INIT_LIST_HEAD (&newpage->page_2q);
         pthread_mutex_init (&newpage->page_lock, NULL);
 
         rbthash_insert (ioc_inode->cache.page_table, newpage, &rounded_offset,
@@ -431,6 +703,7 @@ ioc_fault_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                                         table->page_size, ioc_inode);
                         } else {
                                 if (page->vector) {
+                                        destroy_size += ioc_page_unqueue (page);
                                         iobref_unref (page->iobref);
                                         GF_FREE (page->vector);
                                         page->vector = NULL;
@@ -484,25 +757,11 @@ unlock:
 
         ioc_waitq_return (waitq);
 
-        if (iobref_page_size) {
-                ioc_table_lock (table);
-                {
-                        table->cache_used += iobref_page_size;
-                }
-                ioc_table_unlock (table);
-        }
-
-        if (destroy_size) {
-                ioc_table_lock (table);
-                {
-                        table->cache_used -= destroy_size;
-                }
-                ioc_table_unlock (table);
-        }
+        if (destroy_size)
+                GF_ATOMIC_SUB (table->cache_used, destroy_size);
 
-        if (ioc_need_prune (ioc_inode->table)) {
-                ioc_prune (ioc_inode->table);
-        }
+        if (iobref_page_size)
+                ioc_page_admit (ioc_inode, offset, iobref_page_size);
 
         gf_log (frame->this->name, GF_LOG_TRACE, "fault frame %p returned",
                 frame);
@@ -939,9 +1198,8 @@ ioc_page_error (ioc_page_t *page, int32_t op_ret, int32_t op_errno)
         table = page->inode->table;
         ret = ioc_page_destroy (page);
 
-        if (ret != -1) {
-                table->cache_used -= ret;
-        }
+        if (ret > 0)
+                GF_ATOMIC_SUB (table->cache_used, ret);
 
 out:
         return waitq;
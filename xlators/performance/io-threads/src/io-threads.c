@@ -32,44 +32,289 @@
 #include <sys/time.h>
 #include <time.h>
 #include "locking.h"
+#include "statedump.h"
 
 void *iot_worker (void *arg);
 int iot_workers_scale (iot_conf_t *conf);
 int __iot_workers_scale (iot_conf_t *conf);
 
 
-call_stub_t *
-__iot_dequeue (iot_conf_t *conf)
+static const char *iot_pri_names[IOT_PRI_MAX] = {
+        [IOT_PRI_HI]     = "high",
+        [IOT_PRI_NORMAL] = "normal",
+        [IOT_PRI_LO]     = "low",
+};
+
+
+/* wakes up an idle worker, if any */
+static void
+iot_wake (iot_conf_t *conf)
+{
+        if (!GF_ATOMIC_GET (conf->sleep_count))
+                return;
+
+        pthread_mutex_lock (&conf->mutex);
+        {
+                pthread_cond_signal (&conf->cond);
+        }
+        pthread_mutex_unlock (&conf->mutex);
+}
+
+
+/* whether a request is queued which some worker may pick up now */
+static int
+iot_runnable (iot_conf_t *conf)
+{
+        int pri = 0;
+
+        for (pri = 0; pri < IOT_PRI_MAX; pri++) {
+                if ((GF_ATOMIC_GET (conf->queued[pri]) > 0)
+                    && (GF_ATOMIC_GET (conf->active[pri]) < conf->limit[pri]))
+                        return 1;
+        }
+
+        return 0;
+}
+
+
+/* takes a worker slot of @pri, unless its quota is used up */
+static int
+iot_reserve (iot_conf_t *conf, int pri)
 {
-        call_stub_t  *stub = NULL;
-        int           i = 0;
+        int32_t active = 0;
+
+        do {
+                active = conf->active[pri];
+                if (active >= conf->limit[pri])
+                        return 0;
+        } while (!GF_ATOMIC_CAS (conf->active[pri], active, active + 1));
+
+        return 1;
+}
+
+
+static void
+iot_release (iot_conf_t *conf, int pri)
+{
+        GF_ATOMIC_DEC (conf->active[pri]);
+
+        if (GF_ATOMIC_GET (conf->queued[pri]) > 0)
+                iot_wake (conf);
+}
+
+
+static uint64_t
+iot_usec_since (struct timeval *then)
+{
+        struct timeval now = {0, };
+
+        gettimeofday (&now, NULL);
+
+        return (now.tv_sec - then->tv_sec) * 1000000
+                + (now.tv_usec - then->tv_usec);
+}
+
+
+static void
+iot_account_wait (iot_conf_t *conf, call_stub_t *stub, int pri)
+{
+        uint64_t       wait = 0;
+
+        wait = iot_usec_since (&stub->queued_at);
+
+        GF_ATOMIC_INC (conf->dequeued[pri]);
+        GF_ATOMIC_ADD (conf->wait_usec[pri], wait);
+        if (wait > conf->max_wait_usec[pri])
+                conf->max_wait_usec[pri] = wait;
+}
+
+
+/* number of workers the pool should have right now */
+static int
+iot_wanted (iot_conf_t *conf)
+{
+        int wanted = 0;
+
+        if (conf->autoscale)
+                return conf->target;
+
+        wanted = log_base2 (conf->queue_size);
 
-        for (i = 0; i < IOT_PRI_MAX; i++) {
-                if (list_empty (&conf->reqs[i]))
+        if (wanted < IOT_MIN_THREADS)
+                wanted = IOT_MIN_THREADS;
+
+        if (wanted > conf->max_count)
+                wanted = conf->max_count;
+
+        return wanted;
+}
+
+
+/* hill-climbs the pool size, one thread per IOT_TUNE_INTERVAL. a thread
+ * is added while requests of some priority wait in the queue longer than
+ * they take to serve. if the added thread made service slower by half
+ * (a seeking disk), it is taken back and growth is held off for a while.
+ * workers are dropped while some sit idle.
+ */
+static void
+iot_autoscale (iot_conf_t *conf)
+{
+        time_t    now = 0;
+        time_t    then = 0;
+        uint64_t  done = 0;
+        uint64_t  wait = 0;
+        uint64_t  svc = 0;
+        uint64_t  done_total = 0;
+        uint64_t  svc_total = 0;
+        uint64_t  svc_avg = 0;
+        int32_t   target = 0;
+        int       grow = 0;
+        int       pri = 0;
+
+        now = time (NULL);
+        then = conf->tune_at;
+        if (now < then + IOT_TUNE_INTERVAL)
+                return;
+
+        /* one worker tunes per interval */
+        if (!GF_ATOMIC_CAS (conf->tune_at, then, now))
+                return;
+
+        for (pri = 0; pri < IOT_PRI_MAX; pri++) {
+                done = conf->dequeued[pri] - conf->tune_dequeued[pri];
+                wait = conf->wait_usec[pri] - conf->tune_wait[pri];
+                svc = conf->svc_usec[pri] - conf->tune_svc[pri];
+
+                conf->tune_dequeued[pri] += done;
+                conf->tune_wait[pri] += wait;
+                conf->tune_svc[pri] += svc;
+
+                if (!done)
                         continue;
-                stub = list_entry (conf->reqs[i].next, call_stub_t, list);
-                break;
+
+                done_total += done;
+                svc_total += svc;
+
+                /* another thread only helps if the quota lets it in */
+                if ((wait > svc) && (conf->limit[pri] > conf->curr_count))
+                        grow = 1;
+        }
+
+        if (!done_total)
+                return;
+
+        svc_avg = svc_total / done_total;
+        target = conf->target;
+
+        if (conf->hold)
+                conf->hold--;
+
+        if (grow && conf->grew && (svc_avg > conf->tune_svc_avg * 3 / 2)) {
+                target--;
+                conf->hold = IOT_TUNE_HOLD;
+                conf->grew = 0;
+        } else if (grow && !conf->hold) {
+                target++;
+                conf->grew = 1;
+        } else {
+                if (!grow && GF_ATOMIC_GET (conf->sleep_count))
+                        target--;
+                conf->grew = 0;
         }
 
-        if (!stub)
-                return NULL;
+        if (target < conf->min_count)
+                target = conf->min_count;
+        if (target > conf->max_count)
+                target = conf->max_count;
+
+        if (target != conf->target)
+                gf_log (conf->this->name, GF_LOG_DEBUG,
+                        "target threads %d -> %d (service %"PRIu64"us, "
+                        "was %"PRIu64"us)", conf->target, target,
+                        svc_avg, conf->tune_svc_avg);
+
+        conf->target = target;
+        conf->tune_svc_avg = svc_avg;
+
+        if (target > conf->curr_count)
+                iot_workers_scale (conf);
+}
+
 
-        conf->queue_size--;
-        list_del_init (&stub->list);
+/* picks the most urgent request whose priority has a free worker slot,
+ * looking into the home queue of the worker first.
+ */
+call_stub_t *
+iot_dequeue (iot_conf_t *conf, int home, int *pri_p)
+{
+        struct iot_queue *queue = NULL;
+        call_stub_t      *stub = NULL;
+        int               pri = 0;
+        int               i = 0;
+
+        for (pri = 0; pri < IOT_PRI_MAX; pri++) {
+                if (GF_ATOMIC_GET (conf->queued[pri]) <= 0)
+                        continue;
+
+                if (!iot_reserve (conf, pri))
+                        continue;
+
+                for (i = 0; i < IOT_QUEUES; i++) {
+                        queue = &conf->queues[(home + i) % IOT_QUEUES];
+                        if (!queue->size[pri])
+                                continue;
+
+                        LOCK (&queue->lock);
+                        {
+                                if (!list_empty (&queue->reqs[pri])) {
+                                        stub = list_entry (queue->reqs[pri].next,
+                                                           call_stub_t, list);
+                                        list_del_init (&stub->list);
+                                        queue->size[pri]--;
+                                }
+                        }
+                        UNLOCK (&queue->lock);
+
+                        if (stub)
+                                break;
+                }
+
+                if (stub) {
+                        GF_ATOMIC_DEC (conf->queued[pri]);
+                        GF_ATOMIC_DEC (conf->queue_size);
+                        iot_account_wait (conf, stub, pri);
+                        *pri_p = pri;
+                        break;
+                }
+
+                iot_release (conf, pri);
+        }
 
         return stub;
 }
 
 
 void
-__iot_enqueue (iot_conf_t *conf, call_stub_t *stub, int pri)
+iot_enqueue (iot_conf_t *conf, call_stub_t *stub, int pri)
 {
+        struct iot_queue *queue = NULL;
+
         if (pri < 0 || pri >= IOT_PRI_MAX)
                 pri = IOT_PRI_MAX-1;
 
-        list_add_tail (&stub->list, &conf->reqs[pri]);
+        gettimeofday (&stub->queued_at, NULL);
 
-        conf->queue_size++;
+        queue = &conf->queues[GF_ATOMIC_INC (conf->next_queue) % IOT_QUEUES];
+
+        LOCK (&queue->lock);
+        {
+                list_add_tail (&stub->list, &queue->reqs[pri]);
+                queue->size[pri]++;
+        }
+        UNLOCK (&queue->lock);
+
+        GF_ATOMIC_INC (conf->queued[pri]);
+        GF_ATOMIC_INC (conf->queue_size);
 
         return;
 }
@@ -82,7 +327,10 @@ iot_worker (void *data)
         xlator_t         *this = NULL;
         call_stub_t      *stub = NULL;
         struct timespec   sleep_till = {0, };
+        struct timeval    started = {0, };
         int               ret = 0;
+        int               home = 0;
+        int               pri = 0;
         char              timeout = 0;
         char              bye = 0;
 
@@ -90,28 +338,61 @@ iot_worker (void *data)
         this = conf->this;
         THIS = this;
 
+        home = GF_ATOMIC_INC (conf->next_home) % IOT_QUEUES;
+
         for (;;) {
+                stub = iot_dequeue (conf, home, &pri);
+                if (stub) {
+                        gettimeofday (&started, NULL);
+                        call_resume (stub);
+                        GF_ATOMIC_ADD (conf->svc_usec[pri],
+                                       iot_usec_since (&started));
+                        iot_release (conf, pri);
+
+                        if (!conf->autoscale)
+                                continue;
+
+                        iot_autoscale (conf);
+
+                        pthread_mutex_lock (&conf->mutex);
+                        {
+                                if (conf->curr_count > conf->target) {
+                                        conf->curr_count--;
+                                        bye = 1;
+                                }
+                        }
+                        pthread_mutex_unlock (&conf->mutex);
+
+                        if (bye)
+                                break;
+                        continue;
+                }
+
                 sleep_till.tv_sec = time (NULL) + conf->idle_time;
 
                 pthread_mutex_lock (&conf->mutex);
                 {
-                        while (conf->queue_size == 0) {
-                                conf->sleep_count++;
+                        /* queuers check sleep_count after queueing, so
+                           either they see us here or we see their request */
+                        GF_ATOMIC_INC (conf->sleep_count);
 
+                        while (!iot_runnable (conf)) {
                                 ret = pthread_cond_timedwait (&conf->cond,
                                                               &conf->mutex,
                                                               &sleep_till);
-                                conf->sleep_count--;
-
                                 if (ret == ETIMEDOUT) {
                                         timeout = 1;
                                         break;
                                 }
                         }
 
+                        GF_ATOMIC_DEC (conf->sleep_count);
+
                         if (timeout) {
-                                if (conf->curr_count > IOT_MIN_THREADS) {
+                                if (conf->curr_count > conf->min_count) {
                                         conf->curr_count--;
+                                        if (conf->target > conf->curr_count)
+                                                conf->target = conf->curr_count;
                                         bye = 1;
                                         gf_log (conf->this->name, GF_LOG_DEBUG,
                                                 "timeout, terminated. conf->curr_count=%d",
@@ -120,14 +401,9 @@ iot_worker (void *data)
                                         timeout = 0;
                                 }
                         }
-
-                        stub = __iot_dequeue (conf);
                 }
                 pthread_mutex_unlock (&conf->mutex);
 
-                if (stub) /* guard against spurious wakeups */
-                        call_resume (stub);
-
                 if (bye)
                         break;
         }
@@ -141,15 +417,13 @@ do_iot_schedule (iot_conf_t *conf, call_stub_t *stub, int pri)
 {
         int   ret = 0;
 
-        pthread_mutex_lock (&conf->mutex);
-        {
-                __iot_enqueue (conf, stub, pri);
+        iot_enqueue (conf, stub, pri);
 
-                pthread_cond_signal (&conf->cond);
+        iot_wake (conf);
 
-                ret = __iot_workers_scale (conf);
-        }
-        pthread_mutex_unlock (&conf->mutex);
+        /* racy peek, __iot_workers_scale decides under the lock */
+        if (iot_wanted (conf) > conf->curr_count)
+                ret = iot_workers_scale (conf);
 
         return ret;
 }
@@ -1986,21 +2260,12 @@ out:
 int
 __iot_workers_scale (iot_conf_t *conf)
 {
-        int       log2 = 0;
         int       scale = 0;
         int       diff = 0;
         pthread_t thread;
         int       ret = 0;
 
-        log2 = log_base2 (conf->queue_size);
-
-        scale = log2;
-
-        if (log2 < IOT_MIN_THREADS)
-                scale = IOT_MIN_THREADS;
-
-        if (log2 > conf->max_count)
-                scale = conf->max_count;
+        scale = iot_wanted (conf);
 
         if (conf->curr_count < scale) {
                 diff = scale - conf->curr_count;
@@ -2109,6 +2374,79 @@ out:
 }
 
 
+/* per-priority caps on the number of busy workers, so that bulk
+ * requests cannot occupy every thread.
+ */
+static void
+iot_set_limits (iot_conf_t *conf, dict_t *options)
+{
+        static const char *keys[IOT_PRI_MAX] = {
+                [IOT_PRI_HI]     = "high-prio-threads",
+                [IOT_PRI_NORMAL] = "normal-prio-threads",
+                [IOT_PRI_LO]     = "low-prio-threads",
+        };
+        int32_t            limit = 0;
+        int                pri = 0;
+
+        for (pri = 0; pri < IOT_PRI_MAX; pri++) {
+                if (pri == IOT_PRI_LO)
+                        limit = max (conf->max_count / 2, IOT_MIN_THREADS);
+                else
+                        limit = conf->max_count;
+
+                if (options && dict_get (options, (char *)keys[pri]))
+                        limit = data_to_int32 (dict_get (options,
+                                                         (char *)keys[pri]));
+
+                if (limit < IOT_MIN_THREADS)
+                        limit = IOT_MIN_THREADS;
+                if (limit > conf->max_count)
+                        limit = conf->max_count;
+
+                conf->limit[pri] = limit;
+        }
+}
+
+
+static int
+iot_set_scaling (iot_conf_t *conf, dict_t *options)
+{
+        char          *str = NULL;
+        gf_boolean_t   autoscale = _gf_false;
+        int32_t        min_count = IOT_MIN_THREADS;
+
+        if (dict_get (options, "autoscaling")) {
+                str = data_to_str (dict_get (options, "autoscaling"));
+                if (gf_string2boolean (str, &autoscale) == -1) {
+                        gf_log (conf->this->name, GF_LOG_ERROR,
+                                "'autoscaling' takes only boolean options");
+                        return -1;
+                }
+        }
+
+        if (dict_get (options, "min-threads"))
+                min_count = data_to_int32 (dict_get (options, "min-threads"));
+
+        if (min_count < IOT_MIN_THREADS)
+                min_count = IOT_MIN_THREADS;
+        if (min_count > conf->max_count)
+                min_count = conf->max_count;
+
+        if (autoscale && !conf->autoscale)
+                conf->target = conf->curr_count;
+
+        conf->min_count = min_count;
+        if (conf->target < min_count)
+                conf->target = min_count;
+        if (conf->target > conf->max_count)
+                conf->target = conf->max_count;
+
+        conf->autoscale = autoscale;
+
+        return 0;
+}
+
+
 int
 reconfigure ( xlator_t *this, dict_t *options)
 {
@@ -2146,6 +2484,19 @@ reconfigure ( xlator_t *this, dict_t *options)
         } else
                 conf->max_count = thread_count;
 
+        iot_set_limits (conf, options);
+
+        ret = iot_set_scaling (conf, options);
+        if (ret)
+                goto out;
+
+        /* workers parked on a lower limit may be runnable now */
+        pthread_mutex_lock (&conf->mutex);
+        {
+                pthread_cond_broadcast (&conf->cond);
+        }
+        pthread_mutex_unlock (&conf->mutex);
+
 	ret = 0;
 
 out:
@@ -2162,6 +2513,7 @@ init (xlator_t *this)
         int              idle_time = IOT_DEFAULT_IDLE;
         int              ret = -1;
         int              i = 0;
+        int              j = 0;
 
 	if (!this->children || this->children->next) {
 		gf_log ("io-threads", GF_LOG_ERROR,
@@ -2214,8 +2566,20 @@ init (xlator_t *this)
 
         conf->this = this;
 
-        for (i = 0; i < IOT_PRI_MAX; i++) {
-                INIT_LIST_HEAD (&conf->reqs[i]);
+        pthread_mutex_init (&conf->mutex, NULL);
+        pthread_cond_init (&conf->cond, NULL);
+
+        for (i = 0; i < IOT_QUEUES; i++) {
+                LOCK_INIT (&conf->queues[i].lock);
+                for (j = 0; j < IOT_PRI_MAX; j++)
+                        INIT_LIST_HEAD (&conf->queues[i].reqs[j]);
+        }
+
+        iot_set_limits (conf, options);
+
+        if (iot_set_scaling (conf, options)) {
+                GF_FREE (conf);
+                goto out;
         }
 
 	ret = iot_workers_scale (conf);
@@ -2234,6 +2598,77 @@ out:
 }
 
 
+int
+iot_priv_dump (xlator_t *this)
+{
+        iot_conf_t *conf = NULL;
+        char        key_prefix[GF_DUMP_MAX_BUF_LEN];
+        char        key[GF_DUMP_MAX_BUF_LEN];
+        int         ret = -1;
+        int         pri = 0;
+
+        if (!this)
+                goto out;
+
+        conf = this->private;
+        if (!conf)
+                goto out;
+
+        ret = pthread_mutex_trylock (&conf->mutex);
+        if (ret) {
+                gf_log (this->name, GF_LOG_WARNING, "Unable to lock conf");
+                goto out;
+        }
+
+        gf_proc_dump_build_key (key_prefix, "xlator.performance.io-threads",
+                                "priv");
+        gf_proc_dump_add_section (key_prefix);
+
+        gf_proc_dump_build_key (key, key_prefix, "maximum_threads_count");
+        gf_proc_dump_write (key, "%d", conf->max_count);
+        gf_proc_dump_build_key (key, key_prefix, "current_threads_count");
+        gf_proc_dump_write (key, "%d", conf->curr_count);
+        gf_proc_dump_build_key (key, key_prefix, "sleep_count");
+        gf_proc_dump_write (key, "%d", conf->sleep_count);
+        gf_proc_dump_build_key (key, key_prefix, "idle_time");
+        gf_proc_dump_write (key, "%d", conf->idle_time);
+        gf_proc_dump_build_key (key, key_prefix, "autoscaling");
+        gf_proc_dump_write (key, "%s", conf->autoscale ? "on" : "off");
+        gf_proc_dump_build_key (key, key_prefix, "minimum_threads_count");
+        gf_proc_dump_write (key, "%d", conf->min_count);
+        gf_proc_dump_build_key (key, key_prefix, "target_threads_count");
+        gf_proc_dump_write (key, "%d", conf->target);
+
+        for (pri = 0; pri < IOT_PRI_MAX; pri++) {
+                gf_proc_dump_build_key (key, key_prefix, "%s.queue_depth",
+                                        iot_pri_names[pri]);
+                gf_proc_dump_write (key, "%d", conf->queued[pri]);
+                gf_proc_dump_build_key (key, key_prefix, "%s.active",
+                                        iot_pri_names[pri]);
+                gf_proc_dump_write (key, "%d", conf->active[pri]);
+                gf_proc_dump_build_key (key, key_prefix, "%s.limit",
+                                        iot_pri_names[pri]);
+                gf_proc_dump_write (key, "%d", conf->limit[pri]);
+                gf_proc_dump_build_key (key, key_prefix, "%s.dequeued",
+                                        iot_pri_names[pri]);
+                gf_proc_dump_write (key, "%"PRIu64, conf->dequeued[pri]);
+                gf_proc_dump_build_key (key, key_prefix, "%s.wait_total_usec",
+                                        iot_pri_names[pri]);
+                gf_proc_dump_write (key, "%"PRIu64, conf->wait_usec[pri]);
+                gf_proc_dump_build_key (key, key_prefix, "%s.wait_max_usec",
+                                        iot_pri_names[pri]);
+                gf_proc_dump_write (key, "%"PRIu64, conf->max_wait_usec[pri]);
+                gf_proc_dump_build_key (key, key_prefix, "%s.svc_total_usec",
+                                        iot_pri_names[pri]);
+                gf_proc_dump_write (key, "%"PRIu64, conf->svc_usec[pri]);
+        }
+
+        pthread_mutex_unlock (&conf->mutex);
+out:
+        return ret;
+}
+
+
 void
 fini (xlator_t *this)
 {
@@ -2288,6 +2723,10 @@ struct xlator_fops fops = {
 struct xlator_cbks cbks = {
 };
 
+struct xlator_dumpops dumpops = {
+        .priv = iot_priv_dump,
+};
+
 struct volume_options options[] = {
 	{ .key  = {"thread-count"},
 	  .type = GF_OPTION_TYPE_INT,
@@ -2299,6 +2738,29 @@ struct volume_options options[] = {
          .min   = 1,
          .max   = 0x7fffffff,
         },
+        { .key  = {"autoscaling"},
+          .type = GF_OPTION_TYPE_BOOL
+        },
+        { .key  = {"min-threads"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = IOT_MIN_THREADS,
+          .max  = IOT_MAX_THREADS
+        },
+        { .key  = {"high-prio-threads"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = IOT_MIN_THREADS,
+          .max  = IOT_MAX_THREADS
+        },
+        { .key  = {"normal-prio-threads"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = IOT_MIN_THREADS,
+          .max  = IOT_MAX_THREADS
+        },
+        { .key  = {"low-prio-threads"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = IOT_MIN_THREADS,
+          .max  = IOT_MAX_THREADS
+        },
 	{ .key  = {NULL},
         },
 };
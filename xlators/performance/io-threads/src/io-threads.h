@@ -52,6 +52,10 @@ struct iot_conf;
 
 #define IOT_THREAD_STACK_SIZE   ((size_t)(1024*1024))
 
+#define IOT_TUNE_INTERVAL       1       /* In secs, autoscaling period */
+#define IOT_TUNE_HOLD           8       /* intervals without growth after
+                                           a thread made service slower */
+
 
 typedef enum {
         IOT_PRI_HI = 0, /* low latency */
@@ -61,8 +65,20 @@ typedef enum {
 } iot_pri_t;
 
 
+/* requests are spread over IOT_QUEUES queues, each with its own lock. a
+ * worker drains its home queue first and steals from the others when it
+ * runs dry.
+ */
+#define IOT_QUEUES              8
+
+struct iot_queue {
+        gf_lock_t            lock;
+        struct list_head     reqs[IOT_PRI_MAX];
+        int32_t              size[IOT_PRI_MAX];
+};
+
 struct iot_conf {
-        pthread_mutex_t      mutex;
+        pthread_mutex_t      mutex;       /* thread pool and idle workers */
         pthread_cond_t       cond;
 
         int32_t              max_count;   /* configured maximum */
@@ -71,9 +87,35 @@ struct iot_conf {
 
         int32_t              idle_time;   /* in seconds */
 
-        struct list_head     reqs[IOT_PRI_MAX];
+        struct iot_queue     queues[IOT_QUEUES];
+        uint32_t             next_queue;  /* queue of the next request */
+        uint32_t             next_home;   /* home queue of the next worker */
 
+        /* updated with GF_ATOMIC_* */
         int                  queue_size;
+        int32_t              queued[IOT_PRI_MAX];
+        int32_t              active[IOT_PRI_MAX]; /* workers running a
+                                                     request of this prio */
+        int32_t              limit[IOT_PRI_MAX];  /* cap on active[] */
+
+        uint64_t             dequeued[IOT_PRI_MAX];
+        uint64_t             wait_usec[IOT_PRI_MAX];     /* total queue wait */
+        uint64_t             max_wait_usec[IOT_PRI_MAX];
+        uint64_t             svc_usec[IOT_PRI_MAX];      /* total service */
+
+        /* autoscaling: keep target between min_count and max_count,
+           moving it one thread per IOT_TUNE_INTERVAL */
+        gf_boolean_t         autoscale;
+        int32_t              min_count;
+        int32_t              target;
+        time_t               tune_at;
+        char                 grew;        /* last step added a thread */
+        int32_t              hold;
+        uint64_t             tune_dequeued[IOT_PRI_MAX];
+        uint64_t             tune_wait[IOT_PRI_MAX];
+        uint64_t             tune_svc[IOT_PRI_MAX];
+        uint64_t             tune_svc_avg;
+
         pthread_attr_t       w_attr;
 
         xlator_t            *this;
@@ -29,6 +29,42 @@
 #include "read-ahead.h"
 #include <assert.h>
 
+int
+ra_file_pages_init (ra_file_t *file)
+{
+        uint32_t buckets = RA_PAGE_HASH_MIN;
+        int      ret     = -1;
+
+        GF_VALIDATE_OR_GOTO ("read-ahead", file, out);
+
+        file->pages.next = &file->pages;
+        file->pages.prev = &file->pages;
+        file->pages.offset = (unsigned long long) 0;
+        file->pages.file = file;
+
+        while (buckets < 2 * file->conf->page_count)
+                buckets <<= 1;
+
+        file->page_hash = GF_CALLOC (buckets, sizeof (*file->page_hash),
+                                     gf_ra_mt_ra_page_hash_t);
+        if (!file->page_hash)
+                goto out;
+
+        file->page_hash_mask = buckets - 1;
+        ret = 0;
+out:
+        return ret;
+}
+
+
+static inline ra_page_t **
+ra_page_bucket (ra_file_t *file, off_t rounded_offset)
+{
+        return &file->page_hash[(rounded_offset / file->page_size)
+                                & file->page_hash_mask];
+}
+
+
 ra_page_t *
 ra_page_get (ra_file_t *file, off_t offset)
 {
@@ -37,14 +73,11 @@ ra_page_get (ra_file_t *file, off_t offset)
 
         GF_VALIDATE_OR_GOTO ("read-ahead", file, out);
 
-        page = file->pages.next;
         rounded_offset = floor (offset, file->page_size);
 
-        while (page != &file->pages && page->offset < rounded_offset)
-                page = page->next;
-
-        if (page == &file->pages || page->offset != rounded_offset)
-                page = NULL;
+        page = *ra_page_bucket (file, rounded_offset);
+        while (page && page->offset != rounded_offset)
+                page = page->hash_next;
 
 out:
         return page;
@@ -57,30 +90,39 @@ ra_page_create (ra_file_t *file, off_t offset)
         ra_page_t  *page           = NULL;
         off_t       rounded_offset = 0;
         ra_page_t  *newpage        = NULL;
+        ra_page_t **bucket         = NULL;
 
         GF_VALIDATE_OR_GOTO ("read-ahead", file, out);
 
-        page           = file->pages.next;
+        page = ra_page_get (file, offset);
+        if (page)
+                goto out;
+
         rounded_offset = floor (offset, file->page_size);
 
-        while (page != &file->pages && page->offset < rounded_offset)
-                page = page->next;
+        newpage = GF_CALLOC (1, sizeof (*newpage), gf_ra_mt_ra_page_t);
+        if (!newpage) {
+                goto out;
+        }
+
+        /* read-ahead mostly appends, so search for the place in the
+           sorted list from its tail */
+        page = file->pages.prev;
+        while (page != &file->pages && page->offset > rounded_offset)
+                page = page->prev;
 
-        if (page == &file->pages || page->offset != rounded_offset) {
-                newpage = GF_CALLOC (1, sizeof (*newpage), gf_ra_mt_ra_page_t);
-                if (!newpage) {
-                        goto out;
-                }
+        newpage->offset = rounded_offset;
+        newpage->prev = page;
+        newpage->next = page->next;
+        newpage->file = file;
+        page->next->prev = newpage;
+        page->next = newpage;
 
-                newpage->offset = rounded_offset;
-                newpage->prev = page->prev;
-                newpage->next = page;
-                newpage->file = file;
-                page->prev->next = newpage;
-                page->prev = newpage;
+        bucket = ra_page_bucket (file, rounded_offset);
+        newpage->hash_next = *bucket;
+        *bucket = newpage;
 
-                page = newpage;
-        }
+        page = newpage;
 
 out:
         return page;
@@ -503,11 +545,21 @@ out:
 void
 ra_page_purge (ra_page_t *page)
 {
+        ra_page_t **bucket = NULL;
+
         GF_VALIDATE_OR_GOTO ("read-ahead", page, out);
 
         page->prev->next = page->next;
         page->next->prev = page->prev;
 
+        if (page->dirty && !page->hit)
+                page->file->wasted++;
+
+        bucket = ra_page_bucket (page->file, page->offset);
+        while (*bucket != page)
+                bucket = &(*bucket)->hash_next;
+        *bucket = page->hash_next;
+
         if (page->iobref) {
                 iobref_unref (page->iobref);
         }
@@ -584,6 +636,7 @@ ra_file_destroy (ra_file_t *file)
         }
 
         pthread_mutex_destroy (&file->file_lock);
+        GF_FREE (file->page_hash);
         GF_FREE (file);
 
 out:
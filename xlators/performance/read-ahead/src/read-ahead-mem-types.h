@@ -31,6 +31,7 @@ enum gf_ra_mem_types_ {
         gf_ra_mt_ra_waitq_t,
         gf_ra_mt_ra_fill_t,
         gf_ra_mt_iovec,
+        gf_ra_mt_ra_page_hash_t,
         gf_ra_mt_end
 };
 #endif
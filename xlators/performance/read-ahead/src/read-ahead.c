@@ -39,7 +39,7 @@
 #include <sys/time.h>
 
 static void
-read_ahead (call_frame_t *frame, ra_file_t *file);
+read_ahead (call_frame_t *frame, ra_file_t *file, ra_stream_t *stream);
 
 
 int
@@ -78,12 +78,13 @@ ra_open_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 file->disabled = 1;
         }
 
-        file->offset = (unsigned long long) 0;
         file->conf = conf;
-        file->pages.next = &file->pages;
-        file->pages.prev = &file->pages;
-        file->pages.offset = (unsigned long long) 0;
-        file->pages.file = file;
+        if (ra_file_pages_init (file) == -1) {
+                GF_FREE (file);
+                op_ret = -1;
+                op_errno = ENOMEM;
+                goto unwind;
+        }
 
         ra_conf_lock (conf);
         {
@@ -99,10 +100,6 @@ ra_open_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         file->page_size = conf->page_size;
         pthread_mutex_init (&file->file_lock, NULL);
 
-        if (!file->disabled) {
-                file->page_count = 1;
-        }
-
         ret = fd_ctx_set (fd, this, (uint64_t)(long)file);
         if (ret == -1) {
                 gf_log (frame->this->name, GF_LOG_WARNING,
@@ -153,13 +150,13 @@ ra_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         if ((fd->flags & O_DIRECT) || ((fd->flags & O_ACCMODE) == O_WRONLY))
                 file->disabled = 1;
 
-        file->offset = (unsigned long long) 0;
-        //file->size = fd->inode->buf.ia_size;
         file->conf = conf;
-        file->pages.next = &file->pages;
-        file->pages.prev = &file->pages;
-        file->pages.offset = (unsigned long long) 0;
-        file->pages.file = file;
+        if (ra_file_pages_init (file) == -1) {
+                GF_FREE (file);
+                op_ret = -1;
+                op_errno = ENOMEM;
+                goto unwind;
+        }
 
         ra_conf_lock (conf);
         {
@@ -273,75 +270,213 @@ out:
 }
 
 
+/* matches a read against the streams of @file and advances the stream
+ * it belongs to, or starts a new one. returns the stream, or NULL if
+ * the read fits none and every slot is held by a confident stream.
+ * pages in [*purge_lo, *purge_hi) are no longer of use to any stream.
+ */
+static ra_stream_t *
+__ra_stream_update (ra_file_t *file, off_t offset, size_t size,
+                    off_t *purge_lo, off_t *purge_hi)
+{
+        ra_stream_t *stream = NULL;
+        ra_stream_t *victim = NULL;
+        ra_stream_t *mru    = NULL;
+        off_t        first  = 0;
+        off_t        end    = 0;
+        int          i      = 0;
+
+        first = floor (offset, file->page_size);
+        end = roof (offset + size, file->page_size);
+
+        for (i = 0; i < RA_STREAMS; i++) {
+                stream = &file->streams[i];
+                if (!stream->used)
+                        continue;
+
+                if ((stream->stride && (offset == stream->last + stream->stride))
+                    || (offset == stream->next))
+                        goto matched;
+        }
+
+        /* a free slot, else the least recently used of the streams
+           which have not proven themselves. confident streams only
+           lose confidence to stray reads, and so eventually the slot. */
+        for (i = 0; i < RA_STREAMS; i++) {
+                stream = &file->streams[i];
+                if (stream->used && (!mru || (stream->used > mru->used)))
+                        mru = stream;
+
+                if (victim && !victim->used)
+                        continue;
+
+                if (!stream->used
+                    || ((stream->confidence < RA_CONFIDENCE_MIN)
+                        && (!victim || (stream->used < victim->used))))
+                        victim = stream;
+        }
+
+        if (!victim) {
+                victim = &file->streams[0];
+                for (i = 1; i < RA_STREAMS; i++) {
+                        stream = &file->streams[i];
+                        if (stream->used < victim->used)
+                                victim = stream;
+                }
+
+                victim->confidence--;
+
+                /* keep the pages of this read only while a stream
+                   might want them */
+                for (i = 0; i < RA_STREAMS; i++) {
+                        stream = &file->streams[i];
+                        if ((first < stream->hi) && (end > stream->lo))
+                                break;
+                }
+
+                if (i == RA_STREAMS) {
+                        *purge_lo = first;
+                        *purge_hi = end;
+                }
+
+                return NULL;
+        }
+
+        /* a new stream takes its stride from the latest read, so that
+           reverse and strided scans prove themselves on their third
+           read. interleaved sequential streams match on ->next. */
+        stream = victim;
+        if (stream->used) {
+                *purge_lo = stream->lo;
+                *purge_hi = stream->hi;
+        }
+
+        if (mru) {
+                stream->stride = offset - mru->last;
+                stream->confidence = 1;
+        } else {
+                stream->stride = 0;
+                stream->confidence = 0;
+        }
+
+        stream->window = 0;
+        stream->lo = first;
+        stream->hi = end;
+        goto out;
+
+matched:
+        stream->stride = offset - stream->last;
+        if (stream->confidence < RA_CONFIDENCE_MAX)
+                stream->confidence++;
+
+        if (stream->confidence >= RA_CONFIDENCE_MIN)
+                stream->window = stream->window ?
+                        min (stream->window * 2, file->page_count) : 1;
+
+        /* pages the stream has moved past */
+        if (stream->stride >= 0) {
+                *purge_lo = stream->lo;
+                *purge_hi = min (first, stream->hi);
+                stream->lo = first;
+                stream->hi = max (stream->hi, end);
+        } else {
+                *purge_lo = max (end, stream->lo);
+                *purge_hi = stream->hi;
+                stream->lo = min (stream->lo, first);
+                stream->hi = end;
+        }
+
+out:
+        stream->last = offset;
+        stream->next = offset + size;
+        stream->size = size;
+        stream->used = ++file->tick;
+
+        return stream;
+}
+
+
+static void
+ra_streams_reset (ra_file_t *file)
+{
+        ra_file_lock (file);
+        {
+                memset (file->streams, 0, sizeof (file->streams));
+        }
+        ra_file_unlock (file);
+}
+
+
+/* faults in the pages of the next reads @stream is expected to make,
+ * up to its window.
+ */
 void
-read_ahead (call_frame_t *frame, ra_file_t *file)
+read_ahead (call_frame_t *frame, ra_file_t *file, ra_stream_t *stream)
 {
         off_t      ra_offset   = 0;
-        size_t     ra_size     = 0;
         off_t      trav_offset = 0;
+        off_t      end         = 0;
         ra_page_t *trav        = NULL;
-        off_t      cap         = 0;
+        uint32_t   pages       = 0;
         char       fault       = 0;
 
         GF_VALIDATE_OR_GOTO ("read-ahead", frame, out);
         GF_VALIDATE_OR_GOTO (frame->this->name, file, out);
 
-        if (!file->page_count) {
+        if (!stream->window || !stream->stride || !stream->size) {
                 goto out;
         }
 
-        ra_size   = file->page_size * file->page_count;
-        ra_offset = floor (file->offset, file->page_size);
-        cap       = file->size ? file->size : file->offset + ra_size;
-
-        while (ra_offset < min (file->offset + ra_size, cap)) {
-
-                ra_file_lock (file);
-                {
-                        trav = ra_page_get (file, ra_offset);
-                }
-                ra_file_unlock (file);
+        ra_offset = stream->last;
 
-                if (!trav)
+        while (pages < stream->window) {
+                ra_offset += stream->stride;
+                if (ra_offset < 0)
                         break;
 
-                ra_offset += file->page_size;
-        }
-
-        if (trav) {
-                /* comfortable enough */
-                goto out;
-        }
-
-        trav_offset = ra_offset;
-
-        cap  = file->size ? file->size : ra_offset + ra_size;
+                trav_offset = floor (ra_offset, file->page_size);
+                end = ra_offset + stream->size;
+
+                /* every pass takes at least one page off the window */
+                if (end <= trav_offset)
+                        end = trav_offset + 1;
+
+                for (; trav_offset < end && pages < stream->window;
+                     trav_offset += file->page_size, pages++) {
+                        fault = 0;
+                        ra_file_lock (file);
+                        {
+                                trav = ra_page_get (file, trav_offset);
+                                if (!trav) {
+                                        fault = 1;
+                                        trav = ra_page_create (file,
+                                                               trav_offset);
+                                        if (trav)
+                                                trav->dirty = 1;
+                                }
+
+                                if (trav) {
+                                        if (trav_offset < stream->lo)
+                                                stream->lo = trav_offset;
+                                        if (trav_offset + file->page_size
+                                            > stream->hi)
+                                                stream->hi = trav_offset
+                                                        + file->page_size;
+                                }
+                        }
+                        ra_file_unlock (file);
 
-        while (trav_offset < min(ra_offset + ra_size, cap)) {
-                fault = 0;
-                ra_file_lock (file);
-                {
-                        trav = ra_page_get (file, trav_offset);
                         if (!trav) {
-                                fault = 1;
-                                trav = ra_page_create (file, trav_offset);
-                                if (trav)
-                                        trav->dirty = 1;
+                                /* OUT OF MEMORY */
+                                goto out;
                         }
-                }
-                ra_file_unlock (file);
-
-                if (!trav) {
-                        /* OUT OF MEMORY */
-                        break;
-                }
 
-                if (fault) {
-                        gf_log (frame->this->name, GF_LOG_TRACE,
-                                "RA at offset=%"PRId64, trav_offset);
-                        ra_page_fault (file, frame, trav_offset);
+                        if (fault) {
+                                gf_log (frame->this->name, GF_LOG_TRACE,
+                                        "RA at offset=%"PRId64, trav_offset);
+                                ra_page_fault (file, frame, trav_offset);
+                        }
                 }
-                trav_offset += file->page_size;
         }
 
 out:
@@ -402,6 +537,13 @@ dispatch_requests (call_frame_t *frame, ra_file_t *file)
                                 goto unlock;
                         }
 
+                        if (fault) {
+                                file->misses++;
+                        } else {
+                                file->hits++;
+                                trav->hit = 1;
+                        }
+
                         if (trav->ready) {
                                 gf_log (frame->this->name, GF_LOG_TRACE,
                                         "HIT at offset=%"PRId64".",
@@ -471,17 +613,17 @@ ra_readv (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
 {
         ra_file_t   *file            = NULL;
         ra_local_t  *local           = NULL;
-        ra_conf_t   *conf            = NULL;
+        ra_stream_t *stream          = NULL;
+        ra_stream_t  snap            = {0, };
+        off_t        purge_lo        = 0;
+        off_t        purge_hi        = 0;
         int          op_errno        = EINVAL;
-        char         expected_offset = 1;
         uint64_t     tmp_file        = 0;
 
         GF_ASSERT (frame);
         GF_VALIDATE_OR_GOTO (frame->this->name, this, unwind);
         GF_VALIDATE_OR_GOTO (frame->this->name, fd, unwind);
 
-        conf = this->private;
-
         gf_log (this->name, GF_LOG_TRACE,
                 "NEW REQ at offset=%"PRId64" for size=%"GF_PRI_SIZET"",
                 offset, size);
@@ -497,30 +639,8 @@ ra_readv (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
                 goto unwind;
         }
 
-        if (file->offset != offset) {
-                gf_log (this->name, GF_LOG_TRACE,
-                        "unexpected offset (%"PRId64" != %"PRId64") resetting",
-                        file->offset, offset);
-
-                expected_offset = file->expected = file->page_count = 0;
-        } else {
-                gf_log (this->name, GF_LOG_TRACE,
-                        "expected offset (%"PRId64") when page_count=%d",
-                        offset, file->page_count);
-
-                if (file->expected < (conf->page_size * conf->page_count)) {
-                        file->expected += size;
-                        file->page_count = min ((file->expected
-                                                 / file->page_size),
-                                                conf->page_count);
-                }
-        }
-
-        if (!expected_offset) {
-                flush_region (frame, file, 0, file->pages.prev->offset + 1);
-        }
-
-        if (file->disabled) {
+        /* an empty read says nothing about the access pattern */
+        if (file->disabled || (size == 0)) {
                 STACK_WIND (frame, ra_readv_disabled_cbk,
                             FIRST_CHILD (frame->this),
                             FIRST_CHILD (frame->this)->fops->readv,
@@ -546,15 +666,38 @@ ra_readv (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
 
         frame->local = local;
 
+        ra_file_lock (file);
+        {
+                stream = __ra_stream_update (file, offset, size,
+                                             &purge_lo, &purge_hi);
+                if (stream)
+                        snap = *stream;
+        }
+        ra_file_unlock (file);
+
         dispatch_requests (frame, file);
 
-        flush_region (frame, file, 0, floor (offset, file->page_size));
+        if (purge_hi > purge_lo)
+                flush_region (frame, file, purge_lo, purge_hi - purge_lo);
 
-        read_ahead (frame, file);
+        if (stream) {
+                gf_log (this->name, GF_LOG_TRACE,
+                        "stream %p stride %"PRId64" confidence %d window %u",
+                        stream, snap.stride, snap.confidence, snap.window);
+                read_ahead (frame, file, &snap);
 
-        ra_frame_return (frame);
+                /* read_ahead () widened the range of the copy */
+                ra_file_lock (file);
+                {
+                        if (stream->used == snap.used) {
+                                stream->lo = min (stream->lo, snap.lo);
+                                stream->hi = max (stream->hi, snap.hi);
+                        }
+                }
+                ra_file_unlock (file);
+        }
 
-        file->offset = offset + size;
+        ra_frame_return (frame);
 
         return 0;
 
@@ -710,8 +853,8 @@ ra_writev (call_frame_t *frame, xlator_t *this, fd_t *fd, struct iovec *vector,
 
         flush_region (frame, file, 0, file->pages.prev->offset+1);
 
-        /* reset the read-ahead counters too */
-        file->expected = file->page_count = 0;
+        /* reset the read-ahead streams too */
+        ra_streams_reset (file);
 
         frame->local = fd;
 
@@ -915,6 +1058,72 @@ out:
 }
 
 
+int
+ra_fdctx_dump (xlator_t *this, fd_t *fd)
+{
+        ra_file_t   *file                           = NULL;
+        ra_stream_t *stream                         = NULL;
+        uint64_t     tmp_file                       = 0;
+        int          ret                            = -1;
+        int          i                              = 0;
+        char         key[GF_DUMP_MAX_BUF_LEN]        = {0, };
+        char         key_prefix[GF_DUMP_MAX_BUF_LEN] = {0, };
+
+        if ((fd == NULL) || (this == NULL)) {
+                ret = 0;
+                goto out;
+        }
+
+        ret = fd_ctx_get (fd, this, &tmp_file);
+        if (ret == -1) {
+                ret = 0;
+                goto out;
+        }
+
+        file = (ra_file_t *)(long)tmp_file;
+        if (file == NULL) {
+                ret = 0;
+                goto out;
+        }
+
+        gf_proc_dump_build_key (key_prefix, "xlator.performance.read-ahead",
+                                "file");
+
+        gf_proc_dump_add_section (key_prefix);
+
+        gf_proc_dump_build_key (key, key_prefix, "fd");
+        gf_proc_dump_write (key, "%p", fd);
+
+        gf_proc_dump_build_key (key, key_prefix, "disabled");
+        gf_proc_dump_write (key, "%d", file->disabled);
+
+        gf_proc_dump_build_key (key, key_prefix, "hits");
+        gf_proc_dump_write (key, "%"PRIu64, file->hits);
+
+        gf_proc_dump_build_key (key, key_prefix, "misses");
+        gf_proc_dump_write (key, "%"PRIu64, file->misses);
+
+        gf_proc_dump_build_key (key, key_prefix, "wasted_prefetch");
+        gf_proc_dump_write (key, "%"PRIu64, file->wasted);
+
+        for (i = 0; i < RA_STREAMS; i++) {
+                stream = &file->streams[i];
+                if (!stream->used)
+                        continue;
+
+                gf_proc_dump_build_key (key, key_prefix, "stream[%d]", i);
+                gf_proc_dump_write (key, "last=%"PRId64", stride=%"PRId64
+                                    ", confidence=%d, window=%u", stream->last,
+                                    stream->stride, stream->confidence,
+                                    stream->window);
+        }
+
+        ret = 0;
+out:
+        return ret;
+}
+
+
 int32_t
 mem_acct_init (xlator_t *this)
 {
@@ -1063,6 +1272,7 @@ struct xlator_cbks cbks = {
 
 struct xlator_dumpops dumpops = {
         .priv      =  ra_priv_dump,
+        .fdctx     =  ra_fdctx_dump,
 };
 
 struct volume_options options[] = {
@@ -1072,7 +1282,7 @@ struct volume_options options[] = {
         { .key  = {"page-count"},
           .type = GF_OPTION_TYPE_INT,
           .min  = 1,
-          .max  = 16
+          .max  = 256
         },
         { .key = {NULL} },
 };
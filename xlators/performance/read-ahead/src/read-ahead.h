@@ -72,12 +72,19 @@ struct ra_local {
 };
 
 
+/* pages are kept on an offset-sorted list and, for lookups, hashed by
+ * page number into buckets sized from page-count at open time.
+ */
+#define RA_PAGE_HASH_MIN        16
+
 struct ra_page {
         struct ra_page   *next;
         struct ra_page   *prev;
+        struct ra_page   *hash_next;
         struct ra_file   *file;
-        char              dirty;
+        char              dirty;        /* faulted in by read_ahead () */
         char              ready;
+        char              hit;          /* served a read */
         struct iovec     *vector;
         int32_t           count;
         off_t             offset;
@@ -87,16 +94,41 @@ struct ra_page {
 };
 
 
+/* reads on an fd are matched against a few streams, each following a
+ * fixed stride (sequential, reverse or strided). once a stream has
+ * matched RA_CONFIDENCE_MIN times in a row its prefetch window opens at
+ * one page and doubles per matching read, up to page-count pages.
+ */
+#define RA_STREAMS              4
+#define RA_CONFIDENCE_MIN       2
+#define RA_CONFIDENCE_MAX       8
+
+struct ra_stream {
+        off_t              last;        /* offset of the last read */
+        off_t              next;        /* where the last read ended */
+        off_t              stride;      /* between consecutive reads */
+        size_t             size;        /* of the last read */
+        off_t              lo;          /* range of pages held for the */
+        off_t              hi;          /* stream, reads and prefetch */
+        int32_t            confidence;
+        uint32_t           window;      /* pages to prefetch */
+        uint32_t           used;        /* tick of the last read, 0 = free */
+};
+
 struct ra_file {
         struct ra_file    *next;
         struct ra_file    *prev;
         struct ra_conf    *conf;
         fd_t              *fd;
         int                disabled;
-        size_t             expected;
         struct ra_page     pages;
-        off_t              offset;
-        size_t             size;
+        struct ra_page   **page_hash;
+        uint32_t           page_hash_mask;
+        struct ra_stream   streams[RA_STREAMS];
+        uint32_t           tick;
+        uint64_t           hits;        /* pages found cached or in transit */
+        uint64_t           misses;      /* pages faulted in by a read */
+        uint64_t           wasted;      /* prefetched, dropped unread */
         int32_t            refcount;
         pthread_mutex_t    file_lock;
         struct iatt        stbuf;
@@ -121,6 +153,10 @@ typedef struct ra_page ra_page_t;
 typedef struct ra_file ra_file_t;
 typedef struct ra_waitq ra_waitq_t;
 typedef struct ra_fill ra_fill_t;
+typedef struct ra_stream ra_stream_t;
+
+int
+ra_file_pages_init (ra_file_t *file);
 
 ra_page_t *
 ra_page_get (ra_file_t *file,
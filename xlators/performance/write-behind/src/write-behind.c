@@ -37,9 +37,11 @@
 #include "statedump.h"
 #include "write-behind-mem-types.h"
 
-#define MAX_VECTOR_COUNT  8
+#define WB_AGGREGATE_COUNT 32
 #define WB_AGGREGATE_SIZE 131072 /* 128 KB */
 #define WB_WINDOW_SIZE    1048576 /* 1MB */
+#define WB_TOTAL_WINDOW_SIZE 33554432 /* 32MB */
+#define WB_READ_EXTENTS   8
 
 typedef struct list_head list_head_t;
 struct wb_conf;
@@ -61,6 +63,8 @@ typedef struct wb_file {
         fd_t        *fd;
         gf_lock_t    lock;
         xlator_t    *this;
+        struct iatt  stbuf;    /* last seen from the backend */
+        char         stbuf_valid;
 }wb_file_t;
 
 typedef struct wb_request {
@@ -97,13 +101,23 @@ typedef struct wb_request {
 
 struct wb_conf {
         uint64_t     aggregate_size;
+        uint32_t     aggregate_count;    /* max vectors in a write */
         uint64_t     window_size;
+        uint64_t     total_window_size;  /* for all the files, 0 is
+                                          * unlimited */
+        uint64_t     window_used;        /* GF_ATOMIC_* */
+        uint32_t     window_files;       /* with window_current > 0 */
         uint64_t     disable_till;
         gf_boolean_t enable_O_SYNC;
         gf_boolean_t flush_behind;
         gf_boolean_t enable_trickling_writes;
 };
 
+typedef struct wb_extent {
+        size_t start;
+        size_t end;
+} wb_extent_t;
+
 typedef struct wb_local {
         list_head_t     winds;
         int32_t         flags;
@@ -114,6 +128,17 @@ typedef struct wb_local {
         int             op_errno;
         call_frame_t   *frame;
         int32_t         reply_count;
+
+        /* readv served from pending writes: data of the writes overlapping
+         * the read, the ranges of it they cover (sorted, relative to
+         * offset) and the end of the last pending write.
+         */
+        struct iobuf   *iobuf;
+        wb_extent_t     extents[WB_READ_EXTENTS];
+        int32_t         extent_count;
+        off_t           offset;
+        size_t          size;
+        off_t           eof;
 } wb_local_t;
 
 typedef struct wb_conf wb_conf_t;
@@ -129,6 +154,9 @@ ssize_t
 __wb_mark_winds (list_head_t *list, list_head_t *winds, size_t aggregate_size,
                  char enable_trickling_writes);
 
+static void
+__wb_budget_release (wb_file_t *file, size_t size);
+
 
 static int
 __wb_request_unref (wb_request_t *this)
@@ -217,10 +245,23 @@ out:
 }
 
 
+static void
+__wb_mark_flush_all (list_head_t *list)
+{
+        wb_request_t *request = NULL;
+
+        list_for_each_entry (request, list, list) {
+                if (request->stub && (request->stub->fop == GF_FOP_WRITE)) {
+                        request->flags.write_request.flush_all = 1;
+                }
+        }
+}
+
+
 wb_request_t *
 wb_enqueue (wb_file_t *file, call_stub_t *stub)
 {
-        wb_request_t *request = NULL, *tmp = NULL;
+        wb_request_t *request = NULL;
         call_frame_t *frame   = NULL;
         wb_local_t   *local   = NULL;
         struct iovec *vector  = NULL;
@@ -274,12 +315,7 @@ wb_enqueue (wb_file_t *file, call_stub_t *stub)
 
                         file->aggregate_current += request->write_size;
                 } else {
-                        list_for_each_entry (tmp, &file->request, list) {
-                                if (tmp->stub && tmp->stub->fop
-                                    == GF_FOP_WRITE) {
-                                        tmp->flags.write_request.flush_all = 1;
-                                }
-                        }
+                        __wb_mark_flush_all (&file->request);
 
                         /*reference for resuming */
                         __wb_request_ref (request);
@@ -389,6 +425,8 @@ wb_sync_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
 
                         if (request->flags.write_request.write_behind) {
                                 file->window_current -= request->write_size;
+                                __wb_budget_release (file,
+                                                     request->write_size);
                         }
 
                         __wb_request_unref (request);
@@ -397,6 +435,9 @@ wb_sync_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int32_t op_ret,
                 if (op_ret == -1) {
                         file->op_ret = op_ret;
                         file->op_errno = op_errno;
+                } else if (postbuf) {
+                        file->stbuf = *postbuf;
+                        file->stbuf_valid = 1;
                 }
                 fd = file->fd;
         }
@@ -468,8 +509,11 @@ wb_sync (call_frame_t *frame, wb_file_t *file, list_head_t *winds)
 
         list_for_each_entry_safe (request, dummy, winds, winds) {
                 if (!vector) {
-                        vector = GF_MALLOC (VECTORSIZE (MAX_VECTOR_COUNT),
+                        count = max (conf->aggregate_count,
+                                     request->stub->args.writev.count);
+                        vector = GF_MALLOC (VECTORSIZE (count),
                                             gf_wb_mt_iovec);
+                        count = 0;
                         if (vector == NULL) {
                                 bytes = -1;
                                 op_errno = ENOMEM;
@@ -522,7 +566,7 @@ wb_sync (call_frame_t *frame, wb_file_t *file, list_head_t *winds)
 
                 if ((!next)
                     || ((count + next->stub->args.writev.count)
-                        > MAX_VECTOR_COUNT)
+                        > conf->aggregate_count)
                     || ((current_size + next->write_size)
                         > conf->aggregate_size)) {
 
@@ -1539,7 +1583,7 @@ __wb_mark_wind_all (wb_file_t *file, list_head_t *list, list_head_t *winds)
                             && (((size + request->write_size)
                                  > conf->aggregate_size)
                                 || ((count + request->stub->args.writev.count)
-                                    > MAX_VECTOR_COUNT))) {
+                                    > conf->aggregate_count))) {
                                 break;
                         }
 
@@ -1662,6 +1706,65 @@ out:
 }
 
 
+/*
+ * charges @size bytes written behind on @file to the budget shared by all
+ * the files. once three quarters of it are used, files holding more than
+ * an even share of it have to wait for their writes to complete. with no
+ * budget configured the bytes are still counted, only never refused, so
+ * that releasing them stays balanced across a reconfigure.
+ */
+static int
+__wb_budget_reserve (wb_file_t *file, size_t size)
+{
+        wb_conf_t *conf  = NULL;
+        uint64_t   limit = 0;
+        uint64_t   used  = 0;
+        uint64_t   share = 0;
+
+        conf = file->this->private;
+        limit = conf->total_window_size;
+
+        do {
+                used = conf->window_used;
+                if (limit == 0) {
+                        continue;
+                }
+
+                if ((used + size) > limit) {
+                        return -1;
+                }
+
+                if (file->window_current
+                    && ((used + size) > (limit / 4 * 3))) {
+                        share = limit / max (conf->window_files, 1);
+                        if ((file->window_current + size) > share) {
+                                return -1;
+                        }
+                }
+        } while (!GF_ATOMIC_CAS (conf->window_used, used, used + size));
+
+        if (file->window_current == 0) {
+                GF_ATOMIC_INC (conf->window_files);
+        }
+
+        return 0;
+}
+
+
+static void
+__wb_budget_release (wb_file_t *file, size_t size)
+{
+        wb_conf_t *conf = NULL;
+
+        conf = file->this->private;
+        GF_ATOMIC_SUB (conf->window_used, size);
+
+        if (file->window_current == 0) {
+                GF_ATOMIC_DEC (conf->window_files);
+        }
+}
+
+
 size_t
 __wb_mark_unwind_till (list_head_t *list, list_head_t *unwinds, size_t size)
 {
@@ -1685,6 +1788,16 @@ __wb_mark_unwind_till (list_head_t *list, list_head_t *unwinds, size_t size)
 
                 if (written_behind <= size) {
                         if (!request->flags.write_request.write_behind) {
+                                if (!request->flags.write_request.got_reply
+                                    && (__wb_budget_reserve (file,
+                                                             request->write_size)
+                                        == -1)) {
+                                        /* out of budget, the writer waits
+                                         * for the writes to be synced */
+                                        __wb_mark_flush_all (list);
+                                        break;
+                                }
+
                                 written_behind += request->write_size;
                                 request->flags.write_request.write_behind = 1;
                                 list_add_tail (&request->unwinds, unwinds);
@@ -1886,54 +1999,68 @@ out:
 }
 
 
+/* appends the vectors of @request to @holder, taking references on its
+ * iobufs instead of copying the data.
+ */
 inline int
-__wb_copy_into_holder (wb_request_t *holder, wb_request_t *request)
+__wb_chain_into_holder (wb_request_t *holder, wb_request_t *request)
 {
-        char          *ptr    = NULL;
-        struct iobuf  *iobuf  = NULL;
+        struct iovec  *vector = NULL;
         struct iobref *iobref = NULL;
+        int            count  = 0;
         int            ret    = -1;
 
         if (holder->flags.write_request.virgin) {
-                iobuf = iobuf_get (request->file->this->ctx->iobuf_pool);
-                if (iobuf == NULL) {
-                        goto out;
-                }
-
+                /* the iobref of the holder is shared with its caller, it
+                 * needs its own one to merge others into */
                 iobref = iobref_new ();
                 if (iobref == NULL) {
-                        iobuf_unref (iobuf);
                         goto out;
                 }
 
-                ret = iobref_add (iobref, iobuf);
+                if (holder->stub->args.writev.iobref) {
+                        ret = iobref_merge (iobref,
+                                            holder->stub->args.writev.iobref);
+                        if (ret != 0) {
+                                iobref_unref (iobref);
+                                goto out;
+                        }
+
+                        iobref_unref (holder->stub->args.writev.iobref);
+                }
+
+                holder->stub->args.writev.iobref = iobref;
+                holder->flags.write_request.virgin = 0;
+        }
+
+        if (request->stub->args.writev.iobref) {
+                ret = iobref_merge (holder->stub->args.writev.iobref,
+                                    request->stub->args.writev.iobref);
                 if (ret != 0) {
-                        iobuf_unref (iobuf);
-                        iobref_unref (iobref);
                         gf_log (request->file->this->name, GF_LOG_WARNING,
-                                "cannot add iobuf (%p) into iobref (%p)",
-                                iobuf, iobref);
+                                "cannot merge iobref (%p) into iobref (%p)",
+                                request->stub->args.writev.iobref,
+                                holder->stub->args.writev.iobref);
                         goto out;
                 }
+        }
 
-                iov_unload (iobuf->ptr, holder->stub->args.writev.vector,
-                            holder->stub->args.writev.count);
-                holder->stub->args.writev.vector[0].iov_base = iobuf->ptr;
-
-                iobref_unref (holder->stub->args.writev.iobref);
-                holder->stub->args.writev.iobref = iobref;
-
-                iobuf_unref (iobuf);
+        count = holder->stub->args.writev.count
+                + request->stub->args.writev.count;
 
-                holder->flags.write_request.virgin = 0;
+        vector = GF_REALLOC (holder->stub->args.writev.vector,
+                             VECTORSIZE (count));
+        if (vector == NULL) {
+                ret = -1;
+                goto out;
         }
 
-        ptr = holder->stub->args.writev.vector[0].iov_base + holder->write_size;
-
-        iov_unload (ptr, request->stub->args.writev.vector,
-                    request->stub->args.writev.count);
+        memcpy (&vector[holder->stub->args.writev.count],
+                request->stub->args.writev.vector,
+                VECTORSIZE (request->stub->args.writev.count));
 
-        holder->stub->args.writev.vector[0].iov_len += request->write_size;
+        holder->stub->args.writev.vector = vector;
+        holder->stub->args.writev.count = count;
         holder->write_size += request->write_size;
 
         request->flags.write_request.stack_wound = 1;
@@ -1945,9 +2072,9 @@ out:
 }
 
 
-/* this procedure assumes that write requests have only one vector to write */
 void
-__wb_collapse_write_bufs (list_head_t *requests, size_t page_size)
+__wb_collapse_write_bufs (list_head_t *requests, size_t aggregate_size,
+                          uint32_t aggregate_count)
 {
         off_t         offset_expected = 0;
         size_t        space_left      = 0;
@@ -1978,10 +2105,21 @@ __wb_collapse_write_bufs (list_head_t *requests, size_t page_size)
                                 continue;
                         }
 
-                        space_left = page_size - holder->write_size;
+                        /* a holder written at or past aggregate-size
+                           takes nothing more */
+                        if (holder->write_size >= aggregate_size) {
+                                holder = request;
+                                continue;
+                        }
+
+                        space_left = aggregate_size - holder->write_size;
 
-                        if (space_left >= request->write_size) {
-                                ret = __wb_copy_into_holder (holder, request);
+                        if ((space_left >= request->write_size)
+                            && ((holder->stub->args.writev.count
+                                 + request->stub->args.writev.count)
+                                <= aggregate_count)) {
+                                ret = __wb_chain_into_holder (holder,
+                                                              request);
                                 if (ret != 0) {
                                         break;
                                 }
@@ -2025,14 +2163,16 @@ wb_process_queue (call_frame_t *frame, wb_file_t *file)
         {
                 /*
                  * make sure requests are marked for unwinding and adjacent
-                 * continguous write buffers (each of size less than that of
-                 * an iobuf) are packed properly so that iobufs are filled to
-                 * their maximum capacity, before calling __wb_mark_winds.
+                 * continguous write buffers (each of size less than
+                 * aggregate-size) are chained together, so that writes
+                 * reach the server as large as aggregate-size allows,
+                 * before calling __wb_mark_winds.
                  */
                 __wb_mark_unwinds (&file->request, &unwinds);
 
                 __wb_collapse_write_bufs (&file->request,
-                                          file->this->ctx->page_size);
+                                          conf->aggregate_size,
+                                          conf->aggregate_count);
 
                 count = __wb_get_other_requests (&file->request,
                                                  &other_requests);
@@ -2246,6 +2386,293 @@ wb_readv_helper (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
 }
 
 
+/* copies @len bytes from @vector, skipping the first @skip */
+static void
+wb_iov_copy (char *buf, struct iovec *vector, int count, size_t skip,
+             size_t len)
+{
+        size_t copy = 0;
+        int    i    = 0;
+
+        for (i = 0; (i < count) && (len > 0); i++) {
+                if (skip >= vector[i].iov_len) {
+                        skip -= vector[i].iov_len;
+                        continue;
+                }
+
+                copy = min (vector[i].iov_len - skip, len);
+                memcpy (buf, vector[i].iov_base + skip, copy);
+
+                buf += copy;
+                len -= copy;
+                skip = 0;
+        }
+}
+
+
+static int
+wb_extent_add (wb_local_t *local, size_t start, size_t end)
+{
+        wb_extent_t *extents = local->extents;
+        int          i       = 0, j = 0;
+
+        for (i = 0; i < local->extent_count; i++) {
+                if (start <= extents[i].end) {
+                        break;
+                }
+        }
+
+        for (j = i; (j < local->extent_count) && (extents[j].start <= end);
+             j++) {
+                start = min (start, extents[j].start);
+                end = max (end, extents[j].end);
+        }
+
+        if (i == j) {
+                if (local->extent_count == WB_READ_EXTENTS) {
+                        return -1;
+                }
+
+                memmove (&extents[i + 1], &extents[i],
+                         (local->extent_count - i) * sizeof (*extents));
+                local->extent_count++;
+        } else if ((j - i) > 1) {
+                memmove (&extents[i + 1], &extents[j],
+                         (local->extent_count - j) * sizeof (*extents));
+                local->extent_count -= (j - i - 1);
+        }
+
+        extents[i].start = start;
+        extents[i].end = end;
+
+        return 0;
+}
+
+
+/*
+ * copies the data of the queued writes overlapping the read described by
+ * @local into local->iobuf, oldest first so that later writes win. fails
+ * if anything but writes is queued, as those have to be ordered with the
+ * read.
+ */
+static int
+__wb_read_pending (wb_file_t *file, wb_local_t *local)
+{
+        wb_request_t *request = NULL;
+        off_t         start   = 0, end = 0, from = 0, to = 0;
+        off_t         read_end = 0;
+
+        if (file->flags & O_APPEND) {
+                return -1;
+        }
+
+        read_end = local->offset + local->size;
+
+        list_for_each_entry (request, &file->request, list) {
+                if ((request->stub == NULL)
+                    || (request->stub->fop != GF_FOP_WRITE)) {
+                        return -1;
+                }
+
+                start = request->stub->args.writev.off;
+                end = start + request->write_size;
+
+                if (end > local->eof) {
+                        local->eof = end;
+                }
+
+                if ((end <= local->offset) || (start >= read_end)) {
+                        continue;
+                }
+
+                if (local->iobuf == NULL) {
+                        local->iobuf = iobuf_get2 (file->this->ctx->iobuf_pool,
+                                                   local->size);
+                        if (local->iobuf == NULL) {
+                                return -1;
+                        }
+                }
+
+                from = max (start, local->offset);
+                to = min (end, read_end);
+
+                wb_iov_copy (local->iobuf->ptr + (from - local->offset),
+                             request->stub->args.writev.vector,
+                             request->stub->args.writev.count, from - start,
+                             to - from);
+
+                if (wb_extent_add (local, from - local->offset,
+                                   to - local->offset) == -1) {
+                        return -1;
+                }
+        }
+
+        return 0;
+}
+
+
+static void
+wb_readv_unwind_pending (call_frame_t *frame, size_t size, struct iatt *stbuf)
+{
+        wb_local_t    *local  = NULL;
+        struct iobref *iobref = NULL;
+        struct iobuf  *iobuf  = NULL;
+        struct iovec   vector = {0, };
+
+        local = frame->local;
+        iobuf = local->iobuf;
+        local->iobuf = NULL;
+
+        iobref = iobref_new ();
+        if ((iobref == NULL) || iobref_add (iobref, iobuf)) {
+                STACK_UNWIND_STRICT (readv, frame, -1, ENOMEM, NULL, 0, NULL,
+                                     NULL);
+                goto out;
+        }
+
+        vector.iov_base = iobuf->ptr;
+        vector.iov_len = size;
+
+        STACK_UNWIND_STRICT (readv, frame, size, 0, &vector, 1, stbuf, iobref);
+
+out:
+        if (iobref) {
+                iobref_unref (iobref);
+        }
+
+        iobuf_unref (iobuf);
+}
+
+
+/* fills the parts of the read not covered by pending writes with what the
+ * backend returned, or zeroes past its eof up to the end of the writes.
+ */
+int32_t
+wb_readv_merge_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                    int32_t op_ret, int32_t op_errno, struct iovec *vector,
+                    int32_t count, struct iatt *stbuf, struct iobref *iobref)
+{
+        wb_local_t  *local = NULL;
+        wb_file_t   *file  = NULL;
+        struct iatt  buf   = {0, };
+        size_t       size  = 0, pos = 0, gap = 0, copy = 0;
+        int          i     = 0;
+
+        local = frame->local;
+        file = local->file;
+
+        if (op_ret == -1) {
+                iobuf_unref (local->iobuf);
+                local->iobuf = NULL;
+
+                STACK_UNWIND_STRICT (readv, frame, op_ret, op_errno, vector,
+                                     count, stbuf, iobref);
+                return 0;
+        }
+
+        size = op_ret;
+        if ((local->eof - local->offset) > size) {
+                size = min (local->size, local->eof - local->offset);
+        }
+
+        for (i = 0; i <= local->extent_count; i++) {
+                gap = (i < local->extent_count) ? local->extents[i].start
+                        : size;
+                gap = min (gap, size);
+
+                if (gap > pos) {
+                        copy = (op_ret > pos) ? min (op_ret - pos, gap - pos)
+                                : 0;
+
+                        wb_iov_copy (local->iobuf->ptr + pos, vector, count,
+                                     pos, copy);
+                        memset (local->iobuf->ptr + pos + copy, 0,
+                                gap - pos - copy);
+                }
+
+                if (i < local->extent_count) {
+                        pos = local->extents[i].end;
+                }
+        }
+
+        if (stbuf) {
+                buf = *stbuf;
+                if (buf.ia_size < local->eof) {
+                        buf.ia_size = local->eof;
+                }
+
+                LOCK (&file->lock);
+                {
+                        file->stbuf = *stbuf;
+                        file->stbuf_valid = 1;
+                }
+                UNLOCK (&file->lock);
+        }
+
+        wb_readv_unwind_pending (frame, size, &buf);
+
+        return 0;
+}
+
+
+/*
+ * serves the read from the queued writes it overlaps: from memory when they
+ * cover it entirely and the attributes of the file are known, else merged
+ * with a read from the backend wound without waiting for the writes.
+ * returns -1 when the read has to be queued.
+ */
+static int
+wb_readv_pending (call_frame_t *frame, xlator_t *this, wb_file_t *file,
+                  fd_t *fd, size_t size, off_t offset)
+{
+        wb_local_t  *local = NULL;
+        struct iatt  buf   = {0, };
+        int          ret   = -1;
+        char         valid = 0;
+
+        local = frame->local;
+        local->offset = offset;
+        local->size = size;
+
+        LOCK (&file->lock);
+        {
+                ret = __wb_read_pending (file, local);
+                buf = file->stbuf;
+                valid = file->stbuf_valid;
+        }
+        UNLOCK (&file->lock);
+
+        if ((ret == -1) || (local->iobuf == NULL)) {
+                if (local->iobuf) {
+                        iobuf_unref (local->iobuf);
+                        local->iobuf = NULL;
+                }
+
+                local->extent_count = 0;
+                local->eof = 0;
+                return -1;
+        }
+
+        /* answering from memory needs attributes from the backend to
+           return along, else the backend is read for them */
+        if (valid && (local->extent_count == 1)
+            && (local->extents[0].start == 0)
+            && (local->extents[0].end == size)) {
+                if (buf.ia_size < local->eof) {
+                        buf.ia_size = local->eof;
+                }
+
+                wb_readv_unwind_pending (frame, size, &buf);
+                return 0;
+        }
+
+        STACK_WIND (frame, wb_readv_merge_cbk, FIRST_CHILD(this),
+                    FIRST_CHILD(this)->fops->readv, fd, size, offset);
+
+        return 0;
+}
+
+
 int32_t
 wb_readv (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
           off_t offset)
@@ -2285,6 +2712,11 @@ wb_readv (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
 
         frame->local = local;
         if (file) {
+                if (wb_readv_pending (frame, this, file, fd, size,
+                                      offset) == 0) {
+                        return 0;
+                }
+
                 stub = fop_readv_stub (frame, wb_readv_helper, fd, size,
                                        offset);
                 if (stub == NULL) {
@@ -2694,8 +3126,16 @@ wb_priv_dump (xlator_t *this)
 
         gf_proc_dump_build_key (key, key_prefix, "aggregate_size");
         gf_proc_dump_write (key, "%d", conf->aggregate_size);
+        gf_proc_dump_build_key (key, key_prefix, "aggregate_count");
+        gf_proc_dump_write (key, "%u", conf->aggregate_count);
         gf_proc_dump_build_key (key, key_prefix, "window_size");
         gf_proc_dump_write (key, "%d", conf->window_size);
+        gf_proc_dump_build_key (key, key_prefix, "total_window_size");
+        gf_proc_dump_write (key, "%"PRIu64, conf->total_window_size);
+        gf_proc_dump_build_key (key, key_prefix, "window_used");
+        gf_proc_dump_write (key, "%"PRIu64, conf->window_used);
+        gf_proc_dump_build_key (key, key_prefix, "window_files");
+        gf_proc_dump_write (key, "%u", conf->window_files);
         gf_proc_dump_build_key (key, key_prefix, "disable_till");
         gf_proc_dump_write (key, "%d", conf->disable_till);
         gf_proc_dump_build_key (key, key_prefix, "enable_O_SYNC");
@@ -2946,6 +3386,22 @@ reconfigure (xlator_t *this, dict_t *options)
                 conf->window_size = WB_WINDOW_SIZE;
         }
 
+        ret = dict_get_str (options, "total-cache-size", &str);
+        if (ret == 0) {
+                ret = gf_string2bytesize (str, &window_size);
+                if (ret != 0) {
+                        gf_log (this->name, GF_LOG_ERROR, "Reconfiguration "
+                                "'option total-cache-size %s' failed, "
+                                "invalid number format, defaulting to old "
+                                "value (%"PRIu64")", str,
+                                conf->total_window_size);
+                } else {
+                        conf->total_window_size = window_size;
+                }
+        } else {
+                conf->total_window_size = WB_TOTAL_WINDOW_SIZE;
+        }
+
         ret = dict_get_str (options, "flush-behind", &str);
         if (ret == 0) {
                 ret = gf_string2boolean (str, &conf->flush_behind);
@@ -3011,6 +3467,32 @@ init (xlator_t *this)
 
         /* configure 'options aggregate-size <size>' */
         conf->aggregate_size = WB_AGGREGATE_SIZE;
+        ret = dict_get_str (options, "aggregate-size", &str);
+        if (ret == 0) {
+                ret = gf_string2bytesize (str, &conf->aggregate_size);
+                if (ret != 0) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid number format \"%s\" of \"option "
+                                "aggregate-size\"", str);
+                        GF_FREE (conf);
+                        goto out;
+                }
+        }
+
+        /* configure 'options aggregate-count <count>' */
+        conf->aggregate_count = WB_AGGREGATE_COUNT;
+        ret = dict_get_str (options, "aggregate-count", &str);
+        if (ret == 0) {
+                ret = gf_string2uint32 (str, &conf->aggregate_count);
+                if ((ret != 0) || (conf->aggregate_count == 0)) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid value \"%s\" of \"option "
+                                "aggregate-count\"", str);
+                        GF_FREE (conf);
+                        goto out;
+                }
+        }
+
         conf->disable_till = 0;
         ret = dict_get_str (options, "disable-for-first-nbytes", &str);
         if (ret == 0) {
@@ -3042,6 +3524,20 @@ init (xlator_t *this)
                 }
         }
 
+        /* configure 'option total-cache-size <size>' */
+        conf->total_window_size = WB_TOTAL_WINDOW_SIZE;
+        ret = dict_get_str (options, "total-cache-size", &str);
+        if (ret == 0) {
+                ret = gf_string2bytesize (str, &conf->total_window_size);
+                if (ret != 0) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid number format \"%s\" of \"option "
+                                "total-cache-size\"", str);
+                        GF_FREE (conf);
+                        goto out;
+                }
+        }
+
         if (!conf->window_size && conf->aggregate_size) {
                 gf_log (this->name, GF_LOG_WARNING,
                         "setting window-size to be equal to "
@@ -3159,5 +3655,20 @@ struct volume_options options[] = {
         { .key = {"enable-trickling-writes"},
           .type = GF_OPTION_TYPE_BOOL,
         },
+        { .key  = {"total-cache-size", "total-window-size"},
+          .type = GF_OPTION_TYPE_SIZET,
+          .min  = 0,
+          .max  = 16 * GF_UNIT_GB
+        },
+        { .key  = {"aggregate-size"},
+          .type = GF_OPTION_TYPE_SIZET,
+          .min  = 4 * GF_UNIT_KB,
+          .max  = 1 * GF_UNIT_MB
+        },
+        { .key  = {"aggregate-count"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 1,
+          .max  = 1024
+        },
         { .key = {NULL} },
 };
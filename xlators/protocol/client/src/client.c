@@ -2365,6 +2365,14 @@ client_priv_dump (xlator_t *this)
                 gf_proc_dump_build_key(key, key_prefix, "total_bytes_written");
                 gf_proc_dump_write(key, "%"PRIu64,
                                    conf->rpc->conn.trans->total_bytes_write);
+
+                gf_proc_dump_build_key(key, key_prefix, "total_write_calls");
+                gf_proc_dump_write(key, "%"PRIu64,
+                                   conf->rpc->conn.trans->total_write_calls);
+
+                gf_proc_dump_build_key(key, key_prefix, "total_msgs_sent");
+                gf_proc_dump_write(key, "%"PRIu64,
+                                   conf->rpc->conn.trans->total_msgs_sent);
         }
         pthread_mutex_unlock(&conf->lock);
 
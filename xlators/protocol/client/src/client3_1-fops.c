@@ -2153,8 +2153,9 @@ client3_1_lookup_cbk (struct rpc_req *req, struct iovec *iov, int count,
         int              op_errno   = EINVAL;
         dict_t          *xattr      = NULL;
         inode_t         *inode      = NULL;
-        char            *buf        = NULL;
         xlator_t         *this       = NULL;
+        struct iovec     payload    = {0, };
+        char            *dictbuf    = NULL;
 
         this = THIS;
 
@@ -2169,7 +2170,7 @@ client3_1_lookup_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_lookup_rsp (*iov, &rsp);
+        ret = xdr_to_lookup_rsp (*iov, &rsp, &payload);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "error");
                 rsp.op_ret   = -1;
@@ -2190,10 +2191,13 @@ client3_1_lookup_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 xattr = dict_new();
                 GF_VALIDATE_OR_GOTO (frame->this->name, xattr, out);
 
-                buf = memdup (rsp.dict.dict_val, rsp.dict.dict_len);
-                GF_VALIDATE_OR_GOTO (frame->this->name, buf, out);
-
-                ret = dict_unserialize (buf, rsp.dict.dict_len, &xattr);
+                /* the values keep pointing into the buffer the XDR
+                   decoder allocated, saving a copy of large xattrs
+                   (quick-read content) */
+                ret = dict_unserialize_nocopy (rsp.dict.dict_val,
+                                               rsp.dict.dict_len, &xattr,
+                                               _gf_true);
+                rsp.dict.dict_val = NULL;
                 if (ret < 0) {
                         gf_log (frame->this->name, GF_LOG_WARNING,
                                 "%s (%"PRId64"): failed to "
@@ -2202,9 +2206,29 @@ client3_1_lookup_cbk (struct rpc_req *req, struct iovec *iov, int count,
                         op_errno = EINVAL;
                         goto out;
                 }
+        } else if (payload.iov_len > 0) {
+                xattr = dict_new();
+                GF_VALIDATE_OR_GOTO (frame->this->name, xattr, out);
+
+                /* the dict follows the reply. it is copied out once,
+                   rather than pinning the whole reply iobuf from caches
+                   holding on to its values */
+                dictbuf = memdup (payload.iov_base, payload.iov_len);
+                if (!dictbuf) {
+                        op_errno = ENOMEM;
+                        goto out;
+                }
 
-                xattr->extra_free = buf;
-                buf = NULL;
+                ret = dict_unserialize_nocopy (dictbuf, payload.iov_len,
+                                               &xattr, _gf_false);
+                if (ret < 0) {
+                        gf_log (frame->this->name, GF_LOG_WARNING,
+                                "%s (%"PRId64"): failed to "
+                                "unserialize dictionary",
+                                local->loc.path, inode->ino);
+                        op_errno = EINVAL;
+                        goto out;
+                }
         }
 
         if ((!uuid_is_null (inode->gfid))
@@ -2245,10 +2269,6 @@ out:
                 rsp.dict.dict_val = NULL;
         }
 
-        if (buf) {
-                GF_FREE (buf);
-        }
-
         return 0;
 }
 
@@ -2560,7 +2580,7 @@ client3_1_lookup (call_frame_t *frame, xlator_t *this,
                         rsphdr = &vector[0];
                         rsphdr->iov_base = iobuf_ptr (rsp_iobuf);
                         rsphdr->iov_len
-                                = rsp_iobuf->iobuf_arena->iobuf_pool->page_size;
+                                = iobuf_pagesize (rsp_iobuf);
                         count = 1;
                         rsp_iobuf = NULL;
                         local->iobref = rsp_iobref;
@@ -3506,7 +3526,7 @@ client3_1_readv (call_frame_t *frame, xlator_t *this,
         req.offset = args->offset;
         req.fd     = fdctx->remote_fd;
 
-        rsp_iobuf = iobuf_get (this->ctx->iobuf_pool);
+        rsp_iobuf = iobuf_get2 (this->ctx->iobuf_pool, args->size);
         if (rsp_iobuf == NULL) {
                 op_errno = ENOMEM;
                 goto unwind;
@@ -3521,7 +3541,7 @@ client3_1_readv (call_frame_t *frame, xlator_t *this,
         iobref_add (rsp_iobref, rsp_iobuf);
         iobuf_unref (rsp_iobuf);
         rsp_vec.iov_base = iobuf_ptr (rsp_iobuf);
-        rsp_vec.iov_len = rsp_iobuf->iobuf_arena->iobuf_pool->page_size;
+        rsp_vec.iov_len = iobuf_pagesize (rsp_iobuf);
 
         rsp_iobuf = NULL;
 
@@ -4189,7 +4209,7 @@ client3_1_fgetxattr (call_frame_t *frame, xlator_t *this,
         iobuf_unref (rsp_iobuf);
         rsphdr = &vector[0];
         rsphdr->iov_base = iobuf_ptr (rsp_iobuf);
-        rsphdr->iov_len = rsp_iobuf->iobuf_arena->iobuf_pool->page_size;
+        rsphdr->iov_len = iobuf_pagesize (rsp_iobuf);
         count = 1;
         rsp_iobuf = NULL;
         local->iobref = rsp_iobref;
@@ -4294,7 +4314,7 @@ client3_1_getxattr (call_frame_t *frame, xlator_t *this,
         iobuf_unref (rsp_iobuf);
         rsphdr = &vector[0];
         rsphdr->iov_base = iobuf_ptr (rsp_iobuf);
-        rsphdr->iov_len = rsp_iobuf->iobuf_arena->iobuf_pool->page_size;
+        rsphdr->iov_len = iobuf_pagesize (rsp_iobuf);
         count = 1;
         rsp_iobuf = NULL;
         local->iobref = rsp_iobref;
@@ -4416,7 +4436,7 @@ client3_1_xattrop (call_frame_t *frame, xlator_t *this,
         iobuf_unref (rsp_iobuf);
         rsphdr = &vector[0];
         rsphdr->iov_base = iobuf_ptr (rsp_iobuf);
-        rsphdr->iov_len = rsp_iobuf->iobuf_arena->iobuf_pool->page_size;
+        rsphdr->iov_len = iobuf_pagesize (rsp_iobuf);
         count = 1;
         rsp_iobuf = NULL;
         local->iobref = rsp_iobref;
@@ -4557,7 +4577,7 @@ client3_1_fxattrop (call_frame_t *frame, xlator_t *this,
         iobuf_unref (rsp_iobuf);
         rsphdr = &vector[0];
         rsphdr->iov_base = iobuf_ptr (rsp_iobuf);
-        rsphdr->iov_len = rsp_iobuf->iobuf_arena->iobuf_pool->page_size;
+        rsphdr->iov_len = iobuf_pagesize (rsp_iobuf);
         count = 1;
         rsp_iobuf = NULL;
         local->iobref = rsp_iobref;
@@ -5173,7 +5193,7 @@ client3_1_readdir (call_frame_t *frame, xlator_t *this,
                 rsphdr = &vector[0];
                 rsphdr->iov_base = iobuf_ptr (rsp_iobuf);
                 rsphdr->iov_len
-                        = rsp_iobuf->iobuf_arena->iobuf_pool->page_size;
+                        = iobuf_pagesize (rsp_iobuf);
                 count = 1;
                 rsp_iobuf = NULL;
                 local->iobref = rsp_iobref;
@@ -5291,7 +5311,7 @@ client3_1_readdirp (call_frame_t *frame, xlator_t *this,
                 rsphdr = &vector[0];
                 rsphdr->iov_base = iobuf_ptr (rsp_iobuf);
                 rsphdr->iov_len
-                        = rsp_iobuf->iobuf_arena->iobuf_pool->page_size;
+                        = iobuf_pagesize (rsp_iobuf);
                 count = 1;
                 rsp_iobuf = NULL;
                 local->iobref = rsp_iobref;
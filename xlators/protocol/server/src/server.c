@@ -236,6 +236,8 @@ server_priv (xlator_t *this)
         char              key[GF_DUMP_MAX_BUF_LEN] = {0,};
         uint64_t          total_read = 0;
         uint64_t          total_write = 0;
+        uint64_t          total_calls = 0;
+        uint64_t          total_msgs  = 0;
         int32_t           ret  = -1;
 
         GF_VALIDATE_OR_GOTO ("server", this, out);
@@ -247,6 +249,8 @@ server_priv (xlator_t *this)
         list_for_each_entry (xprt, &conf->xprt_list, list) {
                 total_read  += xprt->total_bytes_read;
                 total_write += xprt->total_bytes_write;
+                total_calls += xprt->total_write_calls;
+                total_msgs  += xprt->total_msgs_sent;
         }
 
         gf_proc_dump_build_key(key, "server", "total-bytes-read");
@@ -255,6 +259,12 @@ server_priv (xlator_t *this)
         gf_proc_dump_build_key(key, "server", "total-bytes-write");
         gf_proc_dump_write(key, "%"PRIu64, total_write);
 
+        gf_proc_dump_build_key(key, "server", "total-write-calls");
+        gf_proc_dump_write(key, "%"PRIu64, total_calls);
+
+        gf_proc_dump_build_key(key, "server", "total-msgs-sent");
+        gf_proc_dump_write(key, "%"PRIu64, total_msgs);
+
         ret = 0;
 out:
         return ret;
@@ -32,6 +32,9 @@
 #define DEFAULT_BLOCK_SIZE         4194304   /* 4MB */
 #define DEFAULT_VOLUME_FILE_PATH   CONFDIR "/glusterfs.vol"
 
+/* payload vectors a reply dict is sent in, within what the transport takes */
+#define SERVER_DICT_IOV_COUNT      8
+
 typedef struct _server_state server_state_t;
 
 struct _locker {
@@ -73,6 +73,9 @@ server_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         gfs3_lookup_rsp   rsp        = {0,};
         int32_t           ret        = -1;
         uuid_t            rootgfid   = {0,};
+        struct iovec      dictvec[SERVER_DICT_IOV_COUNT];
+        int               dictcount  = 0;
+        struct iobref    *iobref     = NULL;
 
         state = CALL_STATE(frame);
 
@@ -93,34 +96,25 @@ server_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         }
 
         if ((op_ret >= 0) && dict) {
-                rsp.dict.dict_len = dict_serialized_length (dict);
-                if (rsp.dict.dict_len < 0) {
-                        gf_log (this->name, GF_LOG_ERROR,
-                                "%s (%"PRId64"): failed to get serialized "
-                                "length of reply dict",
-                                state->loc.path, state->loc.inode->ino);
-                        op_ret   = -1;
-                        op_errno = EINVAL;
-                        rsp.dict.dict_len = 0;
-                        goto out;
-                }
-
-                rsp.dict.dict_val = GF_CALLOC (1, rsp.dict.dict_len,
-                                               gf_server_mt_rsp_buf_t);
-                if (!rsp.dict.dict_val) {
+                /* the dict follows the reply as payload, so that values
+                   like file content go out from where they were read */
+                iobref = iobref_new ();
+                if (!iobref) {
                         op_ret = -1;
                         op_errno = ENOMEM;
-                        rsp.dict.dict_len = 0;
                         goto out;
                 }
-                ret = dict_serialize (dict, rsp.dict.dict_val);
+
+                dictcount = SERVER_DICT_IOV_COUNT;
+                ret = dict_serialize_iov (dict, this->ctx->iobuf_pool,
+                                          dictvec, &dictcount, iobref);
                 if (ret < 0) {
                         gf_log (this->name, GF_LOG_ERROR,
                                 "%s (%"PRId64"): failed to serialize reply dict",
                                 state->loc.path, state->loc.inode->ino);
                         op_ret = -1;
                         op_errno = -ret;
-                        rsp.dict.dict_len = 0;
+                        dictcount = 0;
                         goto out;
                 }
         }
@@ -168,11 +162,11 @@ out:
                         op_ret, strerror (op_errno));
         }
 
-        server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
+        server_submit_reply (frame, req, &rsp, dictvec, dictcount, iobref,
                              (gfs_serialize_t)xdr_serialize_lookup_rsp);
 
-        if (rsp.dict.dict_val)
-                GF_FREE (rsp.dict.dict_val);
+        if (iobref)
+                iobref_unref (iobref);
 
         return 0;
 }
@@ -5059,8 +5053,9 @@ server_lookup (rpcsvc_request_t *req)
                         goto out;
                 }
 
-                ret = dict_unserialize (buf, args.dict.dict_len,
-                                        &xattr_req);
+                ret = dict_unserialize_nocopy (buf, args.dict.dict_len,
+                                               &xattr_req, _gf_false);
+                buf = NULL;
                 if (ret < 0) {
                         gf_log (conn->bound_xl->name, GF_LOG_ERROR,
                                 "%"PRId64": %s (%"PRId64"): failed to "
@@ -5071,10 +5066,6 @@ server_lookup (rpcsvc_request_t *req)
                 }
 
                 state->dict = xattr_req;
-
-                xattr_req->extra_free = buf;
-
-                buf = NULL;
         }
 
         ret = 0;
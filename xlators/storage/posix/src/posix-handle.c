@@ -0,0 +1,455 @@
+/*
+  Copyright (c) 2010 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <libgen.h>
+#include <sys/stat.h>
+
+#ifndef GF_BSD_HOST_OS
+#include <alloca.h>
+#endif /* GF_BSD_HOST_OS */
+
+#include "glusterfs.h"
+#include "logging.h"
+#include "common-utils.h"
+#include "syscall.h"
+#include "posix.h"
+#include "posix-handle.h"
+
+/* bounds the symlink chain followed when resolving a directory handle */
+#define POSIX_HANDLE_MAX_DEPTH 4096
+
+/* "../../xx/yy/" */
+#define POSIX_HANDLE_REL_PFX_LEN 12
+
+
+static int
+posix_handle_is_root (uuid_t gfid)
+{
+        uuid_t root = {0, };
+
+        root[15] = 1;
+
+        return (uuid_compare (gfid, root) == 0);
+}
+
+
+int
+posix_handle_path (xlator_t *this, uuid_t gfid, char *buf, size_t len)
+{
+        char uuid_str[37] = {0, };
+        int  ret          = 0;
+
+        uuid_unparse (gfid, uuid_str);
+
+        ret = snprintf (buf, len, "%s/%s/%02x/%02x/%s",
+                        POSIX_BASE_PATH (this), GF_HIDDEN_PATH,
+                        gfid[0], gfid[1], uuid_str);
+        if (ret < 0 || ret >= len) {
+                errno = ENAMETOOLONG;
+                return -1;
+        }
+
+        return ret;
+}
+
+
+int
+posix_handle_init (xlator_t *this)
+{
+        char *path = NULL;
+        int   ret  = 0;
+
+        path = alloca (POSIX_BASE_PATH_LEN (this) + sizeof (GF_HIDDEN_PATH)
+                       + 2);
+        sprintf (path, "%s/%s", POSIX_BASE_PATH (this), GF_HIDDEN_PATH);
+
+        ret = mkdir (path, 0700);
+        if (ret == -1 && errno != EEXIST) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "creating handle directory %s failed: %s",
+                        path, strerror (errno));
+                return -1;
+        }
+
+        return 0;
+}
+
+
+/* create the two hash levels a handle of @gfid lives under */
+static int
+posix_handle_mkdirs (xlator_t *this, uuid_t gfid)
+{
+        char *dir = NULL;
+        int   ret = 0;
+
+        dir = alloca (POSIX_BASE_PATH_LEN (this) + sizeof (GF_HIDDEN_PATH)
+                      + 8);
+        sprintf (dir, "%s/%s/%02x", POSIX_BASE_PATH (this), GF_HIDDEN_PATH,
+                 gfid[0]);
+
+        ret = mkdir (dir, 0700);
+        if (ret == -1 && errno != EEXIST)
+                return -1;
+
+        sprintf (dir + strlen (dir), "/%02x", gfid[1]);
+
+        ret = mkdir (dir, 0700);
+        if (ret == -1 && errno != EEXIST)
+                return -1;
+
+        return 0;
+}
+
+
+/* Resolve the symlink chain of a directory handle into the real path of
+   the directory, one readlink per ancestor */
+static int
+posix_handle_resolve_dir (xlator_t *this, uuid_t gfid, char *buf, size_t len)
+{
+        char    *handle = NULL;
+        char    *link   = NULL;
+        char    *name   = NULL;
+        char    *tail   = NULL;
+        uuid_t   cur    = {0, };
+        ssize_t  size   = 0;
+        size_t   nlen   = 0;
+        int      depth  = 0;
+
+        handle = alloca (POSIX_HANDLE_PATH_LEN (this));
+        link   = alloca (PATH_MAX);
+
+        /* components are prepended right to left */
+        tail  = buf + len - 1;
+        *tail = '\0';
+
+        uuid_copy (cur, gfid);
+
+        while (!posix_handle_is_root (cur)) {
+                if (++depth > POSIX_HANDLE_MAX_DEPTH) {
+                        errno = ELOOP;
+                        return -1;
+                }
+
+                posix_handle_path (this, cur, handle,
+                                   POSIX_HANDLE_PATH_LEN (this));
+
+                size = readlink (handle, link, PATH_MAX - 1);
+                if (size == -1)
+                        return -1;
+                link[size] = '\0';
+
+                /* ../../xx/yy/<pargfid>/<name> */
+                if (size <= POSIX_HANDLE_REL_PFX_LEN + 37
+                    || strncmp (link, "../../", 6)
+                    || link[POSIX_HANDLE_REL_PFX_LEN + 36] != '/') {
+                        errno = EINVAL;
+                        return -1;
+                }
+
+                link[POSIX_HANDLE_REL_PFX_LEN + 36] = '\0';
+                if (uuid_parse (link + POSIX_HANDLE_REL_PFX_LEN, cur)) {
+                        errno = EINVAL;
+                        return -1;
+                }
+
+                name = link + POSIX_HANDLE_REL_PFX_LEN + 37;
+                nlen = strlen (name);
+                if (tail - buf < nlen + 1 + POSIX_BASE_PATH_LEN (this)) {
+                        errno = ENAMETOOLONG;
+                        return -1;
+                }
+
+                tail -= nlen;
+                memcpy (tail, name, nlen);
+                *(--tail) = '/';
+        }
+
+        if (!*tail) {
+                strcpy (buf, POSIX_BASE_PATH (this));
+                return 0;
+        }
+
+        nlen = POSIX_BASE_PATH_LEN (this);
+        memmove (buf + nlen, tail, strlen (tail) + 1);
+        memcpy (buf, POSIX_BASE_PATH (this), nlen);
+
+        return 0;
+}
+
+
+/* Path by which the object with @gfid can be reached on the export: the
+   handle itself for non-directories, the real path for directories */
+int
+posix_handle_real_path (xlator_t *this, uuid_t gfid, char *buf, size_t len)
+{
+        struct stat stbuf  = {0, };
+        uuid_t      linked = {0, };
+        int         ret    = -1;
+
+        if (uuid_is_null (gfid)) {
+                errno = EINVAL;
+                return -1;
+        }
+
+        if (posix_handle_is_root (gfid)) {
+                if (len <= POSIX_BASE_PATH_LEN (this)) {
+                        errno = ENAMETOOLONG;
+                        return -1;
+                }
+                strcpy (buf, POSIX_BASE_PATH (this));
+                return 0;
+        }
+
+        ret = posix_handle_path (this, gfid, buf, len);
+        if (ret == -1)
+                return -1;
+
+        ret = lstat (buf, &stbuf);
+        if (ret == -1)
+                return -1;
+
+        /* a hardlinked symlink carries the gfid itself, a directory
+           handle does not */
+        if (!S_ISLNK (stbuf.st_mode)
+            || (sys_lgetxattr (buf, GFID_XATTR_KEY, linked, 16) == 16
+                && uuid_compare (linked, gfid) == 0))
+                return 0;
+
+        return posix_handle_resolve_dir (this, gfid, buf, len);
+}
+
+
+int
+posix_handle_loc_path (xlator_t *this, loc_t *loc, char *buf, size_t len)
+{
+        unsigned char *gfid = NULL;
+        int            ret  = -1;
+
+        gfid = loc->gfid;
+        if (uuid_is_null (gfid) && loc->inode)
+                gfid = loc->inode->gfid;
+
+        ret = posix_handle_real_path (this, gfid, buf, len);
+        if (ret == -1) {
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "resolving handle of %s failed: %s",
+                        uuid_utoa (gfid), strerror (errno));
+                buf[0] = '\0';
+        }
+
+        return ret;
+}
+
+
+static int
+posix_handle_symlink (xlator_t *this, const char *real_path, char *handle)
+{
+        char    *pathdup    = NULL;
+        char    *parentpath = NULL;
+        char    *target     = NULL;
+        char    *old        = NULL;
+        uuid_t   pargfid    = {0, };
+        char     uuid_str[37] = {0, };
+        ssize_t  size       = 0;
+        int      ret        = -1;
+
+        pathdup = gf_strdup (real_path);
+        if (!pathdup)
+                return -1;
+
+        parentpath = dirname (pathdup);
+
+        if (!strcmp (parentpath, POSIX_BASE_PATH (this))) {
+                pargfid[15] = 1;
+        } else if (sys_lgetxattr (parentpath, GFID_XATTR_KEY,
+                                  pargfid, 16) != 16) {
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "parent of %s has no gfid", real_path);
+                goto out;
+        }
+
+        uuid_unparse (pargfid, uuid_str);
+
+        target = alloca (PATH_MAX);
+        ret = snprintf (target, PATH_MAX, "../../%02x/%02x/%s/%s",
+                        pargfid[0], pargfid[1], uuid_str,
+                        strrchr (real_path, '/') + 1);
+        if (ret < 0 || ret >= PATH_MAX) {
+                errno = ENAMETOOLONG;
+                ret = -1;
+                goto out;
+        }
+
+        ret = symlink (target, handle);
+        if (ret == 0 || errno != EEXIST)
+                goto out;
+
+        /* directory was renamed, repoint the handle */
+        old  = alloca (PATH_MAX);
+        size = readlink (handle, old, PATH_MAX - 1);
+        if (size >= 0) {
+                old[size] = '\0';
+                if (!strcmp (old, target)) {
+                        ret = 0;
+                        goto out;
+                }
+        }
+
+        unlink (handle);
+        ret = symlink (target, handle);
+out:
+        GF_FREE (pathdup);
+
+        return ret;
+}
+
+
+/* Create or refresh the handle of the object at @real_path */
+int
+posix_handle_create (xlator_t *this, const char *real_path)
+{
+        struct stat  stbuf  = {0, };
+        uuid_t       gfid   = {0, };
+        char        *handle = NULL;
+        int          ret    = -1;
+        int          i      = 0;
+
+        if (sys_lgetxattr (real_path, GFID_XATTR_KEY, gfid, 16) != 16)
+                return -1;
+
+        if (posix_handle_is_root (gfid))
+                return 0;
+
+        ret = lstat (real_path, &stbuf);
+        if (ret == -1)
+                goto out;
+
+        handle = alloca (POSIX_HANDLE_PATH_LEN (this));
+        posix_handle_path (this, gfid, handle, POSIX_HANDLE_PATH_LEN (this));
+
+        /* the hash directories are created on first use */
+        for (i = 0; i < 2; i++) {
+                if (S_ISDIR (stbuf.st_mode)) {
+                        ret = posix_handle_symlink (this, real_path, handle);
+                } else {
+                        ret = link (real_path, handle);
+                        if (ret == -1 && errno == EEXIST)
+                                ret = 0;
+                }
+
+                if (ret == 0 || errno != ENOENT || i)
+                        break;
+
+                ret = posix_handle_mkdirs (this, gfid);
+                if (ret == -1)
+                        break;
+        }
+out:
+        if (ret == -1)
+                gf_log (this->name, GF_LOG_WARNING,
+                        "creating handle for %s failed: %s",
+                        real_path, strerror (errno));
+
+        return ret;
+}
+
+
+/* Drop the handle of an object whose name @stbuf was taken from has just
+   been removed. A file keeps its handle while other names remain. */
+int
+posix_handle_unset (xlator_t *this, uuid_t gfid, struct iatt *stbuf)
+{
+        struct stat  handle_stbuf = {0, };
+        char        *handle       = NULL;
+        int          ret          = 0;
+
+        if (uuid_is_null (gfid) || posix_handle_is_root (gfid))
+                return 0;
+
+        handle = alloca (POSIX_HANDLE_PATH_LEN (this));
+        posix_handle_path (this, gfid, handle, POSIX_HANDLE_PATH_LEN (this));
+
+        ret = lstat (handle, &handle_stbuf);
+        if (ret == -1)
+                return 0;
+
+        if (IA_ISDIR (stbuf->ia_type)) {
+                if (!S_ISLNK (handle_stbuf.st_mode))
+                        return 0;
+        } else if (handle_stbuf.st_ino != stbuf->ia_ino
+                   || handle_stbuf.st_nlink > 1) {
+                return 0;
+        }
+
+        ret = unlink (handle);
+        if (ret == -1)
+                gf_log (this->name, GF_LOG_WARNING,
+                        "removing handle %s failed: %s",
+                        handle, strerror (errno));
+
+        return ret;
+}
+
+
+/* Hide the link a file's handle adds from the link count in @stbuf. Every
+   file gets its handle along with its gfid, and lookup, which passes
+   @heal_path, creates those missing from before the handle store, so only
+   lookup has to check the handle for being there. */
+int
+posix_handle_fixup (xlator_t *this, const char *heal_path, struct iatt *stbuf)
+{
+        struct stat  handle_stbuf = {0, };
+        char        *handle       = NULL;
+        int          ret          = 0;
+
+        if (uuid_is_null (stbuf->ia_gfid)
+            || posix_handle_is_root (stbuf->ia_gfid))
+                return 0;
+
+        if (!heal_path) {
+                if (!IA_ISDIR (stbuf->ia_type) && (stbuf->ia_nlink > 1))
+                        stbuf->ia_nlink--;
+                return 0;
+        }
+
+        handle = alloca (POSIX_HANDLE_PATH_LEN (this));
+        posix_handle_path (this, stbuf->ia_gfid, handle,
+                           POSIX_HANDLE_PATH_LEN (this));
+
+        ret = lstat (handle, &handle_stbuf);
+        if (ret == -1) {
+                /* @stbuf was taken before the link, its count is right */
+                if (errno == ENOENT)
+                        posix_handle_create (this, heal_path);
+                return 0;
+        }
+
+        if (!IA_ISDIR (stbuf->ia_type) && (stbuf->ia_nlink > 1)
+            && (handle_stbuf.st_ino == stbuf->ia_ino))
+                stbuf->ia_nlink--;
+
+        return 0;
+}
@@ -0,0 +1,78 @@
+/*
+  Copyright (c) 2010 Gluster, Inc. <http://www.gluster.com>
+  This file is part of GlusterFS.
+
+  GlusterFS is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as published
+  by the Free Software Foundation; either version 3 of the License,
+  or (at your option) any later version.
+
+  GlusterFS is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program.  If not, see
+  <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _POSIX_HANDLE_H
+#define _POSIX_HANDLE_H
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include <limits.h>
+
+#include "xlator.h"
+
+/* Every object with a gfid gets a handle at
+   <export>/.glusterfs/<g[0]>/<g[1]>/<canonical gfid>. Files are hardlinked
+   there. Directories cannot be, so their handle is a symlink to
+   "../../<p[0]>/<p[1]>/<parent gfid>/<basename>", which is rewritten when
+   the directory is renamed.
+*/
+
+#define POSIX_HANDLE_PFX_LEN  (1 + sizeof (GF_HIDDEN_PATH) + 6 + 37)
+
+#define POSIX_HANDLE_PATH_LEN(this)                             \
+        (POSIX_BASE_PATH_LEN (this) + POSIX_HANDLE_PFX_LEN)
+
+/* Path of the object @loc refers to. Falls back to the gfid handle when
+   the loc carries no path, leaving an empty string if it cannot be
+   resolved so that the following syscall fails with ENOENT. */
+#define MAKE_LOC_PATH(var, this, loc) do {                              \
+                if ((loc)->path && (loc)->path[0] == '/') {             \
+                        MAKE_REAL_PATH (var, this, (loc)->path);        \
+                } else {                                                \
+                        var = alloca (PATH_MAX);                        \
+                        posix_handle_loc_path (this, loc, var, PATH_MAX); \
+                }                                                       \
+        } while (0)
+
+int
+posix_handle_init (xlator_t *this);
+
+int
+posix_handle_path (xlator_t *this, uuid_t gfid, char *buf, size_t len);
+
+int
+posix_handle_real_path (xlator_t *this, uuid_t gfid, char *buf, size_t len);
+
+int
+posix_handle_loc_path (xlator_t *this, loc_t *loc, char *buf, size_t len);
+
+int
+posix_handle_create (xlator_t *this, const char *real_path);
+
+int
+posix_handle_unset (xlator_t *this, uuid_t gfid, struct iatt *stbuf);
+
+int
+posix_handle_fixup (xlator_t *this, const char *heal_path, struct iatt *stbuf);
+
+#endif /* _POSIX_HANDLE_H */
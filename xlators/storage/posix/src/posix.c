@@ -43,6 +43,7 @@
 #include "dict.h"
 #include "logging.h"
 #include "posix.h"
+#include "posix-handle.h"
 #include "xlator.h"
 #include "defaults.h"
 #include "common-utils.h"
@@ -109,6 +110,8 @@ _posix_xattr_get_set (dict_t *xattr_req,
         ssize_t   xattr_size = -1;
         int       ret      = -1;
         char     *databuf  = NULL;
+        struct iobuf *iobuf   = NULL;
+        data_t   *content  = NULL;
         int       _fd      = -1;
         loc_t    *loc      = NULL;
         ssize_t  req_size  = 0;
@@ -129,11 +132,14 @@ _posix_xattr_get_set (dict_t *xattr_req,
                                 goto err;
                         }
 
-                        databuf = GF_CALLOC (1, filler->stbuf->ia_size,
-                                             gf_posix_mt_char);
-                        if (!databuf) {
+                        /* read into an iobuf, the server sends it from
+                           there without copying */
+                        iobuf = iobuf_get2 (filler->this->ctx->iobuf_pool,
+                                            filler->stbuf->ia_size);
+                        if (!iobuf) {
                                 goto err;
                         }
+                        databuf = iobuf_ptr (iobuf);
 
                         ret = read (_fd, databuf, filler->stbuf->ia_size);
                         if (ret == -1) {
@@ -152,22 +158,25 @@ _posix_xattr_get_set (dict_t *xattr_req,
                                 goto err;
                         }
 
-                        ret = dict_set_bin (filler->xattr, key,
-                                            databuf, filler->stbuf->ia_size);
+                        content = data_from_iobuf (iobuf,
+                                                   filler->stbuf->ia_size);
+                        if (!content) {
+                                goto err;
+                        }
+
+                        ret = dict_set (filler->xattr, key, content);
                         if (ret < 0) {
                                 gf_log (filler->this->name, GF_LOG_ERROR,
                                         "failed to set dict value. key: %s, path: %s",
                                         key, filler->real_path);
+                                data_destroy (content);
                                 goto err;
                         }
-
-                        /* To avoid double free in cleanup below */
-                        databuf = NULL;
                 err:
                         if (_fd != -1)
                                 close (_fd);
-                        if (databuf)
-                                GF_FREE (databuf);
+                        if (iobuf)
+                                iobuf_unref (iobuf);
                 }
         } else if (!strcmp (key, GLUSTERFS_OPEN_FD_COUNT)) {
                 loc = filler->loc;
@@ -242,8 +251,10 @@ posix_fill_gfid_fd (xlator_t *this, int fd, struct iatt *iatt)
 }
 
 
-int
-posix_lstat_with_gfid (xlator_t *this, const char *path, struct iatt *stbuf_p)
+/* with @heal, a missing gfid handle of @path is created */
+static int
+__posix_lstat_with_gfid (xlator_t *this, const char *path,
+                         struct iatt *stbuf_p, int heal)
 {
         struct posix_private  *priv    = NULL;
         int                    ret     = 0;
@@ -262,6 +273,8 @@ posix_lstat_with_gfid (xlator_t *this, const char *path, struct iatt *stbuf_p)
         if (ret)
                 gf_log_callingfn (this->name, GF_LOG_DEBUG, "failed to get gfid");
 
+        posix_handle_fixup (this, heal ? path : NULL, &stbuf);
+
         if (stbuf_p)
                 *stbuf_p = stbuf;
 out:
@@ -269,6 +282,13 @@ out:
 }
 
 
+int
+posix_lstat_with_gfid (xlator_t *this, const char *path, struct iatt *stbuf_p)
+{
+        return __posix_lstat_with_gfid (this, path, stbuf_p, 0);
+}
+
+
 int
 posix_fstat_with_gfid (xlator_t *this, int fd, struct iatt *stbuf_p)
 {
@@ -289,6 +309,8 @@ posix_fstat_with_gfid (xlator_t *this, int fd, struct iatt *stbuf_p)
         if (ret)
                 gf_log_callingfn (this->name, GF_LOG_DEBUG, "failed to get gfid");
 
+        posix_handle_fixup (this, NULL, &stbuf);
+
         if (stbuf_p)
                 *stbuf_p = stbuf;
 
@@ -398,6 +420,8 @@ posix_gfid_set (xlator_t *this, const char *path, dict_t *xattr_req)
         }
 
         ret = sys_lsetxattr (path, GFID_XATTR_KEY, uuid_req, 16, XATTR_CREATE);
+        if (ret == 0)
+                posix_handle_create (this, path);
 
 out:
         return ret;
@@ -421,20 +445,21 @@ posix_lookup (call_frame_t *frame, xlator_t *this,
         VALIDATE_OR_GOTO (frame, out);
         VALIDATE_OR_GOTO (this, out);
         VALIDATE_OR_GOTO (loc, out);
-        VALIDATE_OR_GOTO (loc->path, out);
 
-        MAKE_REAL_PATH (real_path, this, loc->path);
+        /* nameless lookups are resolved through the gfid handle */
+        MAKE_LOC_PATH (real_path, this, loc);
 
         posix_gfid_set (this, real_path, xattr_req);
 
-        op_ret   = posix_lstat_with_gfid (this, real_path, &buf);
+        /* entries that predate the handle store get their handle here */
+        op_ret   = __posix_lstat_with_gfid (this, real_path, &buf, 1);
         op_errno = errno;
 
         if (op_ret == -1) {
                 if (op_errno != ENOENT) {
                         gf_log (this->name, GF_LOG_ERROR,
                                 "lstat on %s failed: %s",
-                                loc->path, strerror (op_errno));
+                                real_path, strerror (op_errno));
                 }
 
                 entry_ret = -1;
@@ -500,13 +525,13 @@ posix_stat (call_frame_t *frame, xlator_t *this, loc_t *loc)
         VALIDATE_OR_GOTO (priv, out);
 
         SET_FS_ID (frame->root->uid, frame->root->gid);
-        MAKE_REAL_PATH (real_path, this, loc->path);
+        MAKE_LOC_PATH (real_path, this, loc);
 
         op_ret = posix_lstat_with_gfid (this, real_path, &buf);
         if (op_ret == -1) {
                 op_errno = errno;
                 gf_log (this->name, GF_LOG_ERROR,
-                        "lstat on %s failed: %s", loc->path,
+                        "lstat on %s failed: %s", real_path,
                         strerror (op_errno));
                 goto out;
         }
@@ -874,11 +899,10 @@ posix_opendir (call_frame_t *frame, xlator_t *this,
         VALIDATE_OR_GOTO (frame, out);
         VALIDATE_OR_GOTO (this, out);
         VALIDATE_OR_GOTO (loc, out);
-        VALIDATE_OR_GOTO (loc->path, out);
         VALIDATE_OR_GOTO (fd, out);
 
         SET_FS_ID (frame->root->uid, frame->root->gid);
-        MAKE_REAL_PATH (real_path, this, loc->path);
+        MAKE_LOC_PATH (real_path, this, loc);
 
         dir = opendir (real_path);
 
@@ -886,7 +910,7 @@ posix_opendir (call_frame_t *frame, xlator_t *this,
                 op_errno = errno;
                 gf_log (this->name, GF_LOG_ERROR,
                         "opendir failed on %s: %s",
-                        loc->path, strerror (op_errno));
+                        real_path, strerror (op_errno));
                 goto out;
         }
 
@@ -895,7 +919,7 @@ posix_opendir (call_frame_t *frame, xlator_t *this,
                 op_errno = errno;
                 gf_log (this->name, GF_LOG_ERROR,
                         "dirfd() failed on %s: %s",
-                        loc->path, strerror (op_errno));
+                        real_path, strerror (op_errno));
                 goto out;
         }
 
@@ -916,7 +940,7 @@ posix_opendir (call_frame_t *frame, xlator_t *this,
         if (op_ret)
                 gf_log (this->name, GF_LOG_WARNING,
                         "failed to set the fd context path=%s fd=%p",
-                        loc->path, fd);
+                        real_path, fd);
 
         op_ret = 0;
 
@@ -1173,6 +1197,11 @@ static int
 janitor_walker (const char *fpath, const struct stat *sb,
                 int typeflag, struct FTW *ftwbuf)
 {
+        struct iatt stbuf = {0, };
+
+        iatt_from_stat (&stbuf, (struct stat *) sb);
+        posix_fill_gfid_path (THIS, fpath, &stbuf);
+
         switch (sb->st_mode & S_IFMT) {
         case S_IFREG:
         case S_IFBLK:
@@ -1182,7 +1211,8 @@ janitor_walker (const char *fpath, const struct stat *sb,
         case S_IFSOCK:
                 gf_log (THIS->name, GF_LOG_TRACE,
                         "unlinking %s", fpath);
-                unlink (fpath);
+                if (!unlink (fpath))
+                        posix_handle_unset (THIS, stbuf.ia_gfid, &stbuf);
                 break;
 
         case S_IFDIR:
@@ -1190,7 +1220,9 @@ janitor_walker (const char *fpath, const struct stat *sb,
                         gf_log (THIS->name, GF_LOG_TRACE,
                                 "removing directory %s", fpath);
 
-                        rmdir (fpath);
+                        if (!rmdir (fpath))
+                                posix_handle_unset (THIS, stbuf.ia_gfid,
+                                                    &stbuf);
                 }
                 break;
         }
@@ -1445,6 +1477,7 @@ posix_unlink (call_frame_t *frame, xlator_t *this,
         char                    *parentpath = NULL;
         int32_t                  fd = -1;
         struct posix_private    *priv      = NULL;
+        struct iatt            stbuf     = {0,};
         struct iatt            preparent = {0,};
         struct iatt            postparent = {0,};
 
@@ -1487,6 +1520,8 @@ posix_unlink (call_frame_t *frame, xlator_t *this,
                 }
         }
 
+        posix_lstat_with_gfid (this, real_path, &stbuf);
+
         op_ret = sys_unlink (real_path);
         if (op_ret == -1) {
                 op_errno = errno;
@@ -1496,6 +1531,8 @@ posix_unlink (call_frame_t *frame, xlator_t *this,
                 goto out;
         }
 
+        posix_handle_unset (this, stbuf.ia_gfid, &stbuf);
+
         op_ret = posix_lstat_with_gfid (this, parentpath, &postparent);
         if (op_ret == -1) {
                 op_errno = errno;
@@ -1533,6 +1570,7 @@ posix_rmdir (call_frame_t *frame, xlator_t *this,
         char *  real_path = NULL;
         char *  pathdup   = NULL;
         char *  parentpath = NULL;
+        struct iatt   stbuf     = {0,};
         struct iatt   preparent = {0,};
         struct iatt   postparent = {0,};
         struct posix_private    *priv      = NULL;
@@ -1563,6 +1601,8 @@ posix_rmdir (call_frame_t *frame, xlator_t *this,
                 goto out;
         }
 
+        posix_lstat_with_gfid (this, real_path, &stbuf);
+
         if (flags) {
                 uint32_t hashval = 0;
                 char *tmp_path = alloca (strlen (priv->trash_path) + 16);
@@ -1595,6 +1635,9 @@ posix_rmdir (call_frame_t *frame, xlator_t *this,
                 goto out;
         }
 
+        /* the janitor unsets the handles of what moved to the landfill */
+        posix_handle_unset (this, stbuf.ia_gfid, &stbuf);
+
         op_ret = posix_lstat_with_gfid (this, parentpath, &postparent);
         if (op_ret == -1) {
                 op_errno = errno;
@@ -1747,6 +1790,8 @@ posix_rename (call_frame_t *frame, xlator_t *this,
         char                 *real_oldpath = NULL;
         char                 *real_newpath = NULL;
         struct iatt           stbuf        = {0, };
+        struct iatt           oldstbuf     = {0, };
+        struct iatt           newstbuf     = {0, };
         struct posix_private *priv         = NULL;
         char                  was_present  = 1;
         char                 *oldpathdup    = NULL;
@@ -1802,7 +1847,9 @@ posix_rename (call_frame_t *frame, xlator_t *this,
                 goto out;
         }
 
-        op_ret = posix_lstat_with_gfid (this, real_newpath, &stbuf);
+        posix_lstat_with_gfid (this, real_oldpath, &oldstbuf);
+
+        op_ret = posix_lstat_with_gfid (this, real_newpath, &newstbuf);
         if ((op_ret == -1) && (errno == ENOENT)){
                 was_present = 0;
         }
@@ -1817,6 +1864,14 @@ posix_rename (call_frame_t *frame, xlator_t *this,
                 goto out;
         }
 
+        /* a directory handle names its parent, a file handle is
+           unaffected unless the rename replaced another file */
+        if (IA_ISDIR (oldstbuf.ia_type))
+                posix_handle_create (this, real_newpath);
+
+        if (was_present && uuid_compare (oldstbuf.ia_gfid, newstbuf.ia_gfid))
+                posix_handle_unset (this, newstbuf.ia_gfid, &newstbuf);
+
         op_ret = posix_lstat_with_gfid (this, real_newpath, &stbuf);
         if (op_ret == -1) {
                 op_errno = errno;
@@ -1927,6 +1982,8 @@ posix_link (call_frame_t *frame, xlator_t *this,
                 goto out;
         }
 
+        posix_handle_create (this, real_newpath);
+
         op_ret = posix_lstat_with_gfid (this, real_newpath, &stbuf);
         if (op_ret == -1) {
                 op_errno = errno;
@@ -2210,13 +2267,17 @@ posix_open (call_frame_t *frame, xlator_t *this,
         priv = this->private;
         VALIDATE_OR_GOTO (priv, out);
 
-        MAKE_REAL_PATH (real_path, this, loc->path);
+        MAKE_LOC_PATH (real_path, this, loc);
 
-        op_ret = setgid_override (this, real_path, &gid);
-        if (op_ret < 0) {
-                op_errno = -op_ret;
-                op_ret = -1;
-                goto out;
+        /* the parent of a handle is not a directory of the export, and
+           its gid only matters for new files anyway */
+        if (flags & O_CREAT) {
+                op_ret = setgid_override (this, real_path, &gid);
+                if (op_ret < 0) {
+                        op_errno = -op_ret;
+                        op_ret = -1;
+                        goto out;
+                }
         }
 
         SET_FS_ID (frame->root->uid, gid);
@@ -2347,7 +2408,7 @@ posix_readv (call_frame_t *frame, xlator_t *this,
                 align = 4096;    /* align to page boundary */
         }
 
-        iobuf = iobuf_get (this->ctx->iobuf_pool);
+        iobuf = iobuf_get2 (this->ctx->iobuf_pool, size);
         if (!iobuf) {
                 op_errno = ENOMEM;
                 goto out;
@@ -3982,6 +4043,198 @@ posix_fentrylk (call_frame_t *frame, xlator_t *this,
 }
 
 
+/* readdirp replies with at least this many entries are filled by the
+   readdirp threads too, POSIX_READDIRP_CHUNK entries at a time */
+#define POSIX_READDIRP_PARALLEL_MIN 64
+#define POSIX_READDIRP_CHUNK        16
+
+struct posix_readdirp_batch {
+        struct list_head   list;
+        xlator_t          *this;
+        int                dirfd;
+        const char        *dir_path;
+        int                dir_path_len;
+        gf_dirent_t      **entries;
+        int                count;
+        int                next;     /* first entry not claimed yet */
+        int                pending;  /* chunks not filled yet */
+        pthread_cond_t     done;
+};
+
+
+/* @path holds the directory path followed by a '/' at @path_len */
+static void
+posix_readdirp_fill_entry (xlator_t *this, int dirfd, char *path,
+                           int path_len, gf_dirent_t *entry)
+{
+        struct stat statbuf = {0, };
+        int         ret     = -1;
+
+        memset (&entry->d_stat, 0, sizeof (entry->d_stat));
+
+        strcpy (path + path_len + 1, entry->d_name);
+
+#ifdef AT_SYMLINK_NOFOLLOW
+        ret = fstatat (dirfd, entry->d_name, &statbuf, AT_SYMLINK_NOFOLLOW);
+#else
+        ret = lstat (path, &statbuf);
+#endif
+        if (ret == -1)
+                return;
+
+        iatt_from_stat (&entry->d_stat, &statbuf);
+
+        posix_fill_gfid_path (this, path, &entry->d_stat);
+        posix_handle_fixup (this, NULL, &entry->d_stat);
+}
+
+
+/* Claim and fill chunks of @batch until all are claimed. Called with
+   readdirp_lock held, which is dropped while filling. */
+static void
+__posix_readdirp_batch_work (struct posix_private *priv,
+                             struct posix_readdirp_batch *batch, char *path)
+{
+        int start = 0;
+        int end   = 0;
+
+        while (batch->next < batch->count) {
+                start = batch->next;
+                end   = min (start + POSIX_READDIRP_CHUNK, batch->count);
+
+                batch->next = end;
+                if (end == batch->count)
+                        list_del_init (&batch->list);
+
+                pthread_mutex_unlock (&priv->readdirp_lock);
+                {
+                        for (; start < end; start++)
+                                posix_readdirp_fill_entry (batch->this,
+                                                           batch->dirfd, path,
+                                                           batch->dir_path_len,
+                                                           batch->entries[start]);
+                }
+                pthread_mutex_lock (&priv->readdirp_lock);
+
+                if (--batch->pending == 0)
+                        pthread_cond_signal (&batch->done);
+        }
+}
+
+
+static void *
+posix_readdirp_thread_proc (void *data)
+{
+        xlator_t                    *this  = NULL;
+        struct posix_private        *priv  = NULL;
+        struct posix_readdirp_batch *batch = NULL;
+        char                         path[PATH_MAX + NAME_MAX + 2];
+
+        this = data;
+        priv = this->private;
+
+        THIS = this;
+
+        pthread_mutex_lock (&priv->readdirp_lock);
+        while (1) {
+                while (list_empty (&priv->readdirp_batches))
+                        pthread_cond_wait (&priv->readdirp_cond,
+                                           &priv->readdirp_lock);
+
+                batch = list_entry (priv->readdirp_batches.next,
+                                    struct posix_readdirp_batch, list);
+
+                memcpy (path, batch->dir_path, batch->dir_path_len);
+                path[batch->dir_path_len] = '/';
+
+                __posix_readdirp_batch_work (priv, batch, path);
+        }
+        pthread_mutex_unlock (&priv->readdirp_lock);
+
+        return NULL;
+}
+
+
+static void
+posix_spawn_readdirp_threads (xlator_t *this)
+{
+        struct posix_private *priv   = NULL;
+        pthread_t             thread;
+        int                   i      = 0;
+        int                   ret    = 0;
+
+        priv = this->private;
+
+        for (i = 0; i < priv->readdirp_threads; i++) {
+                ret = pthread_create (&thread, NULL,
+                                      posix_readdirp_thread_proc, this);
+                if (ret != 0) {
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "spawning readdirp thread failed: %s",
+                                strerror (ret));
+                        break;
+                }
+        }
+
+        priv->readdirp_threads = i;
+}
+
+
+/* stat and fetch the gfid of every entry, sharing the work with the
+   readdirp threads when there are enough entries to be worth it */
+static void
+posix_readdirp_fill (xlator_t *this, DIR *dir, char *path, int path_len,
+                     gf_dirent_t *entries, int count)
+{
+        struct posix_private        *priv  = NULL;
+        struct posix_readdirp_batch  batch = {{0, }, };
+        gf_dirent_t                 *entry = NULL;
+        int                          i     = 0;
+
+        priv = this->private;
+
+        if (priv->readdirp_threads && count >= POSIX_READDIRP_PARALLEL_MIN)
+                batch.entries = GF_CALLOC (count, sizeof (*batch.entries),
+                                           gf_posix_mt_dirent_array);
+
+        if (!batch.entries) {
+                list_for_each_entry (entry, &entries->list, list) {
+                        posix_readdirp_fill_entry (this, dirfd (dir), path,
+                                                   path_len, entry);
+                }
+                return;
+        }
+
+        list_for_each_entry (entry, &entries->list, list) {
+                batch.entries[i++] = entry;
+        }
+
+        batch.this         = this;
+        batch.dirfd        = dirfd (dir);
+        batch.dir_path     = path;
+        batch.dir_path_len = path_len;
+        batch.count        = count;
+        batch.pending      = (count + POSIX_READDIRP_CHUNK - 1)
+                / POSIX_READDIRP_CHUNK;
+        pthread_cond_init (&batch.done, NULL);
+
+        pthread_mutex_lock (&priv->readdirp_lock);
+        {
+                list_add_tail (&batch.list, &priv->readdirp_batches);
+                pthread_cond_broadcast (&priv->readdirp_cond);
+
+                __posix_readdirp_batch_work (priv, &batch, path);
+
+                while (batch.pending)
+                        pthread_cond_wait (&batch.done, &priv->readdirp_lock);
+        }
+        pthread_mutex_unlock (&priv->readdirp_lock);
+
+        pthread_cond_destroy (&batch.done);
+        GF_FREE (batch.entries);
+}
+
+
 int32_t
 posix_do_readdir (call_frame_t *frame, xlator_t *this,
                   fd_t *fd, size_t size, off_t off, int whichop)
@@ -4006,9 +4259,8 @@ posix_do_readdir (call_frame_t *frame, xlator_t *this,
         struct posix_private *priv           = NULL;
         struct iatt           stbuf          = {0, };
         char                  base_path[PATH_MAX] = {0,};
-        gf_dirent_t          *tmp_entry      = NULL;
         struct stat           statbuf        = {0, };
-        char                  hidden_path[PATH_MAX] = {0, };
+        int                   at_base        = 0;
 
         VALIDATE_OR_GOTO (frame, out);
         VALIDATE_OR_GOTO (this, out);
@@ -4037,7 +4289,7 @@ posix_do_readdir (call_frame_t *frame, xlator_t *this,
         real_path     = pfd->path;
         real_path_len = strlen (real_path);
 
-        entry_path_len = real_path_len + NAME_MAX;
+        entry_path_len = real_path_len + NAME_MAX + 2;
         entry_path     = alloca (entry_path_len);
 
         strncpy(base_path, POSIX_BASE_PATH(this), sizeof(base_path));
@@ -4051,6 +4303,8 @@ posix_do_readdir (call_frame_t *frame, xlator_t *this,
         strncpy (entry_path, real_path, entry_path_len);
         entry_path[real_path_len] = '/';
 
+        at_base = !strcmp (real_path, base_path);
+
         dir = pfd->dir;
 
         if (!dir) {
@@ -4092,16 +4346,16 @@ posix_do_readdir (call_frame_t *frame, xlator_t *this,
                         break;
                 }
 
-                if ((!strcmp(real_path, base_path))
+                if (at_base
                     && (!strcmp(entry->d_name, GF_REPLICATE_TRASH_DIR)))
                         continue;
 
-                if ((!strcmp (real_path, base_path))
+                if (at_base
                     && (!strncmp (GF_HIDDEN_PATH, entry->d_name,
                                   strlen(GF_HIDDEN_PATH)))) {
-                        snprintf (hidden_path, PATH_MAX, "%s/%s", real_path,
-                                  entry->d_name);
-                        ret = lstat (hidden_path, &statbuf);
+                        strcpy (entry_path + real_path_len + 1,
+                                entry->d_name);
+                        ret = lstat (entry_path, &statbuf);
                         if (!ret && S_ISDIR (statbuf.st_mode))
                                 continue;
                 }
@@ -4135,14 +4389,9 @@ posix_do_readdir (call_frame_t *frame, xlator_t *this,
                 count ++;
         }
 
-        if (whichop == GF_FOP_READDIRP) {
-                list_for_each_entry (tmp_entry, &entries.list, list) {
-                        strcpy (entry_path + real_path_len + 1,
-                                tmp_entry->d_name);
-                        posix_lstat_with_gfid (this, entry_path, &stbuf);
-                        tmp_entry->d_stat = stbuf;
-                }
-        }
+        if (whichop == GF_FOP_READDIRP)
+                posix_readdirp_fill (this, dir, entry_path, real_path_len,
+                                     &entries, count);
         op_ret = count;
         errno = 0;
         if ((!readdir (dir) && (errno == 0)))
@@ -4337,6 +4586,7 @@ init (xlator_t *this)
         int                    ret           = 0;
         int                    op_ret        = -1;
         int32_t                janitor_sleep = 0;
+        int32_t                readdirp_threads = 0;
 
         dir_data = dict_get (this->options, "directory");
 
@@ -4535,11 +4785,38 @@ init (xlator_t *this)
 #endif
         this->private = (void *)_private;
 
+        ret = posix_handle_init (this);
+        if (ret)
+                goto out;
+
         pthread_mutex_init (&_private->janitor_lock, NULL);
         pthread_cond_init (&_private->janitor_cond, NULL);
         INIT_LIST_HEAD (&_private->janitor_fds);
 
         posix_spawn_janitor_thread (this);
+
+        _private->readdirp_threads = POSIX_READDIRP_THREADS_DEFAULT;
+
+        dict_ret = dict_get_int32 (this->options, "readdirp-threads",
+                                   &readdirp_threads);
+        if (dict_ret == 0) {
+                if (readdirp_threads < 0
+                    || readdirp_threads > POSIX_READDIRP_THREADS_MAX) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "'readdirp-threads' takes a value between 0 "
+                                "and %d", POSIX_READDIRP_THREADS_MAX);
+                        ret = -1;
+                        goto out;
+                }
+
+                _private->readdirp_threads = readdirp_threads;
+        }
+
+        INIT_LIST_HEAD (&_private->readdirp_batches);
+        pthread_mutex_init (&_private->readdirp_lock, NULL);
+        pthread_cond_init (&_private->readdirp_cond, NULL);
+
+        posix_spawn_readdirp_threads (this);
 out:
         return ret;
 }
@@ -4625,5 +4902,9 @@ struct volume_options options[] = {
           .type = GF_OPTION_TYPE_BOOL },
         { .key  = {"janitor-sleep-duration"},
           .type = GF_OPTION_TYPE_INT },
+        { .key  = {"readdirp-threads"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 0,
+          .max  = POSIX_READDIRP_THREADS_MAX },
         { .key  = {NULL} }
 };
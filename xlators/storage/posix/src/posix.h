@@ -53,6 +53,9 @@
 #include "timer.h"
 #include "posix-mem-types.h"
 
+#define POSIX_READDIRP_THREADS_DEFAULT 4
+#define POSIX_READDIRP_THREADS_MAX     32
+
 /**
  * posix_fd - internal structure common to file and directory fd's
  */
@@ -114,6 +117,12 @@ struct posix_private {
         pthread_t       janitor;
         gf_boolean_t    janitor_present;
         char *          trash_path;
+
+/* threads sharing the stat and gfid lookups of large readdirp replies */
+        int32_t          readdirp_threads;
+        struct list_head readdirp_batches;
+        pthread_mutex_t  readdirp_lock;
+        pthread_cond_t   readdirp_cond;
 };
 
 #define POSIX_BASE_PATH(this) (((struct posix_private *)this->private)->base_path)